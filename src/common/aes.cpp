@@ -82,6 +82,21 @@ void key_schedule(uint8_t *sk, int rounds)
     }
 }
 
+// -----------------------------------------------------------------------------
+void key_schedule_inv(uint8_t *sk, int rounds)
+{
+    for (int r = rounds - 1; r >= 0; --r) {
+        uint8_t *pk = &sk[r * 16];
+        const uint8_t *nk = &sk[(r + 1) * 16];
+        for (int i = 15; i >= 4; --i)
+            pk[i] = nk[i] ^ nk[i - 4];
+        pk[0] = sbox[pk[13]] ^ nk[0] ^ rcon[r];
+        pk[1] = sbox[pk[14]] ^ nk[1];
+        pk[2] = sbox[pk[15]] ^ nk[2];
+        pk[3] = sbox[pk[12]] ^ nk[3];
+    }
+}
+
 // -----------------------------------------------------------------------------
 void add_round_key(const uint8_t *in, uint8_t *out, const uint8_t *sk)
 {
@@ -177,6 +192,90 @@ void encrypt(const uint8_t *pt, const uint8_t *sk, uint8_t *ct)
     add_round_key(s0, s1, &sk[10 * 16]);
 }
 
+// -----------------------------------------------------------------------------
+// Lookup tables for encrypt_batch, over columns packed into little endian
+// words. te[r][x] is the column contributed by a byte x in row r of the state
+// to sub_bytes and mix_columns, and s[x] is the sbox as a word.
+static struct round_tables {
+    round_tables() {
+        for (int x = 0; x < 256; ++x) {
+            const uint32_t v = sbox[x];
+            const uint32_t v2 = GF_2(v) & 0xFF, v3 = v2 ^ v;
+            te[0][x] = v2 | v << 8 | v << 16 | v3 << 24;
+            for (int r = 1; r < 4; ++r)
+                te[r][x] = te[r - 1][x] << 8 | te[r - 1][x] >> 24;
+            s[x] = v;
+        }
+    }
+
+    uint32_t te[4][256];
+    uint32_t s[256];
+} _round_tables;
+
+static inline uint32_t load_word(const uint8_t *b)
+{
+    return b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static inline void store_word(uint8_t *b, uint32_t w)
+{
+    b[0] = w; b[1] = w >> 8; b[2] = w >> 16; b[3] = w >> 24;
+}
+
+// -----------------------------------------------------------------------------
+void encrypt_batch(const uint8_t *pt, const uint8_t *keys, uint8_t *ct,
+                   size_t n)
+{
+    const uint32_t (*te)[256] = _round_tables.te;
+    const uint32_t *s = _round_tables.s;
+    const uint32_t p0 = load_word(pt),     p1 = load_word(pt + 4);
+    const uint32_t p2 = load_word(pt + 8), p3 = load_word(pt + 12);
+
+#define B(w, r) (((w) >> (8 * (r))) & 0xFF)
+#define COLUMN(a, b, c, d) \
+    (te[0][B(a, 0)] ^ te[1][B(b, 1)] ^ te[2][B(c, 2)] ^ te[3][B(d, 3)])
+#define LAST(a, b, c, d) \
+    (s[B(a, 0)] | s[B(b, 1)] << 8 | s[B(c, 2)] << 16 | s[B(d, 3)] << 24)
+
+    for (size_t k = 0; k < n; ++k, keys += 16, ct += 16) {
+        uint32_t w0 = load_word(keys),     w1 = load_word(keys + 4);
+        uint32_t w2 = load_word(keys + 8), w3 = load_word(keys + 12);
+        uint32_t s0 = p0 ^ w0, s1 = p1 ^ w1, s2 = p2 ^ w2, s3 = p3 ^ w3;
+
+        for (int round = 1; round <= 10; ++round) {
+            // expand the subkey of this round from the previous one
+            w0 ^= (s[B(w3, 1)] | s[B(w3, 2)] << 8 | s[B(w3, 3)] << 16 |
+                   s[B(w3, 0)] << 24) ^ rcon[round - 1];
+            w1 ^= w0;
+            w2 ^= w1;
+            w3 ^= w2;
+
+            // column c of shift_rows takes row r from column c + r
+            uint32_t t0, t1, t2, t3;
+            if (round < 10) {
+                t0 = COLUMN(s0, s1, s2, s3);
+                t1 = COLUMN(s1, s2, s3, s0);
+                t2 = COLUMN(s2, s3, s0, s1);
+                t3 = COLUMN(s3, s0, s1, s2);
+            }
+            else {
+                t0 = LAST(s0, s1, s2, s3);
+                t1 = LAST(s1, s2, s3, s0);
+                t2 = LAST(s2, s3, s0, s1);
+                t3 = LAST(s3, s0, s1, s2);
+            }
+            s0 = t0 ^ w0; s1 = t1 ^ w1; s2 = t2 ^ w2; s3 = t3 ^ w3;
+        }
+
+        store_word(ct, s0);     store_word(ct + 4, s1);
+        store_word(ct + 8, s2); store_word(ct + 12, s3);
+    }
+
+#undef LAST
+#undef COLUMN
+#undef B
+}
+
 // -----------------------------------------------------------------------------
 void decrypt(const uint8_t *pt, const uint8_t *sk, uint8_t *ct)
 {
@@ -17,6 +17,7 @@
 #ifndef AES__H
 #define AES__H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // multiplication by constants 1-F in GF(2^8)
@@ -51,9 +52,19 @@ extern int sbox_inv[256];
 /// Compute each of the 10 subkeys for the specified encryption key.
 void key_schedule(uint8_t *sk, int rounds);
 
+/// Compute the subkeys preceding the last, given at sk[rounds * 16], back to
+/// the encryption key at sk[0].
+void key_schedule_inv(uint8_t *sk, int rounds);
+
 /// Perform an AES128 encryption operation on the specified plaintext.
 void encrypt(const uint8_t *pt, const uint8_t *sk, uint8_t *ct);
 
+/// Encrypt one plaintext under each of n 16 byte encryption keys, expanding
+/// each key on the fly, for testing many candidate keys. Each round is a
+/// lookup in tables that combine the sbox with mix_columns.
+void encrypt_batch(const uint8_t *pt, const uint8_t *keys, uint8_t *ct,
+                   size_t n);
+
 /// Perform an AES128 decryption operation on the specified ciphertext.
 void decrypt(const uint8_t *ct, const uint8_t *sk, uint8_t *pt);
 
@@ -16,165 +16,708 @@
 
 #include <cstdlib>
 #include <cmath>
+#include <limits>
+#include <sstream>
+#include <boost/shared_ptr.hpp>
 #include "attack_engine.h"
 #include "attack_manager.h"
+#include "simd.h"
 
 using namespace std;
 using namespace util;
 
+// number of samples per tile when accumulating a batch of weighted traces
+#define BATCH_TILE_SAMPLES 512
+
+// default number of traces accumulated in partial sums between folds
+#define FOLD_BLOCK_TRACES 256
+
+// -----------------------------------------------------------------------------
+// Return the array that traces are accumulated into: the sums themselves if
+// they have the sample type, otherwise the partial sums folded into them.
+template <typename real>
+inline real *accumulator(vector<real> &sums, vector<real> &partial)
+{
+    return &sums[0];
+}
+
+template <typename real, typename sum>
+inline real *accumulator(vector<sum> &sums, vector<real> &partial)
+{
+    return &partial[0];
+}
+
+// -----------------------------------------------------------------------------
+// Return n sums as an array of the type that correlations are computed in:
+// the sums themselves if they have that type, otherwise a copy in buf.
+template <typename real>
+inline const real *converted(const real *x, size_t n, vector<real> &buf)
+{
+    return x;
+}
+
+template <typename real, typename sum>
+inline const real *converted(const sum *x, size_t n, vector<real> &buf)
+{
+    buf.assign(x, x + n);
+    return &buf[0];
+}
+
 // -----------------------------------------------------------------------------
+// Return the array that n results of the computed type are written to: d
+// itself if it has that type, otherwise buf, to be copied into d. Returns NULL
+// if d is NULL.
 template <typename real>
+inline real *staging(real *d, size_t n, vector<real> &buf)
+{
+    return d;
+}
+
+template <typename real, typename compute>
+inline compute *staging(real *d, size_t n, vector<compute> &buf)
+{
+    if (!d) return NULL;
+    buf.resize(n);
+    return &buf[0];
+}
+
+// The type that correlations are computed in: that of the sums, unless they
+// are integers, which are converted to the result type.
+template <typename real, typename sum, bool integer>
+struct compute_type { typedef sum type; };
+
+template <typename real, typename sum>
+struct compute_type<real, sum, true> { typedef real type; };
+
+// -----------------------------------------------------------------------------
+// Correlation power analysis of one or more targets in a single pass. Every
+// target (key byte, bit window and leakage model) contributes one row of
+// weighted trace sums per key guess, while the trace sums are shared.
+//
+// The sums may be kept at a higher precision than the samples. Traces are then
+// accumulated by the sample type kernels into partial sums, which are folded
+// into the wide sums every 'block' traces, so that the rounding error of the
+// sums does not grow with the number of traces. The partial sums are of the
+// samples less a reference (the mean when the block started), which avoids
+// cancellation when the variance is small compared to the mean.
+//
+// The samples and partial sums may also be integers (part), for the levels of
+// an integer dataset. The sums are then exact, and a block is folded early
+// whenever another trace could overflow the partial sums.
+template <typename real, typename sum = real, typename part = real>
 class attack_cpa: public attack_instance {
 public:
     attack_cpa();
     virtual ~attack_cpa();
 
     virtual bool setup(crypto_instance *crypto, const parameters &params);
-    virtual void process(const time_map &tmap, const trace &pt);
+    virtual void process(const trace &pt);
+    virtual void process_batch(crypto_instance *crypto,
+                               const vector<trace> &batch);
     virtual void record_interval(size_t n);
     virtual void clone(const attack_instance *inst);
     virtual void coalesce(const attack_instance *inst);
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
     virtual void write_results(const string &path);
     virtual bool cleanup();
 
     virtual void get_diffs(vector<double> &diffs);
     virtual void get_maxes(vector<double> &maxes);
 
+    virtual bool split_samples(void) const { return true; }
+
+    virtual size_t num_targets(void) { return m_targets.size(); }
+    virtual void select_target(size_t t, string &name, int &guesses);
+
 protected:
-    void compute_diffs(real *d);
+    typedef boost::shared_ptr<crypto_instance> crypto_ptr;
+    typedef typename compute_type<real, sum,
+        numeric_limits<sum>::is_integer>::type compute;
+
+    struct target {
+        crypto_instance *crypto;
+        unsigned int byte, mask;
+        int center, guesses;
+        size_t row; // first row of this target's weighted sums
+        string name;
+    };
+
+    bool parse_targets(crypto_instance *crypto, const parameters &params);
+    void compute_weights(const trace &pt, part *w, size_t stride);
+    void compute_diffs(real *d, real *m, size_t first, size_t count);
+    void fold(void);
+    void add_partial(const attack_cpa *src, size_t first, size_t last);
+    void clear_partial(void);
+    void start_block(const trace &pt);
+    const part *centered(const trace &pt, part *buf);
+    bool admit(const part *p, size_t count, size_t traces);
+    void accumulate_wide(const trace &pt);
 
     crypto_instance *m_crypto;
     size_t m_traces;
     size_t m_nevents;
     size_t m_nreports;
-    unsigned int m_mask, m_byte, m_offset, m_bits;
-    vector<real> m_t1; // sum of traces
-    vector<real> m_t2; // sum of squared traces
-    vector<real> m_w1; // sum of weights
-    vector<real> m_w2; // sum of squared weights
-    vector<real> m_tw; // sum of weighted traces
-    vector<real> m_dtemp;
+    size_t m_rows;     // total number of key guesses across the targets
+    size_t m_selected; // target returned by get_diffs and get_maxes
+    vector<target> m_targets;
+    vector<crypto_ptr> m_models; // additional leakage models
+    vector<sum> m_t1; // sum of traces
+    vector<sum> m_t2; // sum of squared traces
+    vector<sum> m_w1; // sum of weights
+    vector<sum> m_w2; // sum of squared weights
+    vector<sum> m_tw; // sum of weighted traces
+    vector<real> m_dtemp; // differentials for get_diffs, if converted
     vector<real> m_maxes;
-    int m_guesses;
-    int m_center;
+    vector<compute> m_sd; // standard deviation of each sample
+    vector<compute> m_sh; // standard deviation of each key guess's weights
+    vector<compute> m_drow; // differentials of one tile of one key guess
+    vector<compute> m_ct1, m_ctw; // sums converted for the correlation
+    vector<part> m_p1, m_p2, m_pw1, m_pw2, m_ptw; // partial sums since fold
+    vector<part> m_ref; // reference subtracted from the partial sums
+    size_t m_block;   // traces between folds, or 0 without partial sums
+    size_t m_pending; // traces accumulated in the partial sums
+    part m_mag;  // largest magnitude of a centered sample in the block
+    part m_wmax; // largest magnitude of a weight
+    vector<part> m_bw; // batch weights (rows x batch)
+    vector<part> m_bp; // batch power, if converted (batch x events)
+    vector<const part *> m_brows; // power samples of each trace in the batch
+    vector<int> m_values; // sensitive value of each key guess
     boost::mutex m_mutex;
 };
 
 // -----------------------------------------------------------------------------
-template <typename real>
-attack_cpa<real>::attack_cpa()
+template <typename real, typename sum, typename part>
+attack_cpa<real, sum, part>::attack_cpa()
+: m_rows(0), m_selected(0), m_block(0), m_pending(0), m_mag(0), m_wmax(0)
 {
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-attack_cpa<real>::~attack_cpa()
+template <typename real, typename sum, typename part>
+attack_cpa<real, sum, part>::~attack_cpa()
 {
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::compute_diffs(real *d)
+// Compute the differentials of key guesses [first, first + count) into d
+// (guess 'first' at d[0]) and raise their interval maxes m in the same pass.
+// Either d or m may be NULL, so that the maxes are found without storing the
+// differentials. The samples are processed in tiles, so that the trace sums
+// and deviations of a tile stay in cache while every key guess reads them.
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::compute_diffs(real *d, real *m, size_t first,
+                                                size_t count)
 {
-    const real ni = 1.0 / m_traces;
+    fold();
+    const compute ni = 1.0 / m_traces;
+
+    // the trace variance is independent of the key guess
+    m_sd.resize(m_nevents);
+    for (size_t s = 0; s < m_nevents; ++s) {
+        const compute t1 = m_t1[s];
+        const compute tv = ((compute)m_t2[s] - t1 * t1 * ni) * ni;
+        m_sd[s] = util::nonzero(tv) ? sqrt(tv) : 0;
+    }
 
-    for (int k = 0; k < m_guesses; ++k) {
-        const real hv = (m_w2[k] - m_w1[k] * m_w1[k] * ni) * ni;
-        const real *tw = &m_tw[k * m_nevents];
-        real *dest = &d[k * m_nevents];
+    // and the weight variance is independent of the sample
+    m_sh.resize(m_rows);
+    for (size_t k = first; k < first + count; ++k) {
+        const compute w1 = m_w1[k];
+        const compute hv = ((compute)m_w2[k] - w1 * w1 * ni) * ni;
+        m_sh[k] = util::nonzero(hv) ? sqrt(hv) : 0;
+    }
 
-        for (size_t s = 0; s < m_nevents; ++s) {
-            const real tv = (m_t2[s] - m_t1[s] * m_t1[s] * ni) * ni;
-            dest[s] = (tw[s] - m_w1[k] * m_t1[s] * ni) * ni;
-            dest[s] = util::nonzero(tv) ? (dest[s] / sqrt(tv)) : 0.0;
-            dest[s] = util::nonzero(hv) ? (dest[s] / sqrt(hv)) : 0.0;
+    for (size_t s0 = 0; s0 < m_nevents; s0 += BATCH_TILE_SAMPLES) {
+        const size_t len = min(m_nevents, s0 + BATCH_TILE_SAMPLES) - s0;
+        const compute *t1 = converted(&m_t1[s0], len, m_ct1);
+
+        for (size_t k = first; k < first + count; ++k) {
+            real *dest = d ? &d[(k - first) * m_nevents + s0] : NULL;
+            compute mk = m ? m[k] : 0;
+
+            if (!m_sh[k]) {
+                if (dest) fill(dest, dest + len, 0);
+                mk = max(mk, (compute)0);
+            }
+            else {
+                compute *out = staging(dest, len, m_drow);
+                mk = simd::correlate_max(out,
+                        converted(&m_tw[k * m_nevents + s0], len, m_ctw),
+                        t1, &m_sd[s0], (compute)m_w1[k], ni, m_sh[k], len, mk);
+                if (out && (void *)out != (void *)dest)
+                    copy(out, out + len, dest);
+            }
+
+            if (m) m[k] = (real)mk;
         }
     }
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-bool attack_cpa<real>::setup(crypto_instance *crypto, const parameters &params)
+// Fold the partial sums into the sums, and clear them.
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::fold(void)
+{
+    add_partial(this, 0, m_nevents);
+    clear_partial();
+}
+
+// -----------------------------------------------------------------------------
+// Add samples [first, last) of the partial sums of src to the sums, restoring
+// the reference that was subtracted from them. The sums of the weights are
+// added with the range starting at sample zero.
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::add_partial(const attack_cpa *src, size_t first,
+                                        size_t last)
+{
+    if (!src->m_pending) return;
+    const sum n = src->m_pending;
+
+    if (!first) {
+        for (size_t k = 0; k < m_rows; ++k) {
+            m_w1[k] += src->m_pw1[k];
+            m_w2[k] += src->m_pw2[k];
+        }
+    }
+
+    for (size_t s = first; s < last; ++s) {
+        const sum r = src->m_ref[s], p1 = src->m_p1[s];
+        m_t1[s] += p1 + n * r;
+        m_t2[s] += src->m_p2[s] + r * (2 * p1 + n * r);
+    }
+
+    for (size_t k = 0; k < m_rows; ++k) {
+        const sum w1 = src->m_pw1[k];
+        const size_t off = k * m_nevents;
+        for (size_t s = first; s < last; ++s)
+            m_tw[off + s] += src->m_ptw[off + s] + w1 * src->m_ref[s];
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::clear_partial(void)
+{
+    fill(m_p1.begin(), m_p1.end(), 0);
+    fill(m_p2.begin(), m_p2.end(), 0);
+    fill(m_pw1.begin(), m_pw1.end(), 0);
+    fill(m_pw2.begin(), m_pw2.end(), 0);
+    fill(m_ptw.begin(), m_ptw.end(), 0);
+    m_pending = 0;
+    m_mag = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Choose the reference of the partial sums as a block starts with trace pt:
+// the mean of the traces so far, or the trace itself if there are none.
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::start_block(const trace &pt)
+{
+    if (!m_traces) {
+        const part *p = power_samples(pt, &m_ref[0]);
+        copy(p, p + m_nevents, m_ref.begin());
+        return;
+    }
+
+    for (size_t s = 0; s < m_nevents; ++s)
+        m_ref[s] = (part)(m_t1[s] / (sum)m_traces);
+}
+
+// -----------------------------------------------------------------------------
+// Return the samples of pt less the reference of the partial sums in buf.
+template <typename real, typename sum, typename part>
+const part *attack_cpa<real, sum, part>::centered(const trace &pt, part *buf)
+{
+    const part *p = power_samples(pt, buf);
+    if (p != buf) copy(p, p + m_nevents, buf);
+    simd::axpy(buf, &m_ref[0], (part)-1, m_nevents);
+    return buf;
+}
+
+// -----------------------------------------------------------------------------
+// Return whether the centered samples p of 'traces' more traces (count values
+// in all) can be added to integer partial sums without overflow, and if so,
+// account for their magnitude in the block. Floating point always fits.
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::admit(const part *p, size_t count,
+                                        size_t traces)
+{
+    if (!numeric_limits<part>::is_integer)
+        return true;
+
+    part mag = m_mag;
+    for (size_t i = 0; i < count; ++i)
+        mag = max(mag, (p[i] < 0) ? (part)-p[i] : p[i]);
+
+    // bound the sums of squared samples, weighted samples and squared weights
+    const double top = numeric_limits<part>::max();
+    const double n = m_pending + traces, m = mag, w = m_wmax;
+    if (n * m * max(m, w) > top || n * w * w > top)
+        return false;
+
+    m_mag = mag;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Accumulate pt directly into the sums, for a trace whose samples are too
+// large to be accumulated into the partial sums at all.
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::accumulate_wide(const trace &pt)
+{
+    const part *p = power_samples(pt, &m_bp[0]);
+    for (size_t s = 0; s < m_nevents; ++s) {
+        m_t1[s] += p[s];
+        m_t2[s] += (sum)p[s] * p[s];
+    }
+
+    m_bw.resize(m_rows);
+    compute_weights(pt, &m_bw[0], 1);
+
+    for (size_t k = 0; k < m_rows; ++k) {
+        const sum fw = m_bw[k];
+        sum *tw = &m_tw[k * m_nevents];
+        m_w1[k] += fw;
+        m_w2[k] += fw * fw;
+        for (size_t s = 0; s < m_nevents; ++s)
+            tw[s] += fw * p[s];
+    }
+
+    ++m_traces;
+}
+
+// -----------------------------------------------------------------------------
+// Parse a list of values separated by '+', where each value may be a range
+// of the form 'first-last' (for example, "0-3+8" is 0, 1, 2, 3 and 8).
+static bool parse_list(const string &str, vector<unsigned int> &values)
+{
+    foreach (const string &item, util::split(str, "+")) {
+        unsigned int first = 0, last = 0;
+        const int n = sscanf(item.c_str(), "%u-%u", &first, &last);
+        if (n < 1 || (n == 2 && last < first))
+            return false;
+
+        for (unsigned int v = first; v <= (n == 2 ? last : first); ++v)
+            values.push_back(v);
+    }
+    return !values.empty();
+}
+
+// -----------------------------------------------------------------------------
+// Build the list of targets as every combination of the key bytes ('bytes' or
+// 'byte'), bit windows ('windows' as offset:bits, or 'offset' and 'bits') and
+// leakage models ('models', or the crypto selected for the attack).
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::parse_targets(crypto_instance *crypto,
+                                     const parameters &params)
+{
+    vector<unsigned int> bytes;
+    if (!parse_list(params["bytes"].length() ? params["bytes"]
+                                             : params["byte"], bytes)) {
+        fprintf(stderr, "invalid or missing key byte list\n");
+        return false;
+    }
+
+    vector<pair<unsigned int, unsigned int> > windows;
+    if (params["windows"].length()) {
+        foreach (const string &item, util::split(params["windows"], "+")) {
+            unsigned int offset = 0, bits = 0;
+            if (sscanf(item.c_str(), "%u:%u", &offset, &bits) != 2) {
+                fprintf(stderr, "invalid bit window: %s\n", item.c_str());
+                return false;
+            }
+            windows.push_back(make_pair(offset, bits));
+        }
+    }
+    else {
+        unsigned int offset = 0, bits = 0;
+        if (!params.get("offset", offset) || !params.get("bits", bits)) {
+            fprintf(stderr, "required parameters: offset, bits\n");
+            return false;
+        }
+        windows.push_back(make_pair(offset, bits));
+    }
+
+    vector<pair<string, crypto_instance *> > models;
+    if (params["models"].length()) {
+        foreach (const string &name, util::split(params["models"], "+")) {
+            crypto_ptr model(attack_manager::create_crypto(name));
+            if (!model.get()) {
+                fprintf(stderr, "unknown leakage model: %s\n", name.c_str());
+                return false;
+            }
+
+            // every model must accept the same plaintext/ciphertext blocks
+            if (model->block_bits() != crypto->block_bits()) {
+                fprintf(stderr, "model %s has a different block size than "
+                                "the attack crypto\n", name.c_str());
+                return false;
+            }
+
+            m_models.push_back(model);
+            models.push_back(make_pair(name, model.get()));
+        }
+    }
+    else {
+        models.push_back(make_pair(params["crypto"], crypto));
+    }
+
+    m_targets.clear();
+    m_rows = 0;
+
+    for (size_t m = 0; m < models.size(); ++m) {
+        for (size_t w = 0; w < windows.size(); ++w) {
+            foreach (unsigned int byte, bytes) {
+                target t;
+                t.crypto = models[m].second;
+                t.byte = byte;
+                t.mask = 0;
+                for (unsigned int i = 0; i < windows[w].second; ++i)
+                    t.mask |= 1 << (windows[w].first + i);
+                t.center = windows[w].second >> 1;
+                t.guesses = 1 << t.crypto->estimate_bits();
+                t.row = m_rows;
+
+                ostringstream oss;
+                oss << models[m].first << "_byte" << byte << "_off"
+                    << windows[w].first << "_bits" << windows[w].second;
+                t.name = oss.str();
+
+                m_targets.push_back(t);
+                m_rows += t.guesses;
+            }
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::setup(crypto_instance *crypto, const parameters &params)
 {
     if (!params.get("num_events", m_nevents) ||
-        !params.get("num_reports", m_nreports) ||
-        !params.get("byte", m_byte) ||
-        !params.get("offset", m_offset) ||
-        !params.get("bits", m_bits)) {
-        fprintf(stderr, "required parameters: byte, offset, bits\n");
+        !params.get("num_reports", m_nreports)) {
+        fprintf(stderr, "required parameters: num_events, num_reports\n");
+        return false;
+    }
+
+    // integer samples are only exact if they are the levels of the scope
+    unsigned int integer = 0;
+    params.get("integer", integer);
+    if (numeric_limits<part>::is_integer && !integer) {
+        fprintf(stderr, "integer samples need an integer dataset "
+                        "(a packed8 or packed16 trace file)\n");
         return false;
     }
 
-    m_mask = 0;
-    for (unsigned int i = m_offset; i < (m_offset + m_bits); ++i)
-        m_mask |= 1 << i;
+    if (!parse_targets(crypto, params))
+        return false;
 
     m_crypto = crypto;
-    m_guesses = 1 << m_crypto->estimate_bits();
-    m_center = m_bits >> 1;
+    m_selected = 0;
     m_traces = 0;
 
     // allocate storage for intermediate results in advance
     m_t1.resize(m_nevents, 0);
     m_t2.resize(m_nevents, 0);
-    m_w1.resize(m_guesses, 0);
-    m_w2.resize(m_guesses, 0);
-    m_tw.resize(m_guesses * m_nevents, 0);
-    m_dtemp.resize(m_guesses * m_nevents, 0);
-    m_maxes.resize(m_guesses * m_nreports, 0);
+    m_w1.resize(m_rows, 0);
+    m_w2.resize(m_rows, 0);
+    m_tw.resize(m_rows * m_nevents, 0);
+    m_bp.resize(m_nevents, 0);
+    m_maxes.resize(m_rows * m_nreports, 0);
+
+    // the weights are Hamming weights less the center of each bit window
+    m_wmax = 0;
+    foreach (const target &t, m_targets) {
+        const int bits = util::popcnt[t.mask];
+        m_wmax = max(m_wmax, (part)max(t.center, bits - t.center));
+    }
+
+    // accumulate in partial sums of the sample type if the sums are wider
+    m_block = 0;
+    m_pending = 0;
+    m_mag = 0;
+    if (sizeof(sum) > sizeof(part)) {
+        m_block = FOLD_BLOCK_TRACES;
+        params.get("block", m_block);
+        if (!m_block) {
+            fprintf(stderr, "block must be at least one trace\n");
+            return false;
+        }
+
+        m_p1.resize(m_nevents, 0);
+        m_p2.resize(m_nevents, 0);
+        m_pw1.resize(m_rows, 0);
+        m_pw2.resize(m_rows, 0);
+        m_ptw.resize(m_rows * m_nevents, 0);
+        m_ref.resize(m_nevents, 0);
+    }
 
     return true;
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::process(const time_map &tmap, const trace &pt)
+// Compute the weight of every key guess of every target for the message of
+// pt, storing the weight of row r at w[r * stride].
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::compute_weights(const trace &pt, part *w,
+                                                  size_t stride)
 {
-    boost::lock_guard<boost::mutex> lock(m_mutex);
+    foreach (crypto_ptr &model, m_models)
+        model->set_message(pt.text());
 
-    // accumulate power and power^2 for each sample
-    for (size_t s = 0; s < pt.size(); ++s) {
-        m_t1[tmap[s]] += pt[s].power;
-        m_t2[tmap[s]] += pt[s].power * pt[s].power;
+    foreach (const target &t, m_targets) {
+        m_values.resize(t.guesses);
+        t.crypto->compute_all(t.byte, &m_values[0]);
+
+        for (int k = 0; k < t.guesses; ++k) {
+            const int weight = util::popcnt[m_values[k] & t.mask] - t.center;
+            w[(t.row + k) * stride] = (part)weight;
+        }
     }
+}
 
-    for (int k = 0; k < m_guesses; ++k) {
-        const int target = m_crypto->compute(m_byte, k);
-        const int weight = util::popcnt[target & m_mask] - m_center;
-        real *tw = &m_tw[k * m_nevents], fw = (real)weight;
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if (m_block && !m_pending)
+        start_block(pt);
+
+    const part *p = m_block ? centered(pt, &m_bp[0])
+                            : power_samples(pt, &m_bp[0]);
+
+    // fold early if the trace could overflow the partial sums (the samples
+    // stay centered on the same reference after the fold)
+    if (m_block && !admit(p, m_nevents, 1)) {
+        fold();
+        if (!admit(p, m_nevents, 1)) {
+            accumulate_wide(pt);
+            return;
+        }
+    }
 
-        if (weight != 0) {
-            m_w1[k] += fw;
-            m_w2[k] += fw * fw;
+    part *w1 = accumulator(m_w1, m_pw1), *w2 = accumulator(m_w2, m_pw2);
+    part *tw = accumulator(m_tw, m_ptw);
 
-            for (size_t s = 0; s < pt.size(); ++s)
-                tw[tmap[s]] += pt[s].power * fw;
+    // accumulate power and power^2 for each sample
+    simd::add_sq(accumulator(m_t1, m_p1), accumulator(m_t2, m_p2), p,
+                 m_nevents);
+
+    m_bw.resize(m_rows);
+    compute_weights(pt, &m_bw[0], 1);
+
+    for (size_t k = 0; k < m_rows; ++k) {
+        const part fw = m_bw[k];
+        if (fw != 0) {
+            w1[k] += fw;
+            w2[k] += fw * fw;
+            simd::axpy(&tw[k * m_nevents], p, fw, m_nevents);
         }
     }
 
     ++m_traces;
+    if (m_block && ++m_pending >= m_block)
+        fold();
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::record_interval(size_t n)
+// Accumulate the batch as the product of the weight matrix (rows x batch)
+// and the power matrix (batch x events). The product is computed in tiles of
+// samples, so each tile of m_tw is reused across the whole batch.
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::process_batch(crypto_instance *crypto,
+                                     const vector<trace> &batch)
 {
+    const size_t nb = batch.size();
+
+    // collect the power samples and key guess weights for each trace
+    if (m_bp.size() < nb * m_nevents)
+        m_bp.resize(nb * m_nevents);
+    m_bw.resize(m_rows * nb);
+    m_brows.resize(nb);
+    if (m_block && !m_pending && nb)
+        start_block(batch.front());
+
+    for (size_t b = 0; b < nb; ++b) {
+        const trace &pt = batch[b];
+        m_brows[b] = m_block ? centered(pt, &m_bp[b * m_nevents])
+                             : power_samples(pt, &m_bp[b * m_nevents]);
+
+        crypto->set_message(pt.text());
+        compute_weights(pt, &m_bw[b], nb);
+    }
+
     boost::lock_guard<boost::mutex> lock(m_mutex);
 
-    // compute differentials and interval maxes
-    compute_diffs(&m_dtemp[0]);
+    // fold early if the batch could overflow the partial sums, and accumulate
+    // it trace by trace into the sums if it is too large even on its own
+    if (m_block && !admit(&m_bp[0], nb * m_nevents, nb)) {
+        fold();
+        if (!admit(&m_bp[0], nb * m_nevents, nb)) {
+            for (size_t b = 0; b < nb; ++b) {
+                crypto->set_message(batch[b].text());
+                accumulate_wide(batch[b]);
+            }
+            return;
+        }
+    }
 
-    real *m = &m_maxes[n * m_guesses];
-    for (int k = 0; k < m_guesses; ++k) {
-        const size_t off = k * m_nevents;
-        for (size_t i = 0; i < m_nevents; ++i)
-            m[k] = max(m[k], m_dtemp[off + i]);
+    part *t1 = accumulator(m_t1, m_p1), *t2 = accumulator(m_t2, m_p2);
+    part *w1 = accumulator(m_w1, m_pw1), *w2 = accumulator(m_w2, m_pw2);
+
+    // accumulate power and power^2 for each sample
+    for (size_t b = 0; b < nb; ++b)
+        simd::add_sq(t1, t2, m_brows[b], m_nevents);
+
+    for (size_t k = 0; k < m_rows; ++k) {
+        const part *w = &m_bw[k * nb];
+        for (size_t b = 0; b < nb; ++b) {
+            w1[k] += w[b];
+            w2[k] += w[b] * w[b];
+        }
+    }
+
+    for (size_t s0 = 0; s0 < m_nevents; s0 += BATCH_TILE_SAMPLES) {
+        const size_t s1 = min(m_nevents, s0 + BATCH_TILE_SAMPLES);
+
+        for (size_t k = 0; k < m_rows; ++k) {
+            const part *w = &m_bw[k * nb];
+            part *tw = accumulator(m_tw, m_ptw) + k * m_nevents;
+
+            for (size_t b = 0; b < nb; ++b) {
+                const part fw = w[b];
+                if (fw == 0) continue;
+
+                simd::axpy(tw + s0, m_brows[b] + s0, fw, s1 - s0);
+            }
+        }
     }
+
+    m_traces += nb;
+    if (m_block && (m_pending += nb) >= m_block)
+        fold();
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::clone(const attack_instance *inst)
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // only the interval maxes are kept, so the differentials are not stored
+    compute_diffs(NULL, &m_maxes[n * m_rows], 0, m_rows);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::clone(const attack_instance *inst)
 {
     attack_cpa *other = (attack_cpa *)inst;
     boost::lock_guard<boost::mutex> lock(other->m_mutex);
@@ -182,7 +725,8 @@ void attack_cpa<real>::clone(const attack_instance *inst)
     m_traces = other->m_traces;
     m_nevents = other->m_nevents;
     m_nreports = other->m_nreports;
-    m_guesses = other->m_guesses;
+    m_rows = other->m_rows;
+    m_targets = other->m_targets;
 
     m_t1 = other->m_t1;
     m_t2 = other->m_t2;
@@ -190,73 +734,189 @@ void attack_cpa<real>::clone(const attack_instance *inst)
     m_w2 = other->m_w2;
     m_tw = other->m_tw;
 
-    if (!m_maxes.size()) {
-        m_dtemp.resize(other->m_dtemp.size(), 0);
+    m_block = other->m_block;
+    m_pending = other->m_pending;
+    m_mag = other->m_mag;
+    m_wmax = other->m_wmax;
+    m_p1 = other->m_p1;
+    m_p2 = other->m_p2;
+    m_pw1 = other->m_pw1;
+    m_pw2 = other->m_pw2;
+    m_ptw = other->m_ptw;
+    m_ref = other->m_ref;
+
+    if (!m_maxes.size())
         m_maxes.resize(other->m_maxes.size(), 0);
-    }
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::coalesce(const attack_instance *inst)
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::coalesce(const attack_instance *inst)
 {
     attack_cpa *other = (attack_cpa *)inst;
     boost::lock_guard<boost::mutex> lock(other->m_mutex);
+    coalesce_range(inst, 0, m_nevents);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::coalesce_range(const attack_instance *inst,
+                                      size_t first, size_t last)
+{
+    const attack_cpa *other = (const attack_cpa *)inst;
+    const size_t count = last - first;
 
-    assert(m_guesses == other->m_guesses);
+    assert(m_rows == other->m_rows);
     assert(m_nevents == other->m_nevents);
+    assert(first <= last && last <= m_nevents);
 
-    m_traces += other->m_traces;
+    if (!first) {
+        m_traces += other->m_traces;
+        for (size_t k = 0; k < m_rows; ++k) {
+            m_w1[k] += other->m_w1[k];
+            m_w2[k] += other->m_w2[k];
+        }
+    }
 
-    for (size_t s = 0; s < m_nevents; ++s) {
-        m_t1[s] += other->m_t1[s];
-        m_t2[s] += other->m_t2[s];
+    if (count) {
+        simd::add(&m_t1[first], &other->m_t1[first], count);
+        simd::add(&m_t2[first], &other->m_t2[first], count);
+        for (size_t k = 0; k < m_rows; ++k) {
+            const size_t off = k * m_nevents + first;
+            simd::add(&m_tw[off], &other->m_tw[off], count);
+        }
     }
 
-    for (int k = 0; k < m_guesses; ++k) {
-        m_w1[k] += other->m_w1[k];
-        m_w2[k] += other->m_w2[k];
+    // the partial sums of the other instance are added to these sums, so
+    // that it is left untouched
+    add_partial(other, first, last);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
 
-        real *dst = &m_tw[k * m_nevents];
-        const real *src = &other->m_tw[k * m_nevents];
-        for (size_t s = 0; s < m_nevents; ++s) dst[s] += src[s];
+    m_traces = 0;
+    fill(m_t1.begin(), m_t1.end(), 0);
+    fill(m_t2.begin(), m_t2.end(), 0);
+    fill(m_w1.begin(), m_w1.end(), 0);
+    fill(m_w2.begin(), m_w2.end(), 0);
+    fill(m_tw.begin(), m_tw.end(), 0);
+    clear_partial();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    fold();
+
+    write_value<uint32_t>(os, sizeof(sum));
+    write_value<uint64_t>(os, m_traces);
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_rows);
+
+    write_vector(os, m_t1);
+    write_vector(os, m_t2);
+    write_vector(os, m_w1);
+    write_vector(os, m_w2);
+    write_vector(os, m_tw);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint32_t size = 0;
+    uint64_t traces = 0, nevents = 0, rows = 0;
+    if (!read_value(is, size) || size != sizeof(sum) ||
+        !read_value(is, traces) || !read_value(is, nevents) ||
+        !read_value(is, rows) || !rows) {
+        return false;
+    }
+
+    if (!read_vector(is, m_t1) || !read_vector(is, m_t2) ||
+        !read_vector(is, m_w1) || !read_vector(is, m_w2) ||
+        !read_vector(is, m_tw) || !read_vector(is, m_maxes)) {
+        return false;
     }
+
+    m_traces = traces;
+    m_nevents = nevents;
+    m_rows = rows;
+    m_nreports = m_maxes.size() / m_rows;
+
+    // the partial sums were folded before the state was saved
+    clear_partial();
+
+    return m_t1.size() == m_nevents && m_t2.size() == m_nevents &&
+           m_w1.size() == m_rows && m_w2.size() == m_rows &&
+           m_tw.size() == m_rows * m_nevents;
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::get_diffs(vector<double> &diffs)
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::select_target(size_t t, string &name, int &guesses)
 {
-    compute_diffs(&m_dtemp[0]);
+    m_selected = t;
+    name = m_targets[t].name;
+    guesses = m_targets[t].guesses;
+}
 
-    diffs.resize(m_guesses * m_nevents);
-    for (size_t i = 0; i < m_guesses * m_nevents; ++i)
-        diffs[i] = m_dtemp[i];
+// -----------------------------------------------------------------------------
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::get_diffs(vector<double> &diffs)
+{
+    const target &t = m_targets[m_selected];
+    const size_t n = t.guesses * m_nevents;
+
+    // double precision differentials are computed in place
+    diffs.resize(n);
+    real *d = staging(&diffs[0], n, m_dtemp);
+    compute_diffs(d, NULL, t.row, t.guesses);
+    if ((void *)d != (void *)&diffs[0])
+        copy(d, d + n, diffs.begin());
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::get_maxes(vector<double> &maxes)
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::get_maxes(vector<double> &maxes)
 {
-    maxes.resize(m_guesses * m_nreports);
-    for (size_t i = 0; i < m_guesses * m_nreports; ++i)
-        maxes[i] = m_maxes[i];
+    const target &t = m_targets[m_selected];
+
+    maxes.resize(t.guesses * m_nreports);
+    for (size_t n = 0; n < m_nreports; ++n) {
+        for (int k = 0; k < t.guesses; ++k)
+            maxes[n * t.guesses + k] = m_maxes[n * m_rows + t.row + k];
+    }
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-void attack_cpa<real>::write_results(const string &path)
+template <typename real, typename sum, typename part>
+void attack_cpa<real, sum, part>::write_results(const string &path)
 {
 }
 
 // -----------------------------------------------------------------------------
-template <typename real>
-bool attack_cpa<real>::cleanup()
+template <typename real, typename sum, typename part>
+bool attack_cpa<real, sum, part>::cleanup()
 {
     return true;
 }
 
+typedef attack_cpa<float, double> attack_cpa_fold;
+typedef attack_cpa<double, int64_t, int32_t> attack_cpa_int;
+
 register_attack(cpa, attack_cpa<float>);
 register_attack(cpa_dp, attack_cpa<double>);
 register_attack(cpa_ldp, attack_cpa<long double>);
-
+register_attack(cpa_fold, attack_cpa_fold);
+register_attack(cpa_int, attack_cpa_int);
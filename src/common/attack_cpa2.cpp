@@ -0,0 +1,783 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
+#include "attack_engine.h"
+#include "attack_manager.h"
+#include "simd.h"
+
+using namespace std;
+using namespace util;
+
+// number of sample pairs per tile when merging a block of traces
+#define BATCH_TILE_PAIRS 512
+
+// number of traces buffered before their moments are merged
+#define PENDING_TRACES 256
+
+// largest number of sums kept for every key guess and pair
+#define MAX_PAIR_SUMS (1 << 28)
+
+// -----------------------------------------------------------------------------
+// Second-order correlation power analysis, for implementations where each
+// sensitive value is split by a random mask. The leakage of two samples is
+// combined by their centered product (x_i - mean_i) * (x_j - mean_j), which
+// is correlated with the weight of the unmasked value. Every pair of samples
+// at most 'window' samples apart is attacked; a sum is kept for every pair and
+// key guess, so the window is required and the number of sums is bounded.
+//
+// The means of the samples and weights are kept with their central moment and
+// co-moment sums, up to the fourth order of each pair, from which the
+// correlation of the centered product follows directly. The moments of each
+// block of buffered traces are taken about the block mean and merged with the
+// pairwise formulas of Pebay, which also merge two instances. Pairs are
+// processed in tiles, so that the products of a tile are reused by every key
+// guess while they are in cache.
+template <typename real>
+class attack_cpa2: public attack_instance {
+public:
+    attack_cpa2();
+    virtual ~attack_cpa2();
+
+    virtual bool setup(crypto_instance *crypto, const parameters &params);
+    virtual void process(const trace &pt);
+    virtual void process_batch(crypto_instance *crypto,
+                               const vector<trace> &batch);
+    virtual void record_interval(size_t n);
+    virtual void clone(const attack_instance *inst);
+    virtual void coalesce(const attack_instance *inst);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
+    virtual void write_results(const string &path);
+    virtual bool cleanup();
+
+    virtual void get_diffs(vector<double> &diffs);
+    virtual void get_maxes(vector<double> &maxes);
+
+protected:
+    // moments of a set of traces to be merged, where the pair moments start
+    // at the first pair merged and the guesses of hcc are 'stride' apart
+    struct moments {
+        real n;
+        const real *mean, *m2, *hmean, *hm2, *hc;
+        const real *c, *ciij, *cijj, *ciijj, *hcc;
+        size_t stride;
+    };
+
+    void make_pairs(void);
+    void compute_weights(real *w, size_t stride);
+    void buffer(const trace &pt);
+    void flush(void);
+    void accumulate(size_t nb);
+    void prepare(const moments &b);
+    void merge_pairs(const moments &b, size_t p0, size_t len);
+    void merge_samples(const moments &b);
+    void compute_diffs(real *d, real *m, vector<pair<size_t, real> > *best);
+
+    crypto_instance *m_crypto;
+    size_t m_traces;  // traces merged into the moments
+    size_t m_pending; // traces buffered since the last merge
+    size_t m_nevents;
+    size_t m_nreports;
+    size_t m_npairs;
+    size_t m_window;  // largest distance between the samples of a pair
+    unsigned int m_mask, m_byte;
+    int m_guesses;
+    int m_center;
+    vector<uint32_t> m_pi, m_pj; // samples of each pair
+    vector<real> m_mean;  // mean of each sample
+    vector<real> m_m2;    // sum of (x - mean)^2 of each sample
+    vector<real> m_c;     // sum of (x_i - mean_i)(x_j - mean_j) of each pair
+    vector<real> m_ciij;  // sum of (x_i - mean_i)^2 (x_j - mean_j)
+    vector<real> m_cijj;  // sum of (x_i - mean_i)(x_j - mean_j)^2
+    vector<real> m_ciijj; // sum of (x_i - mean_i)^2 (x_j - mean_j)^2
+    vector<real> m_hmean; // mean weight of each guess
+    vector<real> m_hm2;   // sum of (h - mean)^2 of each guess
+    vector<real> m_hc;    // co-moment of weight and sample (guesses x events)
+    vector<real> m_hcc;   // co-moment of weight and product (guesses x pairs)
+    vector<real> m_maxes;
+    vector<real> m_bp;    // buffered samples (PENDING_TRACES x events)
+    vector<real> m_bw;    // buffered weights (guesses x PENDING_TRACES)
+    vector<real> m_bz;    // products of one tile of pairs (block x tile)
+    vector<real> m_bshift; // offset of the buffered samples
+    vector<real> m_bmean, m_bm2, m_bhmean, m_bhm2, m_bhc; // block moments
+    vector<real> m_bc, m_biij, m_bijj, m_biijj, m_bhcc; // ... of a tile
+    vector<real> m_ds, m_dh, m_dhc; // differences of the merged moments
+    vector<real> m_cm, m_cs; // per pair scratch of a tile
+    vector<int> m_values;
+    boost::mutex m_mutex;
+};
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_cpa2<real>::attack_cpa2()
+: m_traces(0), m_pending(0), m_npairs(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_cpa2<real>::~attack_cpa2()
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa2<real>::setup(crypto_instance *crypto, const parameters &params)
+{
+    unsigned int offset = 0, bits = 0;
+    if (!params.get("num_events", m_nevents) ||
+        !params.get("num_reports", m_nreports) ||
+        !params.get("byte", m_byte) ||
+        !params.get("offset", offset) ||
+        !params.get("bits", bits) ||
+        !params.get("window", m_window)) {
+        fprintf(stderr, "required parameters: byte, offset, bits, window\n");
+        return false;
+    }
+
+    // a thread of split mode sees only its own samples, and so would miss
+    // every pair that crosses into the samples of another thread
+    unsigned int split = 0;
+    if (params.get("split", split) && split) {
+        fprintf(stderr, "cpa2 cannot split the samples across threads\n");
+        return false;
+    }
+
+    if (!m_window || m_nevents < 2) {
+        fprintf(stderr, "a pair needs two samples at most 'window' apart\n");
+        return false;
+    }
+
+    m_mask = 0;
+    for (unsigned int i = offset; i < (offset + bits); ++i)
+        m_mask |= 1 << i;
+
+    m_crypto = crypto;
+    m_guesses = 1 << m_crypto->estimate_bits();
+    m_center = bits >> 1;
+    m_traces = 0;
+    m_pending = 0;
+
+    // there are n - d pairs of samples d apart, for every d up to the window
+    const uint64_t w = min<uint64_t>(m_window, m_nevents - 1);
+    const uint64_t npairs = w * m_nevents - w * (w + 1) / 2;
+    if (npairs * m_guesses > MAX_PAIR_SUMS) {
+        fprintf(stderr, "%llu pairs of samples for %d key guesses need too "
+                "much memory, use a smaller window or fewer samples\n",
+                (unsigned long long)npairs, m_guesses);
+        return false;
+    }
+
+    make_pairs();
+
+    // allocate storage for intermediate results in advance
+    m_mean.resize(m_nevents, 0);
+    m_m2.resize(m_nevents, 0);
+    m_c.resize(m_npairs, 0);
+    m_ciij.resize(m_npairs, 0);
+    m_cijj.resize(m_npairs, 0);
+    m_ciijj.resize(m_npairs, 0);
+    m_hmean.resize(m_guesses, 0);
+    m_hm2.resize(m_guesses, 0);
+    m_hc.resize(m_guesses * m_nevents, 0);
+    m_hcc.resize(m_guesses * m_npairs, 0);
+    m_maxes.resize(m_guesses * m_nreports, 0);
+    m_bp.resize(PENDING_TRACES * m_nevents);
+    m_bw.resize(m_guesses * PENDING_TRACES);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// List every pair of samples at most m_window samples apart.
+template <typename real>
+void attack_cpa2<real>::make_pairs(void)
+{
+    m_pi.clear();
+    m_pj.clear();
+    for (size_t i = 0; i < m_nevents; ++i) {
+        for (size_t j = i + 1; j < m_nevents && j - i <= m_window; ++j) {
+            m_pi.push_back(i);
+            m_pj.push_back(j);
+        }
+    }
+    m_npairs = m_pi.size();
+}
+
+// -----------------------------------------------------------------------------
+// Compute the weight of every key guess for the current message of the
+// crypto, storing the weight of guess k at w[k * stride].
+template <typename real>
+void attack_cpa2<real>::compute_weights(real *w, size_t stride)
+{
+    m_values.resize(m_guesses);
+    m_crypto->compute_all(m_byte, &m_values[0]);
+
+    for (int k = 0; k < m_guesses; ++k) {
+        const int weight = util::popcnt[m_values[k] & m_mask] - m_center;
+        w[k * stride] = (real)weight;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Buffer the samples and weights of a trace whose message has been given to
+// the crypto, merging the buffer once it is full.
+template <typename real>
+void attack_cpa2<real>::buffer(const trace &pt)
+{
+    real *row = &m_bp[m_pending * m_nevents];
+    const real *p = power_samples(pt, row);
+    if (p != row) copy(p, p + m_nevents, row);
+
+    compute_weights(&m_bw[m_pending], PENDING_TRACES);
+    if (++m_pending == PENDING_TRACES)
+        flush();
+}
+
+// -----------------------------------------------------------------------------
+// Merge the moments of the buffered traces, before the moments are read.
+template <typename real>
+void attack_cpa2<real>::flush(void)
+{
+    if (m_pending) accumulate(m_pending);
+    m_pending = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Take the moments of the first nb buffered traces about their own means, and
+// merge them one tile of pairs at a time.
+template <typename real>
+void attack_cpa2<real>::accumulate(size_t nb)
+{
+    const real ni = (real)1 / nb;
+
+    // the samples, centered on their mean; they are first offset by the
+    // running mean, or the first trace, so that the sum of the block does not
+    // lose the precision of the deviations
+    m_bshift.assign(m_bp.begin(), m_bp.begin() + m_nevents);
+    if (m_traces) m_bshift = m_mean;
+    m_bmean.assign(m_nevents, 0);
+    m_bm2.assign(m_nevents, 0);
+    for (size_t b = 0; b < nb; ++b) {
+        real *x = &m_bp[b * m_nevents];
+        simd::axpy(x, &m_bshift[0], (real)-1, m_nevents);
+        simd::add(&m_bmean[0], x, m_nevents);
+    }
+    for (size_t s = 0; s < m_nevents; ++s)
+        m_bmean[s] *= ni;
+    for (size_t b = 0; b < nb; ++b) {
+        real *x = &m_bp[b * m_nevents];
+        simd::axpy(x, &m_bmean[0], (real)-1, m_nevents);
+        for (size_t s = 0; s < m_nevents; ++s)
+            m_bm2[s] += x[s] * x[s];
+    }
+    simd::add(&m_bmean[0], &m_bshift[0], m_nevents);
+
+    // the weights, and their co-moments with the samples; the centered
+    // samples sum to zero, so the weights need not be centered for these
+    m_bhmean.resize(m_guesses);
+    m_bhm2.resize(m_guesses);
+    m_bhc.assign(m_guesses * m_nevents, 0);
+    for (int k = 0; k < m_guesses; ++k) {
+        const real *w = &m_bw[k * PENDING_TRACES];
+        real *hc = &m_bhc[k * m_nevents];
+        real h1 = 0, h2 = 0;
+        for (size_t b = 0; b < nb; ++b) {
+            h1 += w[b];
+            if (w[b] != 0)
+                simd::axpy(hc, &m_bp[b * m_nevents], w[b], m_nevents);
+        }
+        h1 *= ni;
+        for (size_t b = 0; b < nb; ++b)
+            h2 += (w[b] - h1) * (w[b] - h1);
+        m_bhmean[k] = h1;
+        m_bhm2[k] = h2;
+    }
+
+    moments mb;
+    mb.n = nb;
+    mb.mean = &m_bmean[0];
+    mb.m2 = &m_bm2[0];
+    mb.hmean = &m_bhmean[0];
+    mb.hm2 = &m_bhm2[0];
+    mb.hc = &m_bhc[0];
+    prepare(mb);
+
+    // then the products of each tile of pairs, and their moments
+    m_bz.resize(nb * BATCH_TILE_PAIRS);
+    m_bhcc.resize(m_guesses * BATCH_TILE_PAIRS);
+    for (size_t p0 = 0; p0 < m_npairs; p0 += BATCH_TILE_PAIRS) {
+        const size_t len = min(m_npairs, p0 + BATCH_TILE_PAIRS) - p0;
+        const uint32_t *pi = &m_pi[p0], *pj = &m_pj[p0];
+
+        m_bc.assign(len, 0);
+        m_biij.assign(len, 0);
+        m_bijj.assign(len, 0);
+        m_biijj.assign(len, 0);
+        for (size_t b = 0; b < nb; ++b) {
+            const real *x = &m_bp[b * m_nevents];
+            real *z = &m_bz[b * len];
+            for (size_t p = 0; p < len; ++p) {
+                const real xi = x[pi[p]], xj = x[pj[p]], zp = xi * xj;
+                z[p] = zp;
+                m_bc[p] += zp;
+                m_biij[p] += zp * xi;
+                m_bijj[p] += zp * xj;
+                m_biijj[p] += zp * zp;
+            }
+        }
+
+        // the products sum to m_bc, which centers the weights
+        for (int k = 0; k < m_guesses; ++k) {
+            const real *w = &m_bw[k * PENDING_TRACES];
+            real *f = &m_bhcc[k * len];
+            fill(f, f + len, 0);
+            for (size_t b = 0; b < nb; ++b) {
+                if (w[b] != 0) simd::axpy(f, &m_bz[b * len], w[b], len);
+            }
+            simd::axpy(f, &m_bc[0], -m_bhmean[k], len);
+        }
+
+        mb.c = &m_bc[0];
+        mb.ciij = &m_biij[0];
+        mb.cijj = &m_bijj[0];
+        mb.ciijj = &m_biijj[0];
+        mb.hcc = &m_bhcc[0];
+        mb.stride = len;
+        merge_pairs(mb, p0, len);
+    }
+
+    merge_samples(mb);
+}
+
+// -----------------------------------------------------------------------------
+// Compute the differences of the means of b from those of this instance, and
+// the terms of the weight co-moments that every pair shares.
+template <typename real>
+void attack_cpa2<real>::prepare(const moments &b)
+{
+    const real na = m_traces, nb = b.n, n = na + nb;
+    const real fa = na / n, fb = nb / n;
+
+    m_ds.resize(m_nevents);
+    for (size_t s = 0; s < m_nevents; ++s)
+        m_ds[s] = b.mean[s] - m_mean[s];
+
+    m_dh.resize(m_guesses);
+    for (int k = 0; k < m_guesses; ++k)
+        m_dh[k] = b.hmean[k] - m_hmean[k];
+
+    m_dhc.resize(m_guesses * m_nevents);
+    for (size_t i = 0; i < m_guesses * m_nevents; ++i)
+        m_dhc[i] = fa * b.hc[i] - fb * m_hc[i];
+}
+
+// -----------------------------------------------------------------------------
+// Merge the pair moments of b into pairs [p0, p0 + len), with the pairwise
+// formulas for the co-moments of the centered variables u, v and w
+//
+//   C_uv = C_uvA + C_uvB + nA nB / n d_u d_v
+//   C_uvw = C_uvwA + C_uvwB + nA nB (nA - nB) / n^2 d_u d_v d_w
+//         + ((nA C_vwB - nB C_vwA) d_u + (nA C_uwB - nB C_uwA) d_v
+//            + (nA C_uvB - nB C_uvA) d_w) / n
+//
+// and for the fourth order sum of a pair
+//
+//   C_iijj = C_iijjA + C_iijjB
+//          + nA nB (nA^2 - nA nB + nB^2) / n^3 d_i^2 d_j^2
+//          + (nA^2 (C_iiB d_j^2 + C_jjB d_i^2 + 4 C_ijB d_i d_j)
+//             + nB^2 (C_iiA d_j^2 + C_jjA d_i^2 + 4 C_ijA d_i d_j)) / n^2
+//          + (2 d_j (nA C_iijB - nB C_iijA)
+//             + 2 d_i (nA C_ijjB - nB C_ijjA)) / n
+//
+// where d is the difference of the means. The sample and weight moments must
+// not be merged until every pair has been.
+template <typename real>
+void attack_cpa2<real>::merge_pairs(const moments &b, size_t p0, size_t len)
+{
+    const real na = m_traces, nb = b.n, n = na + nb;
+    const real fa = na / n, fb = nb / n;
+    const real k2 = na * fb, k3 = k2 * (na - nb) / n;
+    const real k4 = k2 * (na * na - na * nb + nb * nb) / (n * n);
+
+    // the weight co-moments, from the pair moments before they are merged
+    m_cm.resize(len);
+    m_cs.resize(len);
+    for (size_t p = 0; p < len; ++p) {
+        const size_t i = m_pi[p0 + p], j = m_pj[p0 + p];
+        const real di = m_ds[i], dj = m_ds[j];
+        m_cm[p] = fa * b.c[p] - fb * m_c[p0 + p] + k3 * di * dj;
+    }
+    for (int k = 0; k < m_guesses; ++k) {
+        const real dh = m_dh[k];
+        const real *bf = &b.hcc[k * b.stride], *v = &m_dhc[k * m_nevents];
+        real *f = &m_hcc[k * m_npairs + p0];
+        for (size_t p = 0; p < len; ++p) {
+            const size_t i = m_pi[p0 + p], j = m_pj[p0 + p];
+            f[p] += bf[p] + dh * m_cm[p] + v[j] * m_ds[i] + v[i] * m_ds[j];
+        }
+    }
+
+    for (size_t p = 0; p < len; ++p) {
+        const size_t i = m_pi[p0 + p], j = m_pj[p0 + p];
+        const real di = m_ds[i], dj = m_ds[j], di2 = di * di, dj2 = dj * dj;
+        const real ca = m_c[p0 + p], cb = b.c[p];
+        const real u = fa * cb - fb * ca;
+
+        m_ciijj[p0 + p] += b.ciijj[p] + k4 * di2 * dj2 +
+            fa * fa * (b.m2[i] * dj2 + b.m2[j] * di2 + 4 * cb * di * dj) +
+            fb * fb * (m_m2[i] * dj2 + m_m2[j] * di2 + 4 * ca * di * dj) +
+            2 * dj * (fa * b.ciij[p] - fb * m_ciij[p0 + p]) +
+            2 * di * (fa * b.cijj[p] - fb * m_cijj[p0 + p]);
+        m_ciij[p0 + p] += b.ciij[p] + k3 * di2 * dj + 2 * u * di +
+                          (fa * b.m2[i] - fb * m_m2[i]) * dj;
+        m_cijj[p0 + p] += b.cijj[p] + k3 * di * dj2 + 2 * u * dj +
+                          (fa * b.m2[j] - fb * m_m2[j]) * di;
+        m_c[p0 + p] += cb + k2 * di * dj;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Merge the sample and weight moments of b, once its pairs have been merged.
+template <typename real>
+void attack_cpa2<real>::merge_samples(const moments &b)
+{
+    const real na = m_traces, nb = b.n, n = na + nb;
+    const real fb = nb / n, k2 = na * fb;
+
+    for (int k = 0; k < m_guesses; ++k) {
+        const real dh = m_dh[k];
+        const real *bhc = &b.hc[k * m_nevents];
+        real *hc = &m_hc[k * m_nevents];
+        for (size_t s = 0; s < m_nevents; ++s)
+            hc[s] += bhc[s] + k2 * dh * m_ds[s];
+
+        m_hm2[k] += b.hm2[k] + k2 * dh * dh;
+        m_hmean[k] += fb * dh;
+    }
+
+    for (size_t s = 0; s < m_nevents; ++s) {
+        m_m2[s] += b.m2[s] + k2 * m_ds[s] * m_ds[s];
+        m_mean[s] += fb * m_ds[s];
+    }
+
+    m_traces += (size_t)nb;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa2<real>::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    buffer(pt);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa2<real>::process_batch(crypto_instance *crypto,
+                                      const vector<trace> &batch)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    for (size_t b = 0; b < batch.size(); ++b) {
+        crypto->set_message(batch[b].text());
+        buffer(batch[b]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Compute the correlation of every pair with every key guess. For each guess,
+// the largest correlation of any pair with each sample is stored in d, the
+// interval max m is raised, and the pair with the largest correlation and
+// that correlation are stored in best. Any of d, m and best may be NULL.
+//
+// The correlations are compared by magnitude, as the centered product of a
+// masked value and its mask is negatively correlated with the weight of the
+// unmasked value.
+template <typename real>
+void attack_cpa2<real>::compute_diffs(real *d, real *m,
+                                      vector<pair<size_t, real> > *best)
+{
+    const real ni = (real)1 / m_traces;
+
+    if (d) fill(d, d + m_guesses * m_nevents, 0);
+    if (best) best->assign(m_guesses, make_pair(0, 0));
+    vector<real> top(m_guesses, 0);
+    if (!m_traces) return;
+
+    // the deviation of the centered product of each pair
+    m_cs.resize(m_npairs);
+    for (size_t p = 0; p < m_npairs; ++p) {
+        const real ec = m_c[p] * ni, vc = m_ciijj[p] * ni - ec * ec;
+        m_cs[p] = util::nonzero(vc) && vc > 0 ? sqrt(vc) : 0;
+    }
+
+    for (int k = 0; k < m_guesses; ++k) {
+        const real vh = m_hm2[k] * ni;
+        if (!util::nonzero(vh) || vh < 0) continue;
+
+        const real sh = sqrt(vh);
+        const real *f = &m_hcc[k * m_npairs];
+        for (size_t p = 0; p < m_npairs; ++p) {
+            if (m_cs[p] == 0) continue;
+
+            const real rho = f[p] * ni / (sh * m_cs[p]);
+            if (d) {
+                real *di = &d[k * m_nevents + m_pi[p]];
+                real *dj = &d[k * m_nevents + m_pj[p]];
+                if (fabs(rho) > fabs(*di)) *di = rho;
+                if (fabs(rho) > fabs(*dj)) *dj = rho;
+            }
+            if (fabs(rho) > top[k]) {
+                top[k] = fabs(rho);
+                if (best) (*best)[k] = make_pair(p, rho);
+            }
+        }
+    }
+
+    if (m) {
+        for (int k = 0; k < m_guesses; ++k)
+            m[k] = max(m[k], top[k]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa2<real>::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    flush();
+    compute_diffs(NULL, &m_maxes[n * m_guesses], NULL);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa2<real>::clone(const attack_instance *inst)
+{
+    attack_cpa2 *other = (attack_cpa2 *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+    other->flush();
+
+    m_traces = other->m_traces;
+    m_pending = 0;
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_npairs = other->m_npairs;
+    m_window = other->m_window;
+    m_guesses = other->m_guesses;
+
+    m_pi = other->m_pi;
+    m_pj = other->m_pj;
+    m_mean = other->m_mean;
+    m_m2 = other->m_m2;
+    m_c = other->m_c;
+    m_ciij = other->m_ciij;
+    m_cijj = other->m_cijj;
+    m_ciijj = other->m_ciijj;
+    m_hmean = other->m_hmean;
+    m_hm2 = other->m_hm2;
+    m_hc = other->m_hc;
+    m_hcc = other->m_hcc;
+
+    m_bp.resize(PENDING_TRACES * m_nevents);
+    m_bw.resize(m_guesses * PENDING_TRACES);
+
+    if (!m_maxes.size())
+        m_maxes.resize(other->m_maxes.size(), 0);
+}
+
+// -----------------------------------------------------------------------------
+// Merge the moments of another instance, with the same formulas as a block.
+template <typename real>
+void attack_cpa2<real>::coalesce(const attack_instance *inst)
+{
+    attack_cpa2 *other = (attack_cpa2 *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    assert(m_guesses == other->m_guesses);
+    assert(m_npairs == other->m_npairs);
+    other->flush();
+    flush();
+    if (!other->m_traces) return;
+
+    moments mb;
+    mb.n = other->m_traces;
+    mb.mean = &other->m_mean[0];
+    mb.m2 = &other->m_m2[0];
+    mb.hmean = &other->m_hmean[0];
+    mb.hm2 = &other->m_hm2[0];
+    mb.hc = &other->m_hc[0];
+    mb.c = &other->m_c[0];
+    mb.ciij = &other->m_ciij[0];
+    mb.cijj = &other->m_cijj[0];
+    mb.ciijj = &other->m_ciijj[0];
+    mb.hcc = &other->m_hcc[0];
+    mb.stride = m_npairs;
+
+    prepare(mb);
+    merge_pairs(mb, 0, m_npairs);
+    merge_samples(mb);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa2<real>::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    m_traces = 0;
+    m_pending = 0;
+    fill(m_mean.begin(), m_mean.end(), 0);
+    fill(m_m2.begin(), m_m2.end(), 0);
+    fill(m_c.begin(), m_c.end(), 0);
+    fill(m_ciij.begin(), m_ciij.end(), 0);
+    fill(m_cijj.begin(), m_cijj.end(), 0);
+    fill(m_ciijj.begin(), m_ciijj.end(), 0);
+    fill(m_hmean.begin(), m_hmean.end(), 0);
+    fill(m_hm2.begin(), m_hm2.end(), 0);
+    fill(m_hc.begin(), m_hc.end(), 0);
+    fill(m_hcc.begin(), m_hcc.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa2<real>::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    flush();
+
+    write_value<uint32_t>(os, sizeof(real));
+    write_value<uint64_t>(os, m_traces);
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_window);
+    write_value<int32_t>(os, m_guesses);
+
+    write_vector(os, m_mean);
+    write_vector(os, m_m2);
+    write_vector(os, m_c);
+    write_vector(os, m_ciij);
+    write_vector(os, m_cijj);
+    write_vector(os, m_ciijj);
+    write_vector(os, m_hmean);
+    write_vector(os, m_hm2);
+    write_vector(os, m_hc);
+    write_vector(os, m_hcc);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa2<real>::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint32_t size = 0;
+    uint64_t traces = 0, nevents = 0, window = 0;
+    int32_t guesses = 0;
+    if (!read_value(is, size) || size != sizeof(real) ||
+        !read_value(is, traces) || !read_value(is, nevents) ||
+        !read_value(is, window) || !read_value(is, guesses) ||
+        guesses <= 0 || !window) {
+        return false;
+    }
+
+    if (!read_vector(is, m_mean) || !read_vector(is, m_m2) ||
+        !read_vector(is, m_c) || !read_vector(is, m_ciij) ||
+        !read_vector(is, m_cijj) || !read_vector(is, m_ciijj) ||
+        !read_vector(is, m_hmean) || !read_vector(is, m_hm2) ||
+        !read_vector(is, m_hc) || !read_vector(is, m_hcc) ||
+        !read_vector(is, m_maxes)) {
+        return false;
+    }
+
+    m_traces = traces;
+    m_pending = 0;
+    m_nevents = nevents;
+    m_window = window;
+    m_guesses = guesses;
+    m_nreports = m_maxes.size() / m_guesses;
+    m_bp.resize(PENDING_TRACES * m_nevents);
+    m_bw.resize(m_guesses * PENDING_TRACES);
+    make_pairs();
+
+    return m_mean.size() == m_nevents && m_m2.size() == m_nevents &&
+           m_c.size() == m_npairs && m_ciij.size() == m_npairs &&
+           m_cijj.size() == m_npairs && m_ciijj.size() == m_npairs &&
+           m_hmean.size() == (size_t)m_guesses &&
+           m_hm2.size() == (size_t)m_guesses &&
+           m_hc.size() == m_guesses * m_nevents &&
+           m_hcc.size() == m_guesses * m_npairs;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa2<real>::get_diffs(vector<double> &diffs)
+{
+    vector<real> d(m_guesses * m_nevents);
+    flush();
+    compute_diffs(&d[0], NULL, NULL);
+    diffs.assign(d.begin(), d.end());
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa2<real>::get_maxes(vector<double> &maxes)
+{
+    maxes.resize(m_guesses * m_nreports);
+    for (size_t i = 0; i < m_guesses * m_nreports; ++i)
+        maxes[i] = m_maxes[i];
+}
+
+// -----------------------------------------------------------------------------
+// Write the pair of samples with the largest correlation for each key guess.
+template <typename real>
+void attack_cpa2<real>::write_results(const string &path)
+{
+    const string p_path = util::concat_name(path, "cpa2_pairs.csv");
+    ofstream fp(p_path.c_str());
+    if (!fp.is_open()) {
+        fprintf(stderr, "failed to open '%s' for writing\n", p_path.c_str());
+        return;
+    }
+    printf("writing %s ...\n", p_path.c_str());
+
+    vector<pair<size_t, real> > best;
+    flush();
+    compute_diffs(NULL, NULL, &best);
+
+    fp << "guess,first,second,correlation" << endl;
+    for (int k = 0; k < m_guesses; ++k) {
+        const size_t p = best[k].first;
+        fp << k << "," << m_pi[p] << "," << m_pj[p] << "," << best[k].second
+           << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa2<real>::cleanup()
+{
+    return true;
+}
+
+register_attack(cpa2, attack_cpa2<float>);
+register_attack(cpa2_dp, attack_cpa2<double>);
@@ -0,0 +1,393 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cmath>
+#include "attack_engine.h"
+#include "attack_manager.h"
+#include "simd.h"
+
+using namespace std;
+using namespace util;
+
+// maximum message partition size, beyond which the class sums are impractical
+#define MAX_PARTITION_BITS 12
+
+// -----------------------------------------------------------------------------
+// Correlation power analysis where traces are aggregated by message partition.
+// The weight of every key guess depends only on the partition of the message,
+// so each trace is added to a single class sum and the weighted sums for all
+// guesses are built from the class sums when the differentials are computed.
+template <typename real>
+class attack_cpa_class: public attack_instance {
+public:
+    attack_cpa_class();
+    virtual ~attack_cpa_class();
+
+    virtual bool setup(crypto_instance *crypto, const parameters &params);
+    virtual void process(const trace &pt);
+    virtual void record_interval(size_t n);
+    virtual void clone(const attack_instance *inst);
+    virtual void coalesce(const attack_instance *inst);
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
+    virtual void write_results(const string &path);
+    virtual bool cleanup();
+
+    virtual void get_diffs(vector<double> &diffs);
+    virtual void get_maxes(vector<double> &maxes);
+
+    virtual bool split_samples(void) const { return true; }
+
+protected:
+    void compute_diffs(real *d, real *m);
+
+    crypto_instance *m_crypto;
+    size_t m_traces;
+    size_t m_nevents;
+    size_t m_nreports;
+    size_t m_nclasses;
+    unsigned int m_mask, m_byte, m_offset, m_bits;
+    vector<real> m_t2;        // sum of squared traces
+    vector<real> m_ct;        // sum of traces for each class
+    vector<size_t> m_cn;      // number of traces in each class
+    vector<int> m_cw;         // weight of each guess for each class
+    vector<real> m_sd;        // standard deviation of each sample
+    vector<real> m_power;     // power samples, if converted
+    vector<real> m_dtemp;
+    vector<real> m_maxes;
+    int m_guesses;
+    int m_center;
+    boost::mutex m_mutex;
+};
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_cpa_class<real>::attack_cpa_class()
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_cpa_class<real>::~attack_cpa_class()
+{
+}
+
+// -----------------------------------------------------------------------------
+// Compute the differential of each key guess into d, and raise the interval
+// maxes m in the same pass. Either d or m may be NULL.
+template <typename real>
+void attack_cpa_class<real>::compute_diffs(real *d, real *m)
+{
+    const real ni = 1.0 / m_traces;
+
+    // reconstruct the sum of traces from the class sums
+    vector<real> t1(m_nevents, 0), tw(m_nevents);
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (m_cn[c]) simd::add(&t1[0], &m_ct[c * m_nevents], m_nevents);
+    }
+
+    // the trace variance is independent of the key guess
+    m_sd.resize(m_nevents);
+    for (size_t s = 0; s < m_nevents; ++s) {
+        const real tv = (m_t2[s] - t1[s] * t1[s] * ni) * ni;
+        m_sd[s] = util::nonzero(tv) ? sqrt(tv) : 0;
+    }
+
+    for (int k = 0; k < m_guesses; ++k) {
+        // reconstruct the weight sums and weighted trace sum for this guess
+        real w1 = 0, w2 = 0;
+        fill(tw.begin(), tw.end(), 0);
+
+        for (size_t c = 0; c < m_nclasses; ++c) {
+            const int weight = m_cw[c * m_guesses + k];
+            if (!m_cn[c] || weight == 0) continue;
+
+            const real fw = (real)weight;
+            w1 += fw * m_cn[c];
+            w2 += fw * fw * m_cn[c];
+
+            simd::axpy(&tw[0], &m_ct[c * m_nevents], fw, m_nevents);
+        }
+
+        const real hv = (w2 - w1 * w1 * ni) * ni;
+        real *dest = d ? &d[k * m_nevents] : NULL;
+        real mk = m ? m[k] : 0;
+
+        if (!util::nonzero(hv)) {
+            if (dest) fill(dest, dest + m_nevents, 0);
+            mk = max(mk, (real)0);
+        }
+        else {
+            mk = simd::correlate_max(dest, &tw[0], &t1[0], &m_sd[0], w1, ni,
+                                     (real)sqrt(hv), m_nevents, mk);
+        }
+
+        if (m) m[k] = mk;
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa_class<real>::setup(crypto_instance *crypto,
+                                   const parameters &params)
+{
+    if (!params.get("num_events", m_nevents) ||
+        !params.get("num_reports", m_nreports) ||
+        !params.get("byte", m_byte) ||
+        !params.get("offset", m_offset) ||
+        !params.get("bits", m_bits)) {
+        fprintf(stderr, "required parameters: byte, offset, bits\n");
+        return false;
+    }
+
+    if (crypto->partition_bits() > MAX_PARTITION_BITS) {
+        fprintf(stderr, "message partition too large (%d bits), use cpa\n",
+                crypto->partition_bits());
+        return false;
+    }
+
+    m_mask = 0;
+    for (unsigned int i = m_offset; i < (m_offset + m_bits); ++i)
+        m_mask |= 1 << i;
+
+    m_crypto = crypto;
+    m_guesses = 1 << m_crypto->estimate_bits();
+    m_nclasses = 1 << m_crypto->partition_bits();
+    m_center = m_bits >> 1;
+    m_traces = 0;
+
+    // allocate storage for intermediate results in advance
+    m_t2.resize(m_nevents, 0);
+    m_ct.resize(m_nclasses * m_nevents, 0);
+    m_cn.resize(m_nclasses, 0);
+    m_cw.resize(m_nclasses * m_guesses, 0);
+    m_power.resize(m_nevents, 0);
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+    m_maxes.resize(m_guesses * m_nreports, 0);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    const int c = m_crypto->partition(m_byte);
+
+    // compute the guess weights the first time this class is encountered
+    if (!m_cn[c]) {
+        int *cw = &m_cw[c * m_guesses];
+        m_crypto->compute_all(m_byte, cw);
+        for (int k = 0; k < m_guesses; ++k)
+            cw[k] = util::popcnt[cw[k] & m_mask] - m_center;
+    }
+
+    // accumulate power into the class sum and power^2 for each sample
+    const real *p = power_samples(pt, &m_power[0]);
+    simd::add_sq(&m_ct[c * m_nevents], &m_t2[0], p, m_nevents);
+
+    ++m_cn[c];
+    ++m_traces;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // compute the interval maxes, without storing the differentials
+    compute_diffs(NULL, &m_maxes[n * m_guesses]);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::clone(const attack_instance *inst)
+{
+    attack_cpa_class *other = (attack_cpa_class *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    m_traces = other->m_traces;
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_nclasses = other->m_nclasses;
+    m_guesses = other->m_guesses;
+
+    m_t2 = other->m_t2;
+    m_ct = other->m_ct;
+    m_cn = other->m_cn;
+    m_cw = other->m_cw;
+
+    if (!m_maxes.size()) {
+        m_dtemp.resize(other->m_dtemp.size(), 0);
+        m_maxes.resize(other->m_maxes.size(), 0);
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::coalesce(const attack_instance *inst)
+{
+    attack_cpa_class *other = (attack_cpa_class *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+    coalesce_range(inst, 0, m_nevents);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::coalesce_range(const attack_instance *inst,
+                                            size_t first, size_t last)
+{
+    const attack_cpa_class *other = (const attack_cpa_class *)inst;
+    const size_t count = last - first;
+
+    assert(m_guesses == other->m_guesses);
+    assert(m_nevents == other->m_nevents);
+    assert(m_nclasses == other->m_nclasses);
+    assert(first <= last && last <= m_nevents);
+
+    if (count)
+        simd::add(&m_t2[first], &other->m_t2[first], count);
+
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (!other->m_cn[c]) continue;
+
+        if (count) {
+            const size_t off = c * m_nevents + first;
+            simd::add(&m_ct[off], &other->m_ct[off], count);
+        }
+        if (first) continue;
+
+        // adopt the guess weights if this class has not been seen locally
+        if (!m_cn[c]) {
+            for (int k = 0; k < m_guesses; ++k)
+                m_cw[c * m_guesses + k] = other->m_cw[c * m_guesses + k];
+        }
+        m_cn[c] += other->m_cn[c];
+    }
+
+    if (!first) m_traces += other->m_traces;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa_class<real>::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // the guess weights are recomputed when a class is next encountered
+    m_traces = 0;
+    fill(m_t2.begin(), m_t2.end(), 0);
+    fill(m_ct.begin(), m_ct.end(), 0);
+    fill(m_cn.begin(), m_cn.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa_class<real>::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    write_value<uint32_t>(os, sizeof(real));
+    write_value<uint64_t>(os, m_traces);
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_nclasses);
+    write_value<int32_t>(os, m_guesses);
+
+    write_vector(os, m_t2);
+    write_vector(os, m_ct);
+    write_vector(os, m_cn);
+    write_vector(os, m_cw);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa_class<real>::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint32_t size = 0;
+    uint64_t traces = 0, nevents = 0, nclasses = 0;
+    int32_t guesses = 0;
+    if (!read_value(is, size) || size != sizeof(real) ||
+        !read_value(is, traces) || !read_value(is, nevents) ||
+        !read_value(is, nclasses) || !read_value(is, guesses) ||
+        guesses <= 0) {
+        return false;
+    }
+
+    if (!read_vector(is, m_t2) || !read_vector(is, m_ct) ||
+        !read_vector(is, m_cn) || !read_vector(is, m_cw) ||
+        !read_vector(is, m_maxes)) {
+        return false;
+    }
+
+    m_traces = traces;
+    m_nevents = nevents;
+    m_nclasses = nclasses;
+    m_guesses = guesses;
+    m_nreports = m_maxes.size() / m_guesses;
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+
+    return m_t2.size() == m_nevents && m_ct.size() == m_nclasses * m_nevents &&
+           m_cn.size() == m_nclasses && m_cw.size() == m_nclasses * m_guesses;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::get_diffs(vector<double> &diffs)
+{
+    compute_diffs(&m_dtemp[0], NULL);
+
+    diffs.resize(m_guesses * m_nevents);
+    for (size_t i = 0; i < m_guesses * m_nevents; ++i)
+        diffs[i] = m_dtemp[i];
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::get_maxes(vector<double> &maxes)
+{
+    maxes.resize(m_guesses * m_nreports);
+    for (size_t i = 0; i < m_guesses * m_nreports; ++i)
+        maxes[i] = m_maxes[i];
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_cpa_class<real>::write_results(const string &path)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_cpa_class<real>::cleanup()
+{
+    return true;
+}
+
+register_attack(cpa_class, attack_cpa_class<float>);
+register_attack(cpa_class_dp, attack_cpa_class<double>);
+register_attack(cpa_class_ldp, attack_cpa_class<long double>);
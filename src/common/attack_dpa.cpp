@@ -18,6 +18,7 @@
 #include <cmath>
 #include "attack_engine.h"
 #include "attack_manager.h"
+#include "simd.h"
 
 using namespace std;
 
@@ -29,18 +30,25 @@ public:
     ~attack_dpa();
 
     virtual bool setup(crypto_instance *crypto, const util::parameters &params);
-    virtual void process(const time_map &tmap, const trace &pt);
+    virtual void process(const trace &pt);
     virtual void record_interval(size_t n);
     virtual void clone(const attack_instance *inst);
     virtual void coalesce(const attack_instance *inst);
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
     virtual void write_results(const string &path);
     virtual bool cleanup();
 
     virtual void get_diffs(vector<double> &diffs);
     virtual void get_maxes(vector<double> &maxes);
 
+    virtual bool split_samples(void) const { return true; }
+
 protected:
-    void compute_diffs(real *d);
+    void compute_diffs(real *d, real *m);
 
     size_t m_nevents;
     size_t m_nreports;
@@ -51,6 +59,8 @@ protected:
     vector<real> m_dtemp;   //!< temporary differential trace
     vector<real> m_diffs;   //!< positive and negative differentials
     vector<real> m_maxes;   //!< interval maxes for each report interval
+    vector<real> m_power;   //!< power samples, if converted
+    vector<int> m_values;   //!< sensitive value of each key guess
     crypto_instance *m_crypto;
     int m_guesses;
     boost::mutex m_mutex;
@@ -69,17 +79,19 @@ attack_dpa<real>::~attack_dpa()
 }
 
 // -----------------------------------------------------------------------------
+// Compute the differential of each key guess into d, and raise the interval
+// maxes m in the same pass. Either d or m may be NULL.
 template <typename real>
-void attack_dpa<real>::compute_diffs(real *d)
+void attack_dpa<real>::compute_diffs(real *d, real *m)
 {
-    for (size_t i = 0; i < m_nevents; ++i) {
-        for (int k = 0; k < m_guesses; ++k) {
-            const size_t i_off = k * m_nevents * 2 + i;
-            const size_t o_off = k * m_nevents + i;
-            const real a = m_diffs[i_off];
-            const real b = m_diffs[i_off + m_nevents];
-            d[o_off] = (b / m_binsz[k * 3 + 1]) - (a / m_binsz[k * 3]);
-        }
+    for (int k = 0; k < m_guesses; ++k) {
+        const real *a = &m_diffs[k * m_nevents * 2];
+        const real *b = a + m_nevents;
+        const real mk = simd::diff_means_max(d ? &d[k * m_nevents] : NULL,
+                                             a, (real)m_binsz[k * 3], b,
+                                             (real)m_binsz[k * 3 + 1],
+                                             m_nevents, m ? m[k] : 0);
+        if (m) m[k] = mk;
     }
 }
 
@@ -126,6 +138,8 @@ bool attack_dpa<real>::setup(crypto_instance *crypto,
 
     m_dtemp.resize(m_guesses * m_nevents, 0);
     m_diffs.resize(m_guesses * 2 * m_nevents, 0);
+    m_power.resize(m_nevents, 0);
+    m_values.resize(m_guesses, 0);
     m_binsz.resize(m_guesses * 3, 0);
     m_group.resize(m_guesses * 3 * m_nreports, 0);
     m_maxes.resize(m_guesses * m_nreports, 0);
@@ -135,13 +149,16 @@ bool attack_dpa<real>::setup(crypto_instance *crypto,
 
 // -----------------------------------------------------------------------------
 template <typename real>
-void attack_dpa<real>::process(const time_map &tmap, const trace &pt)
+void attack_dpa<real>::process(const trace &pt)
 {
     boost::lock_guard<boost::mutex> lock(m_mutex);
 
+    const real *p = power_samples(pt, &m_power[0]);
+
+    m_crypto->compute_all(m_byte, &m_values[0]);
+
     for (int k = 0; k < m_guesses; ++k) {
-        const unsigned int target = m_crypto->compute(m_byte, k);
-        const unsigned int weight = util::popcnt[target & m_mask];
+        const unsigned int weight = util::popcnt[m_values[k] & m_mask];
 
         int select = 2;
         if (weight <= m_min)
@@ -152,9 +169,7 @@ void attack_dpa<real>::process(const time_map &tmap, const trace &pt)
         ++m_binsz[k * 3 + select];
         if (select >= 2) continue;
 
-        real *d = &m_diffs[(k * 2 + select) * m_nevents];
-        for (size_t s = 0; s < pt.size(); ++s)
-            d[tmap[s]] += pt[s].power;
+        simd::add(&m_diffs[(k * 2 + select) * m_nevents], p, m_nevents);
     }
 }
 
@@ -168,12 +183,8 @@ void attack_dpa<real>::record_interval(size_t n)
     size_t *c = &m_group[n * m_guesses * 3];
     for (int i = 0; i < m_guesses * 3; ++i) c[i] = m_binsz[i];
 
-    // compute differentials and interval maxes
-    compute_diffs(&m_dtemp[0]);
-    real *m = &m_maxes[n * m_guesses];
-    for (size_t i = 0; i < m_nevents; ++i)
-        for (int k = 0; k < m_guesses; ++k)
-            m[k] = max(m[k], m_dtemp[k * m_nevents + i]);
+    // compute the interval maxes, without storing the differentials
+    compute_diffs(NULL, &m_maxes[n * m_guesses]);
 }
 
 // -----------------------------------------------------------------------------
@@ -200,31 +211,100 @@ void attack_dpa<real>::clone(const attack_instance *inst)
 template <typename real>
 void attack_dpa<real>::coalesce(const attack_instance *inst)
 {
-    const attack_dpa *other = (attack_dpa *)inst;
     boost::lock_guard<boost::mutex> lock(m_mutex);
+    coalesce_range(inst, 0, m_nevents);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_dpa<real>::coalesce_range(const attack_instance *inst,
+                                      size_t first, size_t last)
+{
+    const attack_dpa *other = (const attack_dpa *)inst;
+    const size_t count = last - first;
 
     assert(m_guesses == other->m_guesses);
     assert(m_nevents == other->m_nevents);
+    assert(first <= last && last <= m_nevents);
 
     for (int k = 0; k < m_guesses; ++k) {
         // accumulate bin sizes
-        for (int g = 0; g < 3; ++g)
-            m_binsz[k * 3 + g] += other->m_binsz[k * 3 + g];
+        if (!first) {
+            for (int g = 0; g < 3; ++g)
+                m_binsz[k * 3 + g] += other->m_binsz[k * 3 + g];
+        }
 
         // accumulate differentials
-        for (int g = 0; g < 2; ++g) {
-            const size_t noff = (k * 2 + g) * m_nevents;
-            for (size_t s = 0; s < m_nevents; ++s)
-                m_diffs[noff + s] += other->m_diffs[noff + s];
+        for (int g = 0; g < 2 && count; ++g) {
+            const size_t noff = (k * 2 + g) * m_nevents + first;
+            simd::add(&m_diffs[noff], &other->m_diffs[noff], count);
         }
     }
 }
 
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_dpa<real>::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    fill(m_binsz.begin(), m_binsz.end(), 0);
+    fill(m_diffs.begin(), m_diffs.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_dpa<real>::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    util::write_value<uint32_t>(os, sizeof(real));
+    util::write_value<uint64_t>(os, m_nevents);
+    util::write_value<int32_t>(os, m_guesses);
+
+    util::write_vector(os, m_binsz);
+    util::write_vector(os, m_group);
+    util::write_vector(os, m_diffs);
+    util::write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_dpa<real>::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint32_t size = 0;
+    uint64_t nevents = 0;
+    int32_t guesses = 0;
+    if (!util::read_value(is, size) || size != sizeof(real) ||
+        !util::read_value(is, nevents) || !util::read_value(is, guesses) ||
+        guesses <= 0) {
+        return false;
+    }
+
+    if (!util::read_vector(is, m_binsz) || !util::read_vector(is, m_group) ||
+        !util::read_vector(is, m_diffs) || !util::read_vector(is, m_maxes)) {
+        return false;
+    }
+
+    m_nevents = nevents;
+    m_guesses = guesses;
+    m_nreports = m_maxes.size() / m_guesses;
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+
+    return m_binsz.size() == (size_t)m_guesses * 3 &&
+           m_group.size() == m_guesses * 3 * m_nreports &&
+           m_diffs.size() == m_guesses * 2 * m_nevents;
+}
+
 // -----------------------------------------------------------------------------
 template <typename real>
 void attack_dpa<real>::get_diffs(vector<double> &diffs)
 {
-    compute_diffs(&m_dtemp[0]);
+    compute_diffs(&m_dtemp[0], NULL);
 
     diffs.resize(m_guesses * m_nevents);
     for (size_t i = 0; i < m_guesses * m_nevents; ++i)
@@ -18,68 +18,458 @@
 #include <cstdio>
 #include <algorithm>
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
 #include "attack_engine.h"
 #include "attack_manager.h"
 #include "attack_thread.h"
+#include "checkpoint.h"
 #include "utility.h"
 
 #define THREADED_REPORTING
 
+// trace count of an open-ended stream, and of a report boundary yet to be set
+#define UNBOUNDED ((size_t)-1)
+
+// minimum number of samples in each range of a merge that is split by range
+#define MERGE_MIN_SAMPLES 1024
+
 using namespace std;
 using namespace util;
 
+// -----------------------------------------------------------------------------
+// Write a checkpoint to a temporary file and rename it over the previous one,
+// so that an interrupted write never destroys the last good checkpoint.
+static bool write_checkpoint(const string &path, const string &data)
+{
+    const string temp = path + ".tmp";
+    ofstream out(temp.c_str(), ios::binary);
+    out.write(data.data(), data.size());
+    out.close();
+
+    if (out.fail() || rename(temp.c_str(), path.c_str())) {
+        fprintf(stderr, "failed to write checkpoint '%s'\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Merge of one sample range of several sources, in order, into a destination.
+struct merge_task {
+    attack_instance               *dst;
+    const attack_instance *const  *srcs;
+    size_t                         count;
+    size_t                         first;
+    size_t                         last;
+};
+
+// -----------------------------------------------------------------------------
+// Run every merge task assigned to this thread.
+static void merge_stripe(const vector<merge_task> *tasks, size_t first,
+                         size_t step)
+{
+    for (size_t i = first; i < tasks->size(); i += step) {
+        const merge_task &task = (*tasks)[i];
+        for (size_t j = 0; j < task.count; ++j)
+            task.dst->coalesce_range(task.srcs[j], task.first, task.last);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Run the merge tasks across up to nthreads threads, including this one.
+static void run_merges(const vector<merge_task> &tasks, size_t nthreads)
+{
+    nthreads = max((size_t)1, min(nthreads, tasks.size()));
+
+    boost::thread_group group;
+    for (size_t t = 1; t < nthreads; ++t)
+        group.create_thread(boost::bind(merge_stripe, &tasks, t, nthreads));
+    merge_stripe(&tasks, 0, nthreads);
+    group.join_all();
+}
+
+// -----------------------------------------------------------------------------
+// Add the tasks that merge 'count' sources into dst, split into up to 'parts'
+// ranges of the nevents samples.
+static void split_merge(vector<merge_task> &tasks, attack_instance *dst,
+                        const attack_instance *const *srcs, size_t count,
+                        size_t nevents, size_t parts)
+{
+    parts = max((size_t)1, min(parts, nevents / MERGE_MIN_SAMPLES));
+
+    merge_task task;
+    task.dst   = dst;
+    task.srcs  = srcs;
+    task.count = count;
+    for (size_t p = 0; p < parts; ++p) {
+        task.first = p * nevents / parts;
+        task.last  = (p + 1) * nevents / parts;
+        tasks.push_back(task);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Merge every source into dst, leaving the sources untouched. The samples are
+// split into ranges that are merged by up to nthreads threads.
+static void coalesce_all(attack_instance *dst,
+                         const vector<const attack_instance *> &srcs,
+                         size_t nevents, size_t nthreads)
+{
+    if (srcs.empty()) return;
+
+    vector<merge_task> tasks;
+    split_merge(tasks, dst, &srcs[0], srcs.size(), nevents, nthreads);
+    run_merges(tasks, nthreads);
+}
+
+// -----------------------------------------------------------------------------
+// Merge every instance of the list into the first. Adjacent pairs are merged a
+// level at a time, so the depth of the reduction is logarithmic in the number
+// of instances, and each merge is split by sample range so that every level
+// keeps up to nthreads threads busy. The other instances are left holding
+// partial sums.
+static void reduce_tree(vector<attack_instance *> attacks, size_t nevents,
+                        size_t nthreads)
+{
+    while (attacks.size() > 1) {
+        const size_t pairs = attacks.size() / 2;
+        const vector<const attack_instance *> srcs(attacks.begin(),
+                                                   attacks.end());
+        vector<merge_task> tasks;
+        for (size_t i = 0; i < pairs; ++i) {
+            split_merge(tasks, attacks[2 * i], &srcs[2 * i + 1], 1, nevents,
+                        (nthreads + pairs - 1) / pairs);
+        }
+        run_merges(tasks, nthreads);
+
+        for (size_t i = 0; 2 * i < attacks.size(); ++i)
+            attacks[i] = attacks[2 * i];
+        attacks.resize((attacks.size() + 1) / 2);
+    }
+}
+
 class report_thread {
 public:
-    report_thread(const string &attack)
-    : m_index(0), m_running(true), m_attack(NULL) {
+    report_thread(const string &attack, size_t num_events)
+    : m_index(0), m_processed(0), m_nevents(num_events), m_pending(false),
+      m_running(true), m_primed(false), m_every(0), m_last(0),
+      m_attack(NULL) {
         m_attack.reset(attack_manager::create_attack(attack));
         assert(NULL != m_attack.get());
     }
 
+    //! write a checkpoint to path after every 'every' recorded intervals
+    //! (if every is nonzero) and after the last interval
+    void set_checkpoint(const string &path, const checkpoint_header &header,
+                        size_t every, size_t last) {
+        m_path = path;
+        m_header = header;
+        m_every = every;
+        m_last = last;
+    }
+
+    //! hand the merged state of each interval to fn rather than recording
+    //! it in the attack instance (for open-ended streams)
+    void set_stream(const boost::function<void (attack_instance *,
+                                                size_t)> &fn) {
+        m_stream = fn;
+    }
+
+    //! pass the state to fn after each interval is recorded, and stop
+    //! recording intervals once fn returns true
+    void set_monitor(const boost::function<bool (attack_instance *,
+                                                 size_t)> &fn) {
+        m_monitor = fn;
+    }
+
     void run(void) {
         boost::unique_lock<boost::mutex> lock(m_mutex);
 
         while (true) {
-            m_condition.wait(lock);
-            if (!m_running) break;
-            m_attack->record_interval(m_index);
+            while (m_running && !m_pending) m_condition.wait(lock);
+            if (!m_pending) break;
+
+            merge_deltas();
+            if (m_stream)
+                m_stream(m_attack.get(), m_processed);
+            else
+                m_attack->record_interval(m_index);
+
+            // keep the state of the interval at which the monitor stopped
+            if (m_monitor && m_monitor(m_attack.get(), m_index))
+                m_running = false;
+
+            // capture the merged state while it is consistent, and write it
+            // out while the workers proceed with the next interval
+            string state;
+            if (m_path.length() && (m_index == m_last ||
+                                    (m_every && !((m_index + 1) % m_every))))
+                state = checkpoint_state();
+
+            m_pending = false;
+            m_condition.notify_all();
+
+            if (!state.empty()) {
+                lock.unlock();
+                write_checkpoint(m_path, state);
+                lock.lock();
+            }
         }
     }
 
-    void compute(const attack_engine::thread_list &threads, size_t index) {
+    void compute(const attack_engine::thread_list &threads, size_t index,
+                 size_t processed) {
         {
-            boost::lock_guard<boost::mutex> lock(m_mutex);
+            // wait for the previous interval to be recorded before cloning
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            while (m_pending) m_condition.wait(lock);
+            if (!m_running) return;
 
-            m_attack->clone(threads.front()->attack());
+            // the workers wait at the boundary while their state is merged
+            vector<const attack_instance *> others;
             for (size_t i = 1; i < threads.size(); ++i)
-                m_attack->coalesce(threads[i]->attack());
+                others.push_back(threads[i]->attack());
+
+            m_attack->clone(threads.front()->attack());
+            coalesce_all(m_attack.get(), others, m_nevents, threads.size());
 
             m_index = index;
+            m_processed = processed;
+            m_pending = true;
         }
-        m_condition.notify_one();
+        m_condition.notify_all();
     }
 
+    //! take the state accumulated by every worker since the last interval,
+    //! handing each a cleared instance in exchange, and merge the deltas into
+    //! the running state asynchronously
+    void exchange(const attack_engine::thread_list &threads, size_t index,
+                  size_t processed) {
+        {
+            // wait for the previous deltas to be merged and cleared
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            while (m_pending) m_condition.wait(lock);
+            if (!m_running) return;
+
+            foreach (attack_thread *thread, threads) thread->swap_spare();
+            m_deltas = threads;
+
+            m_index = index;
+            m_processed = processed;
+            m_pending = true;
+        }
+        m_condition.notify_all();
+    }
+
+    //! the running state was restored from a checkpoint, so every delta is
+    //! merged into it
+    void prime(void) { m_primed = true; }
+
     void terminate(void) {
         {
             boost::lock_guard<boost::mutex> lock(m_mutex);
             m_running = false;
         }
-        m_condition.notify_one();
+        m_condition.notify_all();
     }
 
     attack_instance *attack(void) const { return m_attack.get(); }   
 
 protected:
+    //! fold the deltas taken from the workers into the running state, and
+    //! clear them for the next exchange
+    void merge_deltas(void) {
+        if (m_deltas.empty()) return;
+
+        vector<attack_instance *> attacks(1, m_attack.get());
+        foreach (attack_thread *thread, m_deltas)
+            attacks.push_back(thread->spare());
+
+        if (!m_primed) {
+            m_attack->clone(attacks[1]);
+            attacks.erase(attacks.begin() + 1);
+            m_primed = true;
+        }
+        reduce_tree(attacks, m_nevents, m_deltas.size());
+
+        foreach (attack_thread *thread, m_deltas) thread->spare()->reset();
+        m_deltas.clear();
+    }
+
+    //! serialize the checkpoint header, trace count and merged attack state
+    string checkpoint_state(void) {
+        ostringstream oss;
+        m_header.processed = m_processed;
+        m_header.write(oss);
+
+        if (!m_attack->save(oss)) {
+            fprintf(stderr, "warning: attack does not support checkpoints\n");
+            m_path.clear();
+            return "";
+        }
+        return oss.str();
+    }
+
     size_t                         m_index;
+    size_t                         m_processed;
+    size_t                         m_nevents;
+    bool                           m_pending;
     bool                           m_running;
+    bool                           m_primed;
+    size_t                         m_every;
+    size_t                         m_last;
+    string                         m_path;
+    checkpoint_header              m_header;
+    attack_engine::thread_list     m_deltas;
+    boost::function<void (attack_instance *, size_t)> m_stream;
+    boost::function<bool (attack_instance *, size_t)> m_monitor;
     boost::mutex                   m_mutex;
     boost::condition_variable      m_condition;
     std::auto_ptr<attack_instance> m_attack;
 };
 
+// -----------------------------------------------------------------------------
+// Bounded single-producer, multiple-consumer ring of trace batches. Batches are
+// exchanged by swapping, so the trace buffers are allocated once and recycled
+// between the reader and the workers. Each slot carries a sequence number that
+// determines whether it is ready for the producer or the consumers.
+//
+// The ring either hands each batch to a single consumer (pop), or broadcasts
+// each batch to every consumer (peek/release), in which case the slot is freed
+// once all consumers have released it.
+//
+// A thread that finds the ring full or empty blocks in wait() until another
+// thread signals a change: a push, a freed slot, closing the ring, or the
+// attack being cancelled. The count of changes is read before the attempt, so
+// a change made between the failed attempt and the wait is never missed.
+class trace_ring {
+public:
+    trace_ring(size_t slots, size_t consumers)
+    : m_mask(slots - 1), m_consumers(consumers), m_slots(new slot[slots]),
+      m_head(0), m_tail(0), m_closed(false), m_changes(0), m_waiters(0) {
+        assert(slots && !(slots & m_mask));
+        for (size_t i = 0; i < slots; ++i) m_slots[i].seq.store(i);
+    }
+
+    //! push a batch into the ring, returning the recycled buffer in batch
+    bool push(vector<trace> &batch, size_t first) {
+        const size_t pos = m_tail.load(boost::memory_order_relaxed);
+        slot &cell = m_slots[pos & m_mask];
+        if (cell.seq.load(boost::memory_order_acquire) != pos)
+            return false;
+
+        cell.traces.swap(batch);
+        cell.first = first;
+        cell.refs.store(m_consumers);
+        m_tail.store(pos + 1, boost::memory_order_relaxed);
+        cell.seq.store(pos + 1, boost::memory_order_release);
+        signal();
+        return true;
+    }
+
+    //! pop a batch from the ring, handing the previous buffer back in batch
+    bool pop(vector<trace> &batch, size_t &first) {
+        size_t pos = m_head.load(boost::memory_order_relaxed);
+        while (true) {
+            slot &cell = m_slots[pos & m_mask];
+            const size_t seq = cell.seq.load(boost::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+
+            if (diff < 0)
+                return false;
+            else if (diff > 0)
+                pos = m_head.load(boost::memory_order_relaxed);
+            else if (m_head.compare_exchange_weak(pos, pos + 1)) {
+                cell.traces.swap(batch);
+                first = cell.first;
+                cell.seq.store(pos + m_mask + 1, boost::memory_order_release);
+                signal();
+                return true;
+            }
+        }
+    }
+
+    //! access the broadcast batch at position pos, if it has been pushed
+    bool peek(size_t pos, const vector<trace> *&batch, size_t &first) {
+        const slot &cell = m_slots[pos & m_mask];
+        if (cell.seq.load(boost::memory_order_acquire) != pos + 1)
+            return false;
+
+        batch = &cell.traces;
+        first = cell.first;
+        return true;
+    }
+
+    //! release the broadcast batch at pos, freeing it for the last consumer
+    void release(size_t pos) {
+        slot &cell = m_slots[pos & m_mask];
+        if (cell.refs.fetch_sub(1) == 1) {
+            cell.seq.store(pos + m_mask + 1, boost::memory_order_release);
+            signal();
+        }
+    }
+
+    //! signal the consumers that no more batches will be pushed
+    void close(void) {
+        m_closed.store(true);
+        signal();
+    }
+
+    //! returns true if the producer has closed the ring
+    bool closed(void) const { return m_closed.load(); }
+
+    //! returns the count of changes, to read before attempting an operation
+    size_t changes(void) const { return m_changes.load(); }
+
+    //! block until a change after the count seen, returning the new count
+    size_t wait(size_t seen) {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        m_waiters.fetch_add(1);
+        while (m_changes.load() == seen)
+            m_cond.wait(lock);
+        m_waiters.fetch_sub(1);
+        return m_changes.load();
+    }
+
+    //! count a change, waking every thread blocked in wait(); either the
+    //! waiter sees the new count or the change sees the waiter, as both
+    //! counts are sequentially consistent
+    void signal(void) {
+        m_changes.fetch_add(1);
+        if (m_waiters.load()) {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            m_cond.notify_all();
+        }
+    }
+
+protected:
+    struct slot {
+        boost::atomic<size_t> seq;
+        boost::atomic<size_t> refs;
+        size_t                first;
+        vector<trace>         traces;
+    };
+
+    const size_t              m_mask;
+    const size_t              m_consumers;
+    boost::scoped_array<slot> m_slots;
+    boost::atomic<size_t>     m_head;
+    boost::atomic<size_t>     m_tail;
+    boost::atomic<bool>       m_closed;
+    boost::atomic<size_t>     m_changes; // changes signalled to waiters
+    boost::atomic<size_t>     m_waiters; // threads blocked in wait()
+    boost::mutex              m_mutex;
+    boost::condition_variable m_cond;
+};
+
 // -----------------------------------------------------------------------------
 attack_engine::attack_engine(void)
-: m_reports(0), m_interval(0), m_index(0)
+: m_reports(0), m_interval(0), m_index(0), m_first(0), m_ntraces(0),
+  m_next_report(0), m_processed(0), m_claimed(0), m_cancel(false),
+  m_split(false), m_epochs(false), m_stream(false), m_report_secs(0),
+  m_converge(0), m_converge_ratio(0), m_converged(false)
 {
 }
 
@@ -88,18 +478,32 @@ attack_engine::~attack_engine(void)
 {
 }
 
+// -----------------------------------------------------------------------------
+// Add each comma separated name=value pair in expr to the parameter map.
+static bool parse_parameters(const string &expr, util::parameters &params)
+{
+    foreach (const string &param, util::split(expr, ",")) {
+        const size_t pos = param.find_first_of('=');
+        if (string::npos == pos) {
+            fprintf(stderr, "bad parameter declaration: %s\n", param.c_str());
+            return false;
+        }
+        params.put(param.substr(0, pos), param.substr(pos + 1));
+    }
+    return true;
+}
+
 // -----------------------------------------------------------------------------
 bool attack_engine::run(const options &opt, trace_reader *pReader)
 {
     BENCHMARK_DECLARE(attack_whole);
 
-    printf("attacking with %zu trace(s)...\n", pReader->trace_count());
-
     // perform pre-attack initialization
     if (!attack_setup(opt, pReader))
         return false;
 
     m_group.join_all();
+    m_rthrd.join();
 
     // perform post-attack shutdown
     attack_shutdown();
@@ -111,71 +515,431 @@ bool attack_engine::run(const options &opt, trace_reader *pReader)
 // -----------------------------------------------------------------------------
 bool attack_engine::attack_setup(const options &opt, trace_reader *pReader)
 {
+    // a shard attacks one contiguous range of the traces in the input
+    const size_t shard_count = max(opt.shard_count, 1U);
+    const size_t total = pReader->trace_count();
+    if (opt.shard_index >= shard_count) {
+        fprintf(stderr, "invalid shard %u/%zu\n", opt.shard_index,
+                shard_count);
+        return false;
+    }
+
+    // a stream is attacked as it arrives, until it closes
+    m_stream = pReader->streaming();
+    if (m_stream && (shard_count > 1 || opt.split || opt.checkpoint ||
+                     opt.resume_path.length())) {
+        fprintf(stderr, "shards, split samples and checkpoints are not "
+                        "supported for streamed traces\n");
+        return false;
+    }
+    else if (m_stream && opt.report_tick && opt.report_secs) {
+        fprintf(stderr, "specify either a trace count or a time between "
+                        "reports, not both\n");
+        return false;
+    }
+    else if (opt.converge && (shard_count > 1 || opt.split)) {
+        fprintf(stderr, "convergence monitoring is not supported for shards "
+                        "or split samples\n");
+        return false;
+    }
+    else if (!m_stream && opt.report_secs) {
+        fprintf(stderr, "warning: the time between reports only applies to "
+                        "streamed traces\n");
+    }
+
+    m_first   = opt.shard_index * total / shard_count;
+    m_ntraces = (opt.shard_index + 1) * total / shard_count - m_first;
+    if (m_stream) {
+        m_ntraces = total ? total : UNBOUNDED;
+    }
+    else if (!m_ntraces) {
+        fprintf(stderr, "no traces to attack\n");
+        return false;
+    }
+
+    if (m_stream) {
+        printf("attacking traces from the stream until it closes...\n");
+    }
+    else if (shard_count > 1) {
+        printf("attacking traces %zu to %zu of %zu...\n", m_first + 1,
+               m_first + m_ntraces, total);
+    }
+    else printf("attacking with %zu trace(s)...\n", m_ntraces);
+
     // if no results directory is specified, create one using the timestamp
     m_results = opt.result_path;
     if (m_results.length() == 0) {
         ostringstream oss;
         oss << util::timestamp()
             << "_" << opt.attack_name
-            << "_" << opt.crypto_name
-            << "_" << pReader->trace_count();
+            << "_" << opt.crypto_name;
+        if (m_stream)
+            oss << "_stream";
+        else
+            oss << "_" << m_ntraces;
+        if (shard_count > 1)
+            oss << "_shard" << opt.shard_index;
         m_results = oss.str();
     }
 
     if (!util::valid_output_directory(m_results))
         return false;
 
-    const size_t num_traces = pReader->trace_count();
-
     // process the user-specified attack options
     m_reader   = pReader;
     m_nthreads = max(opt.num_threads, 1U);
-    m_interval = opt.report_tick ? opt.report_tick : num_traces;
-    m_reports  = 1 + ((num_traces - 1) / m_interval);
+    m_batch    = max(opt.batch_size, 1U);
+    m_interval = opt.report_tick ? opt.report_tick : m_ntraces;
+    m_reports  = m_stream ? 1 : 1 + ((m_ntraces - 1) / m_interval);
     m_index    = 0;
 
-    // disable multithreading if the report interval is too low (no benefit)
-    if (m_interval < m_nthreads) {
+    // a stream records its reports as it goes, rather than in the attack
+    m_report_secs = m_stream ? opt.report_secs : 0;
+    m_report_marks.clear();
+    m_stream_maxes.clear();
+
+    // stop early once the key ranking has been stable for several reports
+    m_converge       = opt.converge;
+    m_converge_ratio = opt.converge_ratio;
+    m_converged      = false;
+    m_leader.clear();
+    m_stable.clear();
+
+    m_next_report = m_report_secs ? UNBOUNDED : min(m_interval, m_ntraces);
+    m_processed   = 0;
+    m_claimed     = 0;
+    m_split       = opt.split;
+
+    const size_t num_events = pReader->events().size();
+    m_nevents = num_events;
+    m_axis = trace_reader::make_axis(pReader->events());
+
+    if (m_split) {
+        // only some attacks can work on a slice of the samples
+        boost::scoped_ptr<attack_instance> probe(
+            attack_manager::create_attack(opt.attack_name));
+        if (probe && !probe->split_samples()) {
+            fprintf(stderr, "%s cannot split the samples across threads\n",
+                    opt.attack_name.c_str());
+            return false;
+        }
+
+        // every thread needs at least one sample to work on
+        m_nthreads = max((size_t)1, min(m_nthreads, num_events));
+    }
+    else if (m_interval < m_nthreads) {
+        // disable multithreading if the report interval is too low
         fprintf(stderr, "warning: report interval less than thread count\n");
         m_nthreads = 1;
     }
 
     // write the parameter map used to configure the attack instance
     util::parameters param_map;
-    param_map.put("num_events", pReader->events().size());
     param_map.put("num_reports", m_reports);
+    param_map.put("crypto", opt.crypto_name);
+    param_map.put("split", m_split ? 1 : 0);
+    param_map.put("integer", pReader->integer() ? 1 : 0);
+    if (!parse_parameters(opt.parameters, param_map))
+        return false;
 
-    foreach (const string &expr, util::split(opt.parameters, ",")) {
-        const size_t pos = expr.find_first_of('=');
-        if (string::npos == pos) {
-            fprintf(stderr, "bad parameter declaration: %s\n", expr.c_str());
-            return false;
+#ifdef THREADED_REPORTING
+    if (!m_split) {
+        // spawn the report thread
+        m_rt = new report_thread(opt.attack_name, num_events);
+        if (m_stream) {
+            m_rt->set_stream(boost::bind(&attack_engine::stream_report, this,
+                                         _1, _2));
         }
-        param_map.put(expr.substr(0, pos), expr.substr(pos + 1));
+        else if (m_converge) {
+            m_rt->set_monitor(boost::bind(&attack_engine::monitor_report, this,
+                                          _1, _2));
+        }
+        m_thrd = boost::thread(&report_thread::run, m_rt);
     }
+#endif
+
+    // allow the reader to run a few batches ahead of each worker thread
+    size_t ring_slots = 1;
+    while (ring_slots < 4 * m_nthreads) ring_slots <<= 1;
+    m_ring.reset(new trace_ring(ring_slots, m_split ? m_nthreads : 1));
 
+    m_slices.clear();
+    m_slice_axes.clear();
 #ifdef THREADED_REPORTING
-    // spawn the report thread
-    m_rt = new report_thread(opt.attack_name);
-    m_thrd = boost::thread(&report_thread::run, m_rt);
+    m_epochs = !m_split;
+#else
+    m_epochs = false;
 #endif
+    m_cursor.assign(m_nthreads, 0);
+    m_batch_end.assign(m_nthreads, 0);
 
     // spawn the worker threads based on the specified thread count
     for (size_t i = 0; i < m_nthreads; ++i) {
+        // in split mode, each thread attacks a contiguous range of samples
+        const size_t first = m_split ? (i * num_events / m_nthreads) : 0;
+        const size_t last = m_split ? ((i + 1) * num_events / m_nthreads)
+                                    : num_events;
+        m_slices.push_back(make_pair(first, last - first));
+        m_slice_axes.push_back(trace::time_axis_ptr(new trace::time_axis(
+            m_axis->begin() + first, m_axis->begin() + last)));
+
+        util::parameters thread_params(param_map);
+        thread_params.put("num_events", last - first);
+
         attack_thread *thread = new attack_thread(i, this);
-        if (!thread->create(opt.attack_name, opt.crypto_name, param_map)) {
+        if (!thread->create(opt.attack_name, opt.crypto_name, thread_params)) {
             fprintf(stderr, "failed to launch thread %zu\n", i);
             return false;
         }
+        m_threads.push_back(thread);
+
+        // if the attack can be reset, each worker hands over the delta it
+        // accumulated at every interval, rather than being cloned in place
+        m_epochs = m_epochs &&
+                   thread->create_spare(opt.attack_name, thread_params);
+    }
+
+    // a shard always leaves a final checkpoint behind for the merge tool
+    if (opt.checkpoint || opt.resume_path.length() || shard_count > 1) {
+#ifdef THREADED_REPORTING
+        if (m_split) {
+            fprintf(stderr, "checkpoints are not supported when the samples "
+                            "are split across threads\n");
+            return false;
+        }
+
+        // the header identifies the attack configuration of the checkpoint
+        checkpoint_header header;
+        header.attack_name = opt.attack_name;
+        header.crypto_name = opt.crypto_name;
+        header.parameters  = opt.parameters;
+        header.first       = m_first;
+        header.num_traces  = m_ntraces;
+        header.interval    = m_interval;
+        header.events.assign(m_axis->begin(), m_axis->end());
+
+        m_rt->set_checkpoint(util::concat_name(m_results, "checkpoint.bin"),
+                             header, opt.checkpoint, m_reports - 1);
+
+        if (opt.resume_path.length() &&
+            !attack_resume(opt.resume_path, header))
+            return false;
+#else
+        fprintf(stderr, "checkpoints require threaded reporting\n");
+        return false;
+#endif
+    }
 
-        // add the current worker to the thread group for joining
+    // skip the traces before the shard and any that were already processed
+    if (!m_reader->skip(m_first + m_index)) {
+        fprintf(stderr, "failed to skip %zu traces\n", m_first + m_index);
+        return false;
+    }
+
+    // add each worker to the thread group for joining
+    foreach (attack_thread *thread, m_threads)
         m_group.create_thread(boost::bind(&attack_thread::run, thread));
-        m_threads.push_back(thread);
+
+    // spawn the reader thread once every worker has been created
+    m_rthrd = boost::thread(&attack_engine::read_traces, this);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Load the accumulated state of a checkpoint into the first worker and the
+// report thread (which also holds the interval maxes recorded so far), and
+// continue from the first trace that the checkpoint has not seen.
+bool attack_engine::attack_resume(const string &path,
+                                  const checkpoint_header &header)
+{
+    ifstream in(path.c_str(), ios::binary);
+    if (!in.is_open()) {
+        fprintf(stderr, "failed to open checkpoint '%s'\n", path.c_str());
+        return false;
+    }
+
+    checkpoint_header saved;
+    if (!saved.read(in))
+        return false;
+    else if (!saved.same_attack(header) || saved.first != header.first ||
+             saved.num_traces != header.num_traces ||
+             saved.interval != header.interval) {
+        fprintf(stderr, "checkpoint '%s' was written by a different attack "
+                        "configuration or trace set\n", path.c_str());
+        return false;
+    }
+
+    const size_t processed = saved.processed;
+    if (processed > m_ntraces ||
+        (processed % m_interval && processed != m_ntraces)) {
+        fprintf(stderr, "invalid trace count in checkpoint\n");
+        return false;
+    }
+
+    ostringstream state;
+    state << in.rdbuf();
+
+    istringstream worker_state(state.str()), report_state(state.str());
+    attack_instance *attack = m_threads.front()->attack();
+
+    if (!attack->load(worker_state) || !m_rt->attack()->load(report_state)) {
+        fprintf(stderr, "failed to load the attack state from '%s'\n",
+                path.c_str());
+        return false;
     }
+    m_rt->attack()->clone(attack);
 
+    // the workers accumulate deltas to the restored state
+    if (m_epochs) {
+        attack->reset();
+        m_rt->prime();
+    }
+
+    printf("resuming after trace %zu\n", processed);
+    m_index = processed;
+    m_processed = processed;
+    m_claimed = processed;
+    m_next_report = min(processed + m_interval, m_ntraces);
     return true;
 }
 
+// -----------------------------------------------------------------------------
+// Combine the final checkpoints of adjacent trace ranges of the same attack,
+// such as those written by each shard, and report on the combined state. The
+// states are merged pairwise, a level at a time, using up to opt.num_threads
+// threads. The merged checkpoint is written so that merges can be chained.
+bool attack_engine::merge(const options &opt, const vector<string> &paths)
+{
+    if (paths.empty()) {
+        fprintf(stderr, "no checkpoints to merge\n");
+        return false;
+    }
+
+    // load the header and accumulated state of every checkpoint
+    vector<checkpoint_header> headers(paths.size());
+    vector<boost::shared_ptr<crypto_instance> > cryptos;
+    vector<boost::shared_ptr<attack_instance> > attacks;
+    vector<pair<uint64_t, size_t> > order;
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ifstream in(paths[i].c_str(), ios::binary);
+        if (!in.is_open()) {
+            fprintf(stderr, "failed to open checkpoint '%s'\n",
+                    paths[i].c_str());
+            return false;
+        }
+
+        checkpoint_header &header = headers[i];
+        if (!header.read(in))
+            return false;
+        else if (!header.same_attack(headers.front())) {
+            fprintf(stderr, "checkpoint '%s' was written by a different "
+                            "attack configuration\n", paths[i].c_str());
+            return false;
+        }
+        else if (header.processed != header.num_traces) {
+            fprintf(stderr, "checkpoint '%s' is incomplete (%zu of %zu "
+                            "traces)\n", paths[i].c_str(),
+                    (size_t)header.processed, (size_t)header.num_traces);
+            return false;
+        }
+
+        util::parameters params;
+        params.put("num_events", header.events.size());
+        params.put("num_reports", 1);
+        params.put("crypto", header.crypto_name);
+        if (!parse_parameters(header.parameters, params))
+            return false;
+
+        crypto_instance *crypto =
+            attack_manager::create_crypto(header.crypto_name);
+        attack_instance *attack =
+            attack_manager::create_attack(header.attack_name);
+        if (!crypto || !attack) {
+            fprintf(stderr, "unknown attack '%s' or crypto '%s'\n",
+                    header.attack_name.c_str(), header.crypto_name.c_str());
+            delete crypto;
+            delete attack;
+            return false;
+        }
+        cryptos.push_back(boost::shared_ptr<crypto_instance>(crypto));
+        attacks.push_back(boost::shared_ptr<attack_instance>(attack));
+
+        if (!attack->setup(crypto, params) || !attack->load(in)) {
+            fprintf(stderr, "failed to load the attack state from '%s'\n",
+                    paths[i].c_str());
+            return false;
+        }
+        order.push_back(make_pair(header.first, i));
+    }
+
+    // the checkpoints must cover one contiguous range of traces
+    sort(order.begin(), order.end());
+    vector<attack_instance *> pending;
+    uint64_t next = headers[order.front().second].first;
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const checkpoint_header &header = headers[order[i].second];
+        if (header.first != next) {
+            fprintf(stderr, "checkpoints do not cover a contiguous range of "
+                            "traces (expected trace %zu, found %zu)\n",
+                    (size_t)next + 1, (size_t)header.first + 1);
+            return false;
+        }
+        next += header.num_traces;
+        pending.push_back(attacks[order[i].second].get());
+    }
+
+    const uint64_t first = headers[order.front().second].first;
+    const uint64_t total = next - first;
+    printf("merging %zu checkpoint(s) of traces %zu to %zu...\n",
+           paths.size(), (size_t)first + 1, (size_t)next);
+
+    // merge adjacent pairs, halving the number of pending states each level
+    reduce_tree(pending, headers.front().events.size(),
+                max(opt.num_threads, 1U));
+
+    // if no results directory is specified, create one using the timestamp
+    m_results = opt.result_path;
+    if (m_results.length() == 0) {
+        ostringstream oss;
+        oss << util::timestamp()
+            << "_merge"
+            << "_" << headers.front().attack_name
+            << "_" << headers.front().crypto_name
+            << "_" << total;
+        m_results = oss.str();
+    }
+
+    if (!util::valid_output_directory(m_results))
+        return false;
+
+    checkpoint_header header = headers.front();
+    header.first      = first;
+    header.num_traces = total;
+    header.processed  = total;
+    header.interval   = total;
+
+    m_axis.reset(new trace::time_axis(header.events.begin(),
+                                      header.events.end()));
+    m_nevents  = header.events.size();
+    m_reports  = 1;
+    m_interval = total;
+
+    attack_instance *attack = pending.front();
+    report_attack(attack, 1 << cryptos.front()->estimate_bits());
+
+    // write the merged state, so that it can be merged again or inspected
+    ostringstream oss;
+    header.write(oss);
+    if (!attack->save(oss)) {
+        fprintf(stderr, "failed to save the merged attack state\n");
+        return false;
+    }
+    return write_checkpoint(util::concat_name(m_results, "checkpoint.bin"),
+                            oss.str());
+}
+
 // -----------------------------------------------------------------------------
 void attack_engine::attack_shutdown(void)
 {
@@ -183,30 +947,49 @@ void attack_engine::attack_shutdown(void)
     printf("\n");
 
     // compute the final differential trace and write the attack results
-    vector<double> diffs, maxes;
+    int num_guesses = 1 << m_threads.front()->crypto()->estimate_bits();
 
+    if (!m_split) {
 #ifdef THREADED_REPORTING
-    m_rt->terminate();
-    m_thrd.join();
-    attack_instance *attack = m_rt->attack();
+        m_rt->terminate();
+        m_thrd.join();
+        attack_instance *attack = m_rt->attack();
 #else
-    attack_instance *attack = m_threads.front()->attack();
-    for (size_t i = 1; i < m_threads.size(); ++i) {
-        printf("coalescing thread instance [%zu]...\n", i);
-        attack->coalesce(m_threads[i]->attack());
-    }
-#endif
+        vector<attack_instance *> attacks;
+        foreach (attack_thread *thread, m_threads)
+            attacks.push_back(thread->attack());
 
-    attack->get_diffs(diffs);
-    attack->get_maxes(maxes);
+        printf("coalescing %zu thread instance(s)...\n", attacks.size());
+        reduce_tree(attacks, m_nevents, m_threads.size());
+        attack_instance *attack = attacks.front();
+#endif
+        if (!m_stream)
+            report_attack(attack, num_guesses);
+        else if (m_report_marks.empty())
+            fprintf(stderr, "no traces were received from the stream\n");
+        else
+            attack->write_results(m_results);
+    }
+    else {
+        // stitch the sample ranges back together; no coalescing required
+        vector<double> diffs, maxes;
+        const size_t num_targets = m_threads.front()->attack()->num_targets();
+        for (size_t t = 0; t < num_targets; ++t) {
+            string dir = m_results, name;
+            foreach (attack_thread *thread, m_threads)
+                thread->attack()->select_target(t, name, num_guesses);
+            if (num_targets > 1) {
+                dir = target_directory(name);
+                if (!dir.length()) continue;
+            }
 
-    const int num_guesses = 1 << m_threads.front()->crypto()->estimate_bits();
-    write_maxes_report(maxes, num_guesses);
-    write_confs_report(maxes, num_guesses);
-    write_diffs_report(diffs, num_guesses);
+            gather_split_results(diffs, maxes, num_guesses);
+            write_reports(dir, diffs, maxes, num_guesses);
+        }
 
-    // allow the attack to write out additional reports if necessary
-    attack->write_results(m_results);
+        fprintf(stderr, "note: attack specific reports are not written when "
+                        "the samples are split across threads\n");
+    }
 
     // finally, destroy the threads themselves
     foreach (attack_thread *thread, m_threads) delete thread;
@@ -214,59 +997,487 @@ void attack_engine::attack_shutdown(void)
 }
 
 // -----------------------------------------------------------------------------
-// Read in the next available power trace and generate the trace's event map.
-bool attack_engine::next_trace(int id, vector<long> &tmap, trace &pt)
+// Write the reports of every target of the attack instance, each target of a
+// multi-target attack in its own directory, followed by any attack specific
+// reports.
+void attack_engine::report_attack(attack_instance *attack, int num_guesses)
 {
-    {
-        // lock the next power trace selection to avoid race conditions
-        boost::lock_guard<boost::mutex> lock(m_mutex);
-        const size_t num_traces = m_reader->trace_count();
+    vector<double> diffs, maxes;
+    const size_t num_targets = attack->num_targets();
+    for (size_t t = 0; t < num_targets; ++t) {
+        string dir = m_results, name;
+        attack->select_target(t, name, num_guesses);
+        if (num_targets > 1) {
+            dir = target_directory(name);
+            if (!dir.length()) continue;
+        }
+
+        attack->get_diffs(diffs);
+        attack->get_maxes(maxes);
+
+        // the intervals after an early stop were never recorded
+        if (maxes.size() > num_guesses * m_reports)
+            maxes.resize(num_guesses * m_reports);
+        write_reports(dir, diffs, maxes, num_guesses);
+    }
+
+    // allow the attack to write out additional reports if necessary
+    attack->write_results(m_results);
+}
+
+// -----------------------------------------------------------------------------
+string attack_engine::target_directory(const string &name)
+{
+    const string dir = util::concat_name(m_results, name);
+    if (!util::valid_output_directory(dir))
+        return "";
+
+    printf("target %s:\n", name.c_str());
+    return dir;
+}
+
+// -----------------------------------------------------------------------------
+void attack_engine::write_reports(const string &dir,
+                                  const vector<double> &diffs,
+                                  const vector<double> &maxes, int nk)
+{
+    write_maxes_report(dir, maxes, nk);
+    write_confs_report(dir, maxes, nk);
+    write_diffs_report(dir, diffs, nk);
+}
+
+// -----------------------------------------------------------------------------
+// Combine the per-thread sample ranges into full differentials and maxes. The
+// interval maxes of each range are combined by taking the overall maximum.
+void attack_engine::gather_split_results(vector<double> &diffs,
+                                         vector<double> &maxes, int nk)
+{
+    const size_t num_events = m_nevents;
+    diffs.assign(nk * num_events, 0.0);
+    maxes.clear();
+
+    vector<double> part_diffs, part_maxes;
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        const size_t first = m_slices[i].first, count = m_slices[i].second;
+        attack_instance *attack = m_threads[i]->attack();
+        attack->get_diffs(part_diffs);
+        attack->get_maxes(part_maxes);
+
+        if (part_diffs.size() == nk * count) {
+            for (int k = 0; k < nk; ++k) {
+                const double *src = &part_diffs[k * count];
+                copy(src, src + count, &diffs[k * num_events + first]);
+            }
+        }
+
+        if (maxes.empty())
+            maxes = part_maxes;
+        else if (maxes.size() == part_maxes.size()) {
+            for (size_t j = 0; j < maxes.size(); ++j)
+                maxes[j] = max(maxes[j], part_maxes[j]);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Read every power trace in order and push them into the ring in batches. A
+// batch never spans a report interval, so that each interval is recorded
+// before any trace from the following interval is processed. A stream is read
+// until it closes, ending an interval whenever the report period elapses.
+void attack_engine::read_traces(void)
+{
+    vector<trace> batch;
+    bool closed = false;
+
+    struct timespec last_report, now;
+    clock_gettime(CLOCK_REALTIME, &last_report);
+
+    while (m_index < m_ntraces && !closed && !m_cancel) {
+        if (m_report_secs) {
+            clock_gettime(CLOCK_REALTIME, &now);
+            if (time_delta_ns(&last_report, &now) >= m_report_secs * 1e9) {
+                end_interval();
+                last_report = now;
+            }
+        }
+
+        // limit the batch to the end of the current report interval
+        const size_t interval_end = (m_index / m_interval + 1) * m_interval;
+        const size_t last = min(interval_end, m_ntraces);
+        const size_t count = min(m_batch, last - m_index);
+
+        // request the next power traces from the trace reader
+        batch.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (m_reader->read(batch[i]))
+                continue;
+            else if (m_stream) {
+                // the stream has closed, keep the traces that arrived before
+                batch.resize(i);
+                closed = true;
+                break;
+            }
+
+            fprintf(stderr, "failed to read trace %zu\n", m_index + i + 1);
+            cancel();
+            break;
+        }
+
+        if (m_cancel)
+            break;
+        else if (batch.empty())
+            continue;
+
+        if (m_stream) {
+            printf("processing trace %s [%zu]\r",
+                   util::btoa(batch.back().text()).c_str(),
+                   m_index + batch.size());
+        }
+        else {
+            printf("processing trace %s [%zu/%zu]\r",
+                   util::btoa(batch.back().text()).c_str(),
+                   m_index + batch.size(), m_ntraces);
+        }
+
+        const size_t first = m_index;
+        m_index += batch.size();
+        size_t seen = m_ring->changes();
+        while (!m_ring->push(batch, first)) {
+            if (m_cancel) break;
+            seen = m_ring->wait(seen);
+        }
+    }
+
+    // the final interval of a stream ends with the last trace received
+    if (m_stream)
+        end_interval();
+
+    m_ring->close();
+}
 
-        if (m_index && (!(m_index % m_interval) || m_index == num_traces)) {
-            const size_t interval_index = (m_index - 1) / m_interval;
+// -----------------------------------------------------------------------------
+// Account for a completed batch and record the interval if it is now complete.
+void attack_engine::complete_batch(size_t count)
+{
+    const size_t processed = m_processed.fetch_add(count) + count;
+    if (processed == m_next_report.load())
+        record_report(processed);
+}
+
+// -----------------------------------------------------------------------------
+// Record the report interval that ends after the specified number of traces.
+// Both a worker and the reader (ending a stream interval) may find that the
+// boundary has been reached, so it is recorded by whichever claims it first.
+void attack_engine::record_report(size_t processed)
+{
+    size_t claimed = m_claimed.load();
+    do {
+        if (claimed >= processed) return;
+    } while (!m_claimed.compare_exchange_weak(claimed, processed));
+
+    // every trace before the boundary has been processed and no trace after it
+    // has been released to a worker, so the interval can be recorded safely
+    const size_t interval_index = (processed - 1) / m_interval;
 #ifdef THREADED_REPORTING
-            m_rt->compute(m_threads, interval_index);
+    if (m_epochs)
+        m_rt->exchange(m_threads, interval_index, processed);
+    else
+        m_rt->compute(m_threads, interval_index, processed);
 #else
-            m_threads[0]->attack()->record_interval(interval_index);
+    if (m_stream)
+        stream_report(m_threads[0]->attack(), processed);
+    else {
+        m_threads[0]->attack()->record_interval(interval_index);
+        if (m_converge)
+            monitor_report(m_threads[0]->attack(), interval_index);
+    }
 #endif
+
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_next_report = m_report_secs ? UNBOUNDED
+                                      : min(processed + m_interval, m_ntraces);
+    }
+    m_report_cond.notify_all();
+}
+
+// -----------------------------------------------------------------------------
+// End the current report interval after the traces read so far. Only called
+// by the reader, which has not pushed any trace beyond the new boundary.
+void attack_engine::end_interval(void)
+{
+    {
+        // an earlier boundary must be recorded before the next one is set
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (!m_cancel && m_next_report.load() < m_index)
+            m_report_cond.wait(lock);
+
+        if (m_cancel || m_index <= m_claimed.load() ||
+            m_index == m_next_report.load())
+            return;
+        m_next_report = m_index;
+    }
+
+    // the workers may have processed every trace before the boundary was set
+    if (m_processed.load() == m_index)
+        record_report(m_index);
+}
+
+// -----------------------------------------------------------------------------
+// Write the reports of a streamed attack, after the specified number of traces.
+// The differentials are rewritten and the interval maxes gain a row each time.
+void attack_engine::stream_report(attack_instance *attack, size_t processed)
+{
+    printf("\nreport %zu after %zu trace(s):\n", m_report_marks.size() + 1,
+           processed);
+    m_report_marks.push_back(processed);
+    m_reports = m_report_marks.size();
+
+    int num_guesses = 1 << m_threads.front()->crypto()->estimate_bits();
+    const size_t num_targets = attack->num_targets();
+    m_stream_maxes.resize(num_targets);
+
+    vector<double> diffs;
+    bool stable = true;
+    for (size_t t = 0; t < num_targets; ++t) {
+        string dir = m_results, name;
+        attack->select_target(t, name, num_guesses);
+        if (num_targets > 1) {
+            dir = target_directory(name);
+            if (!dir.length()) continue;
         }
 
-        // if there are no more traces left, signal threads to terminate
-        if (m_index >= num_traces)
-            return false;
+        // the interval max of each key guess is its largest differential
+        attack->get_diffs(diffs);
+        vector<double> &maxes = m_stream_maxes[t];
+        if (diffs.size() == num_guesses * m_nevents) {
+            for (int k = 0; k < num_guesses; ++k) {
+                const double *d = &diffs[k * m_nevents];
+                maxes.push_back(max(0.0, *max_element(d, d + m_nevents)));
+            }
+        }
+
+        write_reports(dir, diffs, maxes, num_guesses);
+
+        if (m_converge && (maxes.size() < (size_t)num_guesses ||
+                           !converged(t, &maxes[maxes.size() - num_guesses],
+                                      num_guesses)))
+            stable = false;
+    }
+    fflush(stdout);
+
+    if (m_converge && stable) {
+        printf("key ranking stable for %zu reports, stopping the stream\n",
+               m_converge);
+        m_converged = true;
+        cancel();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Check the interval maxes of every target once interval 'index' has been
+// recorded. When all key rankings are stable, stop the workers and truncate
+// the reports to this interval, whose state is kept for the final results.
+bool attack_engine::monitor_report(attack_instance *attack, size_t index)
+{
+    int num_guesses = 1 << m_threads.front()->crypto()->estimate_bits();
+    const size_t num_targets = attack->num_targets();
+
+    vector<double> maxes;
+    bool stable = true;
+    for (size_t t = 0; t < num_targets; ++t) {
+        string name;
+        attack->select_target(t, name, num_guesses);
 
-        // request the next power trace from the trace reader
-        if (!m_reader->read(pt)) {
-            fprintf(stderr, "[%d] failed to read trace %zu\n", id, m_index + 1);
+        attack->get_maxes(maxes);
+        if (maxes.size() < (index + 1) * num_guesses ||
+            !converged(t, &maxes[index * num_guesses], num_guesses))
+            stable = false;
+    }
+
+    if (!stable)
+        return false;
+
+    const size_t processed = min(m_interval * (index + 1), m_ntraces);
+    printf("\nkey ranking stable for %zu reports, stopping after %zu "
+           "traces\n", m_converge, processed);
+
+    m_reports = index + 1;
+    m_converged = true;
+    cancel();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// The ranking of a target is stable while the same guess has the largest
+// interval max, leading the runner up by at least the convergence ratio (the
+// confidence ratio of the confidence interval report).
+bool attack_engine::converged(size_t target, const double *maxes, int nk)
+{
+    if (m_leader.size() <= target) {
+        m_leader.resize(target + 1, -1);
+        m_stable.resize(target + 1, 0);
+    }
+
+    int best = 0;
+    double second = 0.0;
+    for (int k = 1; k < nk; ++k) {
+        if (maxes[k] > maxes[best]) {
+            second = maxes[best];
+            best = k;
+        }
+        else second = max(second, maxes[k]);
+    }
+
+    const double ratio = (second > 0.0) ? maxes[best] / second : 0.0;
+    if (best != m_leader[target] || ratio < m_converge_ratio) {
+        m_leader[target] = best;
+        m_stable[target] = (ratio < m_converge_ratio) ? 0 : 1;
+    }
+    else ++m_stable[target];
+
+    return m_stable[target] >= m_converge;
+}
+
+// -----------------------------------------------------------------------------
+// Stop the reader and release any workers waiting on an interval boundary.
+void attack_engine::cancel(void)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_cancel = true;
+    }
+    m_report_cond.notify_all();
+
+    // wake the reader and workers blocked on the ring
+    if (m_ring) m_ring->signal();
+}
+
+// -----------------------------------------------------------------------------
+// Complete the previous batch and pull the next batch of power traces from the
+// reader, checking that every trace has one sample for each event.
+bool attack_engine::next_batch(int id, vector<trace> &batch)
+{
+    if (m_split)
+        return next_split_batch(id, batch);
+
+    if (!batch.empty())
+        complete_batch(batch.size());
+
+    size_t first = 0, seen = m_ring->changes();
+    while (!m_ring->pop(batch, first)) {
+        if (m_cancel) {
+            batch.clear();
+            return false;
+        }
+        else if (m_ring->closed()) {
+            // the reader may have pushed its final batch after the failed pop
+            if (m_ring->pop(batch, first)) break;
+            batch.clear();
             return false;
         }
+        seen = m_ring->wait(seen);
+    }
 
-        printf("processing trace %s [%d:%zu/%zu]\r",
-               util::btoa(pt.text()).c_str(), id, ++m_index, num_traces);
+    // hold the batch until the preceding interval has been recorded
+    if (first >= m_next_report.load()) {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (!m_cancel && first >= m_next_report.load())
+            m_report_cond.wait(lock);
     }
 
-    if (tmap.size() && tmap.size() != pt.size()) {
-        fprintf(stderr, "event count mismatch\n");
+    if (m_cancel) {
+        batch.clear();
         return false;
     }
 
-    tmap.resize(pt.size());
-    for (size_t s = 0; s < pt.size(); ++s) tmap[s] = s;
+    foreach (const trace &pt, batch) {
+        if (pt.size() != m_nevents) {
+            fprintf(stderr, "[%d] event count mismatch\n", id);
+            cancel();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Copy this thread's range of samples from the next broadcast batch. Each
+// thread sees every trace in order, so it records its own interval state
+// whenever it crosses a report boundary, without waiting for other threads.
+bool attack_engine::next_split_batch(int id, vector<trace> &batch)
+{
+    const size_t num_traces = m_ntraces;
+    const size_t first_sample = m_slices[id].first;
+    const size_t num_samples = m_slices[id].second;
+    size_t &pos = m_cursor[id];
+
+    if (!batch.empty()) {
+        // record the interval if the previous batch completed it
+        const size_t end = m_batch_end[id];
+        if (!(end % m_interval) || end == num_traces)
+            m_threads[id]->attack()->record_interval((end - 1) / m_interval);
+    }
+
+    const vector<trace> *shared = NULL;
+    size_t first = 0, seen = m_ring->changes();
+    while (!m_ring->peek(pos, shared, first)) {
+        if (m_cancel) {
+            batch.clear();
+            return false;
+        }
+        else if (m_ring->closed()) {
+            // the reader may have pushed its final batch after the failed peek
+            if (m_ring->peek(pos, shared, first)) break;
+            batch.clear();
+            return false;
+        }
+        seen = m_ring->wait(seen);
+    }
+
+    batch.resize(shared->size());
+    for (size_t b = 0; b < shared->size(); ++b) {
+        const trace &src = (*shared)[b];
+        trace &dst = batch[b];
+
+        if (src.size() != m_nevents) {
+            fprintf(stderr, "[%d] event count mismatch\n", id);
+            m_ring->release(pos);
+            cancel();
+            return false;
+        }
+
+        // the integer samples are kept for the attacks that read them
+        dst.set_text(src.text());
+        if (src.levels()) {
+            dst.set_levels(src.levels() + first_sample, m_slice_axes[id]);
+            continue;
+        }
+        dst.set_axis(m_slice_axes[id]);
+
+        const trace::real *power = src.power() + first_sample;
+        copy(power, power + num_samples, dst.power());
+    }
+
+    m_batch_end[id] = first + shared->size();
+    m_ring->release(pos++);
 
     return true;
 }
 
 // -----------------------------------------------------------------------------
-void attack_engine::write_diffs_report(const vector<double> &diffs, int nk)
+void attack_engine::write_diffs_report(const string &dir,
+                                       const vector<double> &diffs, int nk)
 {
-    const size_t num_events = m_reader->events().size();
+    const size_t num_events = m_axis->size();
     if (diffs.size() != nk * num_events) {
         fprintf(stderr, "invalid # of differentials in write_diffs_report\n");
         return;
     }
 
     // attempt to open the differential report file for writing
-    const string path = util::concat_name(m_results, "differentials.csv");
+    const string path = util::concat_name(dir, "differentials.csv");
     ofstream report(path.c_str());
 
     if (!report.is_open()) {
@@ -279,7 +1490,7 @@ void attack_engine::write_diffs_report(const vector<double> &diffs, int nk)
     double max_diff = 0.0;
     size_t sample_number = 0;
 
-    foreach (uint32_t sample_time, m_reader->events()) {
+    foreach (uint32_t sample_time, *m_axis) {
         report << scientific << sample_time;
         for (int k = 0; k < nk; ++k) {
             double value = diffs[k * num_events + sample_number];
@@ -298,13 +1509,20 @@ void attack_engine::write_diffs_report(const vector<double> &diffs, int nk)
 }
 
 // -----------------------------------------------------------------------------
-void attack_engine::write_maxes_report(const vector<double> &maxes, int nk)
+size_t attack_engine::report_traces(size_t i) const
+{
+    return m_report_marks.empty() ? m_interval * (i + 1) : m_report_marks[i];
+}
+
+// -----------------------------------------------------------------------------
+void attack_engine::write_maxes_report(const string &dir,
+                                       const vector<double> &maxes, int nk)
 {
     if (m_reports == 1 || maxes.size() != nk * m_reports)
         return;
 
     // attempt to open the confidence interval report file for writing
-    const string path = util::concat_name(m_results, "interval_maxes.csv");
+    const string path = util::concat_name(dir, "interval_maxes.csv");
     ofstream report(path.c_str());
 
     if (!report.is_open()) {
@@ -315,20 +1533,21 @@ void attack_engine::write_maxes_report(const vector<double> &maxes, int nk)
 
     for (size_t i = 0; i < m_reports; ++i) {
         const double *m = &maxes[i * nk];
-        report << scientific << m_interval * (i + 1);
+        report << scientific << report_traces(i);
         for (int k = 0; k < nk; ++k) report << ',' << m[k];
         report << endl;
     }
 }
 
 // -----------------------------------------------------------------------------
-void attack_engine::write_confs_report(const vector<double> &maxes, int nk)
+void attack_engine::write_confs_report(const string &dir,
+                                       const vector<double> &maxes, int nk)
 {
     if (m_reports == 1 || maxes.size() != nk * m_reports)
         return;
 
     // attempt to open the confidence interval report file for writing
-    const string path = util::concat_name(m_results, "confidence_interval.csv");
+    const string path = util::concat_name(dir, "confidence_interval.csv");
     ofstream report(path.c_str());
 
     if (!report.is_open()) {
@@ -346,7 +1565,7 @@ void attack_engine::write_confs_report(const vector<double> &maxes, int nk)
 
     for (size_t i = 0; i < m_reports; ++i) {
         // compute the confidence ratio for each key guess in this interval
-        report << scientific << m_interval * (i + 1);
+        report << scientific << report_traces(i);
         for (int k = 0; k < nk; ++k) {
             double correct = maxes[i * nk + k];
             double incorrect = 0.0;
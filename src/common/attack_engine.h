@@ -20,10 +20,16 @@
 #include <vector>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "trace_format.h"
 
+class attack_instance;
 class attack_thread;
 class report_thread;
+struct checkpoint_header;
+class trace_ring;
 
 //! front-end for performing power analysis attacks
 class attack_engine {
@@ -38,6 +44,15 @@ public:
         std::string result_path;
         unsigned int num_threads;
         unsigned int report_tick;
+        unsigned int report_secs;
+        unsigned int batch_size;
+        unsigned int checkpoint;
+        unsigned int converge;
+        double converge_ratio;
+        unsigned int shard_index;
+        unsigned int shard_count;
+        std::string resume_path;
+        bool split;
     };
 
     //! attack_engine constructor -- set default parameters
@@ -49,18 +64,30 @@ public:
     //! execute the attack and write the results to results_path
     bool run(const options &opt, trace_reader *pReader);
 
-    //! fetch the next power trace for processing
-    bool next_trace(int id, std::vector<long> &tm, trace &pt);
+    //! merge the final checkpoints of several trace ranges of an attack
+    bool merge(const options &opt, const std::vector<std::string> &paths);
+
+    //! fetch the next batch of power traces for processing
+    bool next_batch(int id, std::vector<trace> &batch);
+
+    //! stop reading traces and release all worker threads
+    void cancel(void);
 
 protected:
     //! write the differential trace report
-    void write_diffs_report(const std::vector<double> &diffs, int guesses);
+    void write_diffs_report(const std::string &dir,
+                            const std::vector<double> &diffs, int guesses);
 
     //! write the maximum trace report
-    void write_maxes_report(const std::vector<double> &maxes, int guesses);
+    void write_maxes_report(const std::string &dir,
+                            const std::vector<double> &maxes, int guesses);
+
+    //! return the number of traces processed at the end of report i
+    size_t report_traces(size_t i) const;
 
     //! write the confidence interval report
-    void write_confs_report(const std::vector<double> &maxes, int guesses);
+    void write_confs_report(const std::string &dir,
+                            const std::vector<double> &maxes, int guesses);
 
     //! perform pre-attack initialization
     bool attack_setup(const options &opt, trace_reader *pReader);
@@ -68,18 +95,95 @@ protected:
     //! perform post-attack shutdown
     void attack_shutdown(void);
 
+    //! restore the attack state from a checkpoint of the same attack
+    bool attack_resume(const std::string &path,
+                       const checkpoint_header &header);
+
+    //! write the reports for every target of a merged attack instance
+    void report_attack(attack_instance *attack, int guesses);
+
+    //! create and return the report directory of the named target
+    std::string target_directory(const std::string &name);
+
+    //! write the reports for the selected target to the specified directory
+    void write_reports(const std::string &dir, const std::vector<double> &diffs,
+                       const std::vector<double> &maxes, int guesses);
+
+    //! read traces into the ring buffer (reader thread entry point)
+    void read_traces(void);
+
+    //! account for a processed batch, recording the interval if complete
+    void complete_batch(size_t count);
+
+    //! record the report interval ending after the specified trace count
+    void record_report(size_t processed);
+
+    //! end the report interval after the traces read so far (stream mode)
+    void end_interval(void);
+
+    //! write the reports of a streamed attack after each interval
+    void stream_report(attack_instance *attack, size_t processed);
+
+    //! check the key ranking of each target after interval 'index' has been
+    //! recorded, and stop the attack once every ranking is stable
+    bool monitor_report(attack_instance *attack, size_t index);
+
+    //! update the ranking of a target with its latest interval maxes, and
+    //! return true if it has been stable for the required number of reports
+    bool converged(size_t target, const double *maxes, int guesses);
+
+    //! fetch this thread's sample range of the next batch (split mode)
+    bool next_split_batch(int id, std::vector<trace> &batch);
+
+    //! combine the differentials and maxes of each sample range (split mode)
+    void gather_split_results(std::vector<double> &diffs,
+                              std::vector<double> &maxes, int guesses);
+
 protected:
     size_t              m_reports;  //! total number of reports to generate
     size_t              m_interval; //! user specified reporting interval
-    size_t              m_index;    //! current available trace index
+    size_t              m_index;    //! next trace index to be read
+    size_t              m_first;    //! index of the first trace to attack
+    size_t              m_ntraces;  //! number of traces to attack
     size_t              m_nthreads; //! number of threads to launch
+    size_t              m_nevents;  //! number of samples in every trace
+    size_t              m_batch;    //! maximum number of traces per batch
     std::string         m_results;  //! output results directory
+    trace::time_axis_ptr m_axis;    //! time of each sample
     trace_reader       *m_reader;   //! generic trace reader
-    boost::mutex        m_mutex;    //! critical section for trace_reader
+    boost::mutex        m_mutex;    //! critical section for report boundary
     boost::thread_group m_group;    //! collection of worker threads
     thread_list         m_threads;  //! collection of worker instances
     report_thread      *m_rt;
     boost::thread       m_thrd;
+
+    boost::scoped_ptr<trace_ring> m_ring;        //! batches read ahead
+    boost::thread                 m_rthrd;       //! reader thread
+    boost::condition_variable     m_report_cond; //! signals a recorded report
+    boost::atomic<size_t>         m_next_report; //! next interval boundary
+    boost::atomic<size_t>         m_processed;   //! traces processed so far
+    boost::atomic<size_t>         m_claimed;     //! last boundary recorded
+    boost::atomic<bool>           m_cancel;      //! stop the attack early
+
+    typedef std::pair<size_t, size_t> sample_range;
+
+    bool                      m_split;     //! split samples across threads
+    bool                      m_epochs;    //! workers hand over interval deltas
+    std::vector<sample_range> m_slices;    //! first sample and count per thread
+    std::vector<trace::time_axis_ptr> m_slice_axes; //! time axis per thread
+    std::vector<size_t>       m_cursor;    //! ring position of each thread
+    std::vector<size_t>       m_batch_end; //! end of each thread's last batch
+
+    bool                      m_stream;      //! traces are read from a stream
+    size_t                    m_report_secs; //! report period (stream mode)
+    std::vector<size_t>       m_report_marks; //! trace count of each report
+    std::vector<std::vector<double> > m_stream_maxes; //! maxes of each target
+
+    size_t                    m_converge;    //! stable reports before stopping
+    double                    m_converge_ratio; //! minimum best/second ratio
+    std::vector<int>          m_leader;      //! best guess of each target
+    std::vector<size_t>       m_stable;      //! reports the leader has held
+    bool                      m_converged;   //! stopped once rankings stable
 };
 
 #endif // ATTACK_ENGINE__H
@@ -0,0 +1,468 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cmath>
+#include "attack_engine.h"
+#include "attack_manager.h"
+#include "simd.h"
+
+using namespace std;
+using namespace util;
+
+// maximum message partition size, beyond which the class sums are impractical
+#define MAX_PARTITION_BITS 12
+
+// maximum number of bits of the sensitive value in the regression basis
+#define MAX_LRA_BITS 16
+
+// -----------------------------------------------------------------------------
+// Linear regression analysis, where each sample is regressed on a basis of
+// the sensitive value for every key guess: a constant and each of the 'bits'
+// bits from 'offset' (every bit of the target by default), so that every bit
+// may leak with its own weight rather than the Hamming weight. The goodness
+// of fit R^2 is the differential.
+//
+// As in cpa_class, traces are aggregated by message partition, so a trace
+// costs O(samples). Both normal equations of a guess are rebuilt from the
+// class sums when the differentials are computed: X^T X from the class counts,
+// and each row of X^T t as the sum of the classes whose value has that bit
+// set. X^T X is factored as L D L^T, then g = L^-1 X^T t gives the explained
+// sum of squares as the sum of g_j^2 / D_j over the non-constant basis.
+template <typename real>
+class attack_lra: public attack_instance {
+public:
+    attack_lra();
+    virtual ~attack_lra();
+
+    virtual bool setup(crypto_instance *crypto, const parameters &params);
+    virtual void process(const trace &pt);
+    virtual void record_interval(size_t n);
+    virtual void clone(const attack_instance *inst);
+    virtual void coalesce(const attack_instance *inst);
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
+    virtual void write_results(const string &path);
+    virtual bool cleanup();
+
+    virtual void get_diffs(vector<double> &diffs);
+    virtual void get_maxes(vector<double> &maxes);
+
+    virtual bool split_samples(void) const { return true; }
+
+protected:
+    void factor(int k, double *l, double *dg);
+    void compute_diffs(real *d, real *m);
+
+    crypto_instance *m_crypto;
+    size_t m_traces;
+    size_t m_nevents;
+    size_t m_nreports;
+    size_t m_nclasses;
+    size_t m_nbasis;          // constant plus one function per bit
+    unsigned int m_byte, m_offset, m_bits;
+    vector<real> m_t2;        // sum of squared traces
+    vector<real> m_ct;        // sum of traces for each class
+    vector<size_t> m_cn;      // number of traces in each class
+    vector<int> m_cv;         // basis bits of each guess for each class
+    vector<real> m_power;     // power samples, if converted
+    vector<real> m_dtemp;
+    vector<real> m_maxes;
+    int m_guesses;
+    boost::mutex m_mutex;
+};
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_lra<real>::attack_lra()
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_lra<real>::~attack_lra()
+{
+}
+
+// -----------------------------------------------------------------------------
+// Build X^T X of guess k from the class counts and factor it as L D L^T, with
+// L unit lower triangular. A basis function that is a combination of earlier
+// ones (such as a bit that never varies) adds nothing to the fit, so it is
+// dropped by leaving its pivot in dg at zero.
+template <typename real>
+void attack_lra<real>::factor(int k, double *l, double *dg)
+{
+    const size_t nb = m_nbasis;
+
+    // the Gram matrix is kept in double, whatever the precision of the sums
+    vector<double> a(nb * nb, 0);
+    double x[MAX_LRA_BITS + 1];
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (!m_cn[c]) continue;
+
+        const int v = m_cv[c * m_guesses + k];
+        x[0] = 1;
+        for (size_t j = 1; j < nb; ++j) x[j] = (v >> (j - 1)) & 1;
+
+        for (size_t i = 0; i < nb; ++i) {
+            if (!x[i]) continue;
+            for (size_t j = 0; j <= i; ++j)
+                a[i * nb + j] += x[j] * m_cn[c];
+        }
+    }
+
+    for (size_t j = 0; j < nb; ++j) {
+        double d = a[j * nb + j];
+        for (size_t p = 0; p < j; ++p)
+            d -= l[j * nb + p] * l[j * nb + p] * dg[p];
+
+        l[j * nb + j] = 1;
+        dg[j] = (d > 1e-9 * a[j * nb + j]) ? d : 0;
+        for (size_t i = j + 1; i < nb; ++i) {
+            double v = 0;
+            if (dg[j]) {
+                v = a[i * nb + j];
+                for (size_t p = 0; p < j; ++p)
+                    v -= l[i * nb + p] * l[j * nb + p] * dg[p];
+                v /= dg[j];
+            }
+            l[i * nb + j] = v;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Compute the differential of each key guess into d, and raise the interval
+// maxes m in the same pass. Either d or m may be NULL.
+template <typename real>
+void attack_lra<real>::compute_diffs(real *d, real *m)
+{
+    const size_t nb = m_nbasis;
+    const real ni = 1.0 / m_traces;
+
+    // the constant row of X^T t is the sum of traces for every guess
+    vector<real> g(nb * m_nevents), sst(m_nevents), r2(m_nevents);
+    real *t1 = &g[0];
+    fill(t1, t1 + m_nevents, 0);
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (m_cn[c]) simd::add(t1, &m_ct[c * m_nevents], m_nevents);
+    }
+
+    // the total sum of squares is independent of the key guess
+    for (size_t s = 0; s < m_nevents; ++s)
+        sst[s] = m_t2[s] - t1[s] * t1[s] * ni;
+
+    vector<double> l(nb * nb), dg(nb);
+    for (int k = 0; k < m_guesses; ++k) {
+        factor(k, &l[0], &dg[0]);
+
+        // build each remaining row of X^T t from the class sums
+        fill(g.begin() + m_nevents, g.end(), 0);
+        for (size_t c = 0; c < m_nclasses; ++c) {
+            if (!m_cn[c]) continue;
+
+            const int v = m_cv[c * m_guesses + k];
+            for (size_t j = 1; j < nb; ++j) {
+                if ((v >> (j - 1)) & 1) {
+                    simd::add(&g[j * m_nevents], &m_ct[c * m_nevents],
+                              m_nevents);
+                }
+            }
+        }
+
+        // forward substitution of L g = X^T t, one row of samples at a time,
+        // accumulating the explained sum of squares of the non-constant rows
+        fill(r2.begin(), r2.end(), 0);
+        for (size_t j = 1; j < nb; ++j) {
+            real *gj = &g[j * m_nevents];
+            if (!dg[j]) continue;
+
+            for (size_t p = 0; p < j; ++p) {
+                if (l[j * nb + p])
+                    simd::axpy(gj, &g[p * m_nevents], (real)-l[j * nb + p],
+                               m_nevents);
+            }
+
+            const real di = 1.0 / dg[j];
+            for (size_t s = 0; s < m_nevents; ++s) r2[s] += gj[s] * gj[s] * di;
+        }
+
+        for (size_t s = 0; s < m_nevents; ++s)
+            r2[s] = util::nonzero(sst[s]) ? r2[s] / sst[s] : 0;
+
+        if (d) copy(r2.begin(), r2.end(), &d[k * m_nevents]);
+        if (m) m[k] = simd::max(&r2[0], m_nevents, m[k]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_lra<real>::setup(crypto_instance *crypto,
+                             const parameters &params)
+{
+    if (!params.get("num_events", m_nevents) ||
+        !params.get("num_reports", m_nreports) ||
+        !params.get("byte", m_byte)) {
+        fprintf(stderr, "required parameters: byte\n");
+        return false;
+    }
+
+    m_offset = 0;
+    m_bits = crypto->target_bits();
+    params.get("offset", m_offset);
+    params.get("bits", m_bits);
+    if (!m_bits || m_bits > MAX_LRA_BITS) {
+        fprintf(stderr, "the regression basis must be 1 to %d bits\n",
+                MAX_LRA_BITS);
+        return false;
+    }
+
+    if (crypto->partition_bits() > MAX_PARTITION_BITS) {
+        fprintf(stderr, "message partition too large (%d bits)\n",
+                crypto->partition_bits());
+        return false;
+    }
+
+    m_crypto = crypto;
+    m_guesses = 1 << m_crypto->estimate_bits();
+    m_nclasses = 1 << m_crypto->partition_bits();
+    m_nbasis = m_bits + 1;
+    m_traces = 0;
+
+    // allocate storage for intermediate results in advance
+    m_t2.resize(m_nevents, 0);
+    m_ct.resize(m_nclasses * m_nevents, 0);
+    m_cn.resize(m_nclasses, 0);
+    m_cv.resize(m_nclasses * m_guesses, 0);
+    m_power.resize(m_nevents, 0);
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+    m_maxes.resize(m_guesses * m_nreports, 0);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    const int c = m_crypto->partition(m_byte);
+
+    // compute the basis bits the first time this class is encountered
+    if (!m_cn[c]) {
+        int *cv = &m_cv[c * m_guesses];
+        m_crypto->compute_all(m_byte, cv);
+        for (int k = 0; k < m_guesses; ++k)
+            cv[k] = (cv[k] >> m_offset) & ((1 << m_bits) - 1);
+    }
+
+    // accumulate power into the class sum and power^2 for each sample
+    const real *p = power_samples(pt, &m_power[0]);
+    simd::add_sq(&m_ct[c * m_nevents], &m_t2[0], p, m_nevents);
+
+    ++m_cn[c];
+    ++m_traces;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // compute the interval maxes, without storing the differentials
+    compute_diffs(NULL, &m_maxes[n * m_guesses]);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::clone(const attack_instance *inst)
+{
+    attack_lra *other = (attack_lra *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    m_traces = other->m_traces;
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_nclasses = other->m_nclasses;
+    m_nbasis = other->m_nbasis;
+    m_guesses = other->m_guesses;
+
+    m_t2 = other->m_t2;
+    m_ct = other->m_ct;
+    m_cn = other->m_cn;
+    m_cv = other->m_cv;
+
+    if (!m_maxes.size()) {
+        m_dtemp.resize(other->m_dtemp.size(), 0);
+        m_maxes.resize(other->m_maxes.size(), 0);
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::coalesce(const attack_instance *inst)
+{
+    attack_lra *other = (attack_lra *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+    coalesce_range(inst, 0, m_nevents);
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::coalesce_range(const attack_instance *inst,
+                                      size_t first, size_t last)
+{
+    const attack_lra *other = (const attack_lra *)inst;
+    const size_t count = last - first;
+
+    assert(m_guesses == other->m_guesses);
+    assert(m_nevents == other->m_nevents);
+    assert(m_nclasses == other->m_nclasses);
+    assert(first <= last && last <= m_nevents);
+
+    if (count)
+        simd::add(&m_t2[first], &other->m_t2[first], count);
+
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (!other->m_cn[c]) continue;
+
+        if (count) {
+            const size_t off = c * m_nevents + first;
+            simd::add(&m_ct[off], &other->m_ct[off], count);
+        }
+        if (first) continue;
+
+        // adopt the basis bits if this class has not been seen locally
+        if (!m_cn[c]) {
+            for (int k = 0; k < m_guesses; ++k)
+                m_cv[c * m_guesses + k] = other->m_cv[c * m_guesses + k];
+        }
+        m_cn[c] += other->m_cn[c];
+    }
+
+    if (!first) m_traces += other->m_traces;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_lra<real>::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // the basis bits are recomputed when a class is next encountered
+    m_traces = 0;
+    fill(m_t2.begin(), m_t2.end(), 0);
+    fill(m_ct.begin(), m_ct.end(), 0);
+    fill(m_cn.begin(), m_cn.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_lra<real>::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    write_value<uint32_t>(os, sizeof(real));
+    write_value<uint64_t>(os, m_traces);
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_nclasses);
+    write_value<uint64_t>(os, m_nbasis);
+    write_value<int32_t>(os, m_guesses);
+
+    write_vector(os, m_t2);
+    write_vector(os, m_ct);
+    write_vector(os, m_cn);
+    write_vector(os, m_cv);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_lra<real>::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint32_t size = 0;
+    uint64_t traces = 0, nevents = 0, nclasses = 0, nbasis = 0;
+    int32_t guesses = 0;
+    if (!read_value(is, size) || size != sizeof(real) ||
+        !read_value(is, traces) || !read_value(is, nevents) ||
+        !read_value(is, nclasses) || !read_value(is, nbasis) ||
+        !read_value(is, guesses) || guesses <= 0 || nbasis < 2 ||
+        nbasis > MAX_LRA_BITS + 1) {
+        return false;
+    }
+
+    if (!read_vector(is, m_t2) || !read_vector(is, m_ct) ||
+        !read_vector(is, m_cn) || !read_vector(is, m_cv) ||
+        !read_vector(is, m_maxes)) {
+        return false;
+    }
+
+    m_traces = traces;
+    m_nevents = nevents;
+    m_nclasses = nclasses;
+    m_nbasis = nbasis;
+    m_guesses = guesses;
+    m_nreports = m_maxes.size() / m_guesses;
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+
+    return m_t2.size() == m_nevents && m_ct.size() == m_nclasses * m_nevents &&
+           m_cn.size() == m_nclasses && m_cv.size() == m_nclasses * m_guesses;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::get_diffs(vector<double> &diffs)
+{
+    compute_diffs(&m_dtemp[0], NULL);
+
+    diffs.resize(m_guesses * m_nevents);
+    for (size_t i = 0; i < m_guesses * m_nevents; ++i)
+        diffs[i] = m_dtemp[i];
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::get_maxes(vector<double> &maxes)
+{
+    maxes.resize(m_guesses * m_nreports);
+    for (size_t i = 0; i < m_guesses * m_nreports; ++i)
+        maxes[i] = m_maxes[i];
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_lra<real>::write_results(const string &path)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_lra<real>::cleanup()
+{
+    return true;
+}
+
+register_attack(lra, attack_lra<float>);
+register_attack(lra_dp, attack_lra<double>);
@@ -17,11 +17,37 @@
 #ifndef ATTACK_MANAGER__H
 #define ATTACK_MANAGER__H
 
+#include <cassert>
 #include <cstdio>
+#include <algorithm>
 #include "trace.h"
 #include "utility.h"
 
-typedef std::vector<long> time_map;
+//! Return the power samples of a trace as an array of the specified type. A
+//! single precision array is returned directly; otherwise it's copied to buf.
+template <typename real>
+inline const real *power_samples(const trace &pt, real *buf)
+{
+    std::copy(pt.power(), pt.power() + pt.size(), buf);
+    return buf;
+}
+
+template <>
+inline const float *power_samples(const trace &pt, float *buf)
+{
+    return pt.power();
+}
+
+//! Integer samples are the levels of a trace from an integer dataset. An
+//! attack on integer samples must check in setup that the dataset has them.
+template <>
+inline const int32_t *power_samples(const trace &pt, int32_t *buf)
+{
+    const trace::level *levels = pt.levels();
+    assert(levels);
+    std::copy(levels, levels + pt.size(), buf);
+    return buf;
+}
 
 //! Abstract interface for crypto instance objects.
 class crypto_instance {
@@ -38,6 +64,19 @@ public:
     //! Compute the sensitive value for the given key guess.
     virtual int compute(int n, int k) = 0;
 
+    //! Compute the sensitive value for every key guess at once, storing
+    //! compute(n, k) in values[k] for each of the 2^estimate_bits() guesses.
+    virtual void compute_all(int n, int *values) {
+        const int guesses = 1 << estimate_bits();
+        for (int k = 0; k < guesses; ++k) values[k] = compute(n, k);
+    }
+
+    //! Return the message partition that determines compute(n, k) for all k.
+    virtual int partition(int n) = 0;
+
+    //! Return the size of the message partition index in bits.
+    virtual int partition_bits() = 0;
+
     //! Return the total size of the encryption key in bits.
     virtual int key_bits() = 0;
 
@@ -60,8 +99,18 @@ public:
     //! Process attack parameters and perform pre-attack initialization.
     virtual bool setup(crypto_instance *crypto, const util::parameters &params) = 0;
 
-    //! Process a single power trace / message pair.
-    virtual void process(const time_map &tmap, const trace &pt) = 0;
+    //! Process a single power trace / message pair. Each trace contains one
+    //! sample for every event, in event order.
+    virtual void process(const trace &pt) = 0;
+
+    //! Process a batch of power traces, providing each message to crypto.
+    virtual void process_batch(crypto_instance *crypto,
+                               const std::vector<trace> &batch) {
+        foreach (const trace &pt, batch) {
+            crypto->set_message(pt.text());
+            process(pt);
+        }
+    }
 
     //! Record the intermediate attack state for the specified interval.
     virtual void record_interval(size_t n) = 0;
@@ -72,6 +121,31 @@ public:
     //! Merge the state of two attack_instance objects together.
     virtual void coalesce(const attack_instance *inst) = 0;
 
+    //! Merge samples [first, last) of the state of 'inst' into this instance,
+    //! so that disjoint ranges of one merge can run concurrently. State that
+    //! is not kept per sample is merged with the range starting at sample 0.
+    //! Neither instance may be in use elsewhere while ranges are merged.
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last) {
+        if (!first) coalesce(inst);
+    }
+
+    //! Returns true if the attack works on any contiguous range of the samples
+    //! of each trace, so that the samples may be split across threads.
+    virtual bool split_samples(void) const { return false; }
+
+    //! Clear the accumulated state, keeping the configuration from setup, so
+    //! that the instance accumulates a delta to be coalesced into another.
+    //! Returns false if the attack cannot be reset.
+    virtual bool reset(void) { return false; }
+
+    //! Write the accumulated attack state to a binary stream, returning false
+    //! if the attack does not support checkpoints.
+    virtual bool save(std::ostream &os) { return false; }
+
+    //! Restore the accumulated attack state written by save.
+    virtual bool load(std::istream &is) { return false; }
+
     //! Write attack results to the specified directory
     virtual void write_results(const std::string &path) = 0;
 
@@ -84,6 +158,15 @@ public:
     //! Return trace maxes for each recorded interval.
     virtual void get_maxes(std::vector<double> &maxes) = 0;
 
+    //! Return the number of targets attacked in a single pass.
+    virtual size_t num_targets(void) { return 1; }
+
+    //! Select the target returned by get_diffs and get_maxes, and return its
+    //! name and number of key guesses (left unchanged by default, from the
+    //! estimate bits of the crypto). The name is only used with multiple
+    //! targets.
+    virtual void select_target(size_t t, std::string &name, int &guesses) {}
+
     //! Explicit virtual destructor, as attack_instance will be subclassed
     virtual ~attack_instance() {}
 };
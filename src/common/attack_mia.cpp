@@ -0,0 +1,427 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cmath>
+#include "attack_engine.h"
+#include "attack_manager.h"
+
+using namespace std;
+using namespace util;
+
+// maximum message partition size, beyond which the histograms are impractical
+#define MAX_PARTITION_BITS 12
+
+// maximum number of bins each sample may be quantized into
+#define MAX_MIA_BINS 64
+
+// -----------------------------------------------------------------------------
+// Mutual information analysis, a distinguisher that makes no assumption about
+// the shape of the leakage. Each sample is quantized into 'bins' equal bins
+// over ['low', 'high'), the ends taking anything beyond, and the mutual
+// information between the bin and the Hamming weight of 'bits' bits from
+// 'offset' of the sensitive value is the differential of each guess.
+//
+// As in cpa_class, traces are aggregated by message partition: each trace
+// increments one integer histogram per sample for its class, whatever the
+// number of guesses. The joint histogram of leakage and bin for a guess is
+// the sum of the class histograms of each weight, and the information is
+//
+//   I = (sum n_wb log n_wb - sum n_w log n_w - sum n_b log n_b + N log N) / N
+//
+// where n_wb, n_w and n_b count the traces of each weight and bin, and N is
+// the number of traces; the bin entropy term is common to every guess.
+class attack_mia: public attack_instance {
+public:
+    typedef uint32_t count;
+
+    attack_mia();
+    virtual ~attack_mia();
+
+    virtual bool setup(crypto_instance *crypto, const parameters &params);
+    virtual void process(const trace &pt);
+    virtual void record_interval(size_t n);
+    virtual void clone(const attack_instance *inst);
+    virtual void coalesce(const attack_instance *inst);
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
+    virtual void write_results(const string &path);
+    virtual bool cleanup();
+
+    virtual void get_diffs(vector<double> &diffs);
+    virtual void get_maxes(vector<double> &maxes);
+
+    virtual bool split_samples(void) const { return true; }
+
+protected:
+    void compute_diffs(double *d, double *m);
+
+    crypto_instance *m_crypto;
+    size_t m_traces;
+    size_t m_nevents;
+    size_t m_nreports;
+    size_t m_nclasses;
+    size_t m_nbins;
+    size_t m_nweights;
+    unsigned int m_mask, m_byte, m_offset, m_bits;
+    float m_low, m_scale;     // quantization of the power samples
+    vector<count> m_hist;     // histogram of each class (class x events x bins)
+    vector<size_t> m_cn;      // number of traces in each class
+    vector<int> m_cw;         // weight of each guess for each class
+    vector<int32_t> m_bin;    // bin of each sample of the current trace
+    vector<float> m_power;    // power samples, if converted
+    vector<double> m_dtemp;
+    vector<double> m_maxes;
+    int m_guesses;
+    boost::mutex m_mutex;
+};
+
+// -----------------------------------------------------------------------------
+// Return x log x, taking 0 log 0 as zero.
+static inline double xlogx(double x)
+{
+    return (x > 0) ? x * log(x) : 0;
+}
+
+// -----------------------------------------------------------------------------
+attack_mia::attack_mia()
+{
+}
+
+// -----------------------------------------------------------------------------
+attack_mia::~attack_mia()
+{
+}
+
+// -----------------------------------------------------------------------------
+// Compute the differential of each key guess into d, and raise the interval
+// maxes m in the same pass. Either d or m may be NULL.
+void attack_mia::compute_diffs(double *d, double *m)
+{
+    const size_t cells = m_nevents * m_nbins;
+    const double n = (double)m_traces;
+
+    // the bin entropy term is independent of the key guess
+    vector<count> joint(m_nweights * cells);
+    vector<double> base(m_nevents, xlogx(n)), info(m_nevents);
+    fill(joint.begin(), joint.begin() + cells, 0);
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (!m_cn[c]) continue;
+
+        const count *h = &m_hist[c * cells];
+        for (size_t i = 0; i < cells; ++i) joint[i] += h[i];
+    }
+    for (size_t s = 0; s < m_nevents; ++s) {
+        for (size_t b = 0; b < m_nbins; ++b)
+            base[s] -= xlogx(joint[s * m_nbins + b]);
+    }
+
+    vector<size_t> nw(m_nweights);
+    for (int k = 0; k < m_guesses; ++k) {
+        // sum the class histograms of each weight into the joint histogram
+        fill(joint.begin(), joint.end(), 0);
+        fill(nw.begin(), nw.end(), 0);
+        for (size_t c = 0; c < m_nclasses; ++c) {
+            if (!m_cn[c]) continue;
+
+            const int w = m_cw[c * m_guesses + k];
+            const count *h = &m_hist[c * cells];
+            count *j = &joint[w * cells];
+            for (size_t i = 0; i < cells; ++i) j[i] += h[i];
+            nw[w] += m_cn[c];
+        }
+
+        double wterm = 0;
+        for (size_t w = 0; w < m_nweights; ++w) wterm += xlogx(nw[w]);
+
+        for (size_t s = 0; s < m_nevents; ++s) {
+            double v = base[s] - wterm;
+            for (size_t w = 0; w < m_nweights; ++w) {
+                if (!nw[w]) continue;
+
+                const count *j = &joint[w * cells + s * m_nbins];
+                for (size_t b = 0; b < m_nbins; ++b) v += xlogx(j[b]);
+            }
+
+            // in bits, and never negative through rounding
+            info[s] = max(v / (n * M_LN2), 0.0);
+        }
+
+        if (d) copy(info.begin(), info.end(), &d[k * m_nevents]);
+        if (m) {
+            for (size_t s = 0; s < m_nevents; ++s) m[k] = max(m[k], info[s]);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool attack_mia::setup(crypto_instance *crypto, const parameters &params)
+{
+    float high = 0;
+    if (!params.get("num_events", m_nevents) ||
+        !params.get("num_reports", m_nreports) ||
+        !params.get("byte", m_byte) ||
+        !params.get("offset", m_offset) ||
+        !params.get("bits", m_bits) ||
+        !params.get("low", m_low) ||
+        !params.get("high", high)) {
+        fprintf(stderr, "required parameters: byte, offset, bits, low, high\n");
+        return false;
+    }
+
+    m_nbins = 8;
+    params.get("bins", m_nbins);
+    if (m_nbins < 2 || m_nbins > MAX_MIA_BINS || !(high > m_low)) {
+        fprintf(stderr, "bins must be 2 to %d over a range where low < high\n",
+                MAX_MIA_BINS);
+        return false;
+    }
+
+    if (crypto->partition_bits() > MAX_PARTITION_BITS) {
+        fprintf(stderr, "message partition too large (%d bits)\n",
+                crypto->partition_bits());
+        return false;
+    }
+
+    // the weighted bits must lie within the sensitive value
+    const unsigned int target_bits = crypto->target_bits();
+    if (!m_bits || m_bits > target_bits || m_offset > target_bits - m_bits) {
+        fprintf(stderr, "bits must be 1 or more, with offset + bits at most "
+                "%u\n", target_bits);
+        return false;
+    }
+
+    m_mask = 0;
+    for (unsigned int i = m_offset; i < (m_offset + m_bits); ++i)
+        m_mask |= 1u << i;
+
+    m_crypto = crypto;
+    m_guesses = 1 << m_crypto->estimate_bits();
+    m_nclasses = 1 << m_crypto->partition_bits();
+    m_nweights = m_bits + 1;
+    m_scale = m_nbins / (high - m_low);
+    m_traces = 0;
+
+    // allocate storage for intermediate results in advance
+    m_hist.resize(m_nclasses * m_nevents * m_nbins, 0);
+    m_cn.resize(m_nclasses, 0);
+    m_cw.resize(m_nclasses * m_guesses, 0);
+    m_bin.resize(m_nevents, 0);
+    m_power.resize(m_nevents, 0);
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+    m_maxes.resize(m_guesses * m_nreports, 0);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    const int c = m_crypto->partition(m_byte);
+
+    // compute the guess weights the first time this class is encountered
+    if (!m_cn[c]) {
+        int *cw = &m_cw[c * m_guesses];
+        m_crypto->compute_all(m_byte, cw);
+        for (int k = 0; k < m_guesses; ++k)
+            cw[k] = util::popcnt[cw[k] & m_mask];
+    }
+
+    // quantize every sample first, in a loop free of branches and stores to
+    // the histogram, so that it vectorizes
+    const float *p = power_samples(pt, &m_power[0]);
+    const float top = (float)(m_nbins - 1);
+    int32_t *bin = &m_bin[0];
+    for (size_t s = 0; s < m_nevents; ++s) {
+        const float v = (p[s] - m_low) * m_scale;
+        bin[s] = (int32_t)min(max(v, 0.0f), top);
+    }
+
+    count *h = &m_hist[c * m_nevents * m_nbins];
+    for (size_t s = 0; s < m_nevents; ++s)
+        ++h[s * m_nbins + bin[s]];
+
+    ++m_cn[c];
+    ++m_traces;
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // compute the interval maxes, without storing the differentials
+    compute_diffs(NULL, &m_maxes[n * m_guesses]);
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::clone(const attack_instance *inst)
+{
+    attack_mia *other = (attack_mia *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    m_traces = other->m_traces;
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_nclasses = other->m_nclasses;
+    m_nbins = other->m_nbins;
+    m_nweights = other->m_nweights;
+    m_guesses = other->m_guesses;
+
+    m_hist = other->m_hist;
+    m_cn = other->m_cn;
+    m_cw = other->m_cw;
+
+    if (!m_maxes.size()) {
+        m_dtemp.resize(other->m_dtemp.size(), 0);
+        m_maxes.resize(other->m_maxes.size(), 0);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::coalesce(const attack_instance *inst)
+{
+    attack_mia *other = (attack_mia *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+    coalesce_range(inst, 0, m_nevents);
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last)
+{
+    const attack_mia *other = (const attack_mia *)inst;
+    const size_t count = (last - first) * m_nbins;
+
+    assert(m_guesses == other->m_guesses);
+    assert(m_nevents == other->m_nevents);
+    assert(m_nclasses == other->m_nclasses);
+    assert(m_nbins == other->m_nbins);
+    assert(first <= last && last <= m_nevents);
+
+    for (size_t c = 0; c < m_nclasses; ++c) {
+        if (!other->m_cn[c]) continue;
+
+        const size_t off = (c * m_nevents + first) * m_nbins;
+        attack_mia::count *h = &m_hist[off];
+        const attack_mia::count *o = &other->m_hist[off];
+        for (size_t i = 0; i < count; ++i) h[i] += o[i];
+        if (first) continue;
+
+        // adopt the guess weights if this class has not been seen locally
+        if (!m_cn[c]) {
+            for (int k = 0; k < m_guesses; ++k)
+                m_cw[c * m_guesses + k] = other->m_cw[c * m_guesses + k];
+        }
+        m_cn[c] += other->m_cn[c];
+    }
+
+    if (!first) m_traces += other->m_traces;
+}
+
+// -----------------------------------------------------------------------------
+bool attack_mia::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // the guess weights are recomputed when a class is next encountered
+    m_traces = 0;
+    fill(m_hist.begin(), m_hist.end(), 0);
+    fill(m_cn.begin(), m_cn.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool attack_mia::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    write_value<uint64_t>(os, m_traces);
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_nclasses);
+    write_value<uint64_t>(os, m_nbins);
+    write_value<uint64_t>(os, m_nweights);
+    write_value<int32_t>(os, m_guesses);
+
+    write_vector(os, m_hist);
+    write_vector(os, m_cn);
+    write_vector(os, m_cw);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+bool attack_mia::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint64_t traces = 0, nevents = 0, nclasses = 0, nbins = 0, nweights = 0;
+    int32_t guesses = 0;
+    if (!read_value(is, traces) || !read_value(is, nevents) ||
+        !read_value(is, nclasses) || !read_value(is, nbins) ||
+        !read_value(is, nweights) || !read_value(is, guesses) ||
+        guesses <= 0) {
+        return false;
+    }
+
+    if (!read_vector(is, m_hist) || !read_vector(is, m_cn) ||
+        !read_vector(is, m_cw) || !read_vector(is, m_maxes)) {
+        return false;
+    }
+
+    m_traces = traces;
+    m_nevents = nevents;
+    m_nclasses = nclasses;
+    m_nbins = nbins;
+    m_nweights = nweights;
+    m_guesses = guesses;
+    m_nreports = m_maxes.size() / m_guesses;
+    m_dtemp.resize(m_guesses * m_nevents, 0);
+
+    return m_hist.size() == m_nclasses * m_nevents * m_nbins &&
+           m_cn.size() == m_nclasses && m_cw.size() == m_nclasses * m_guesses;
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::get_diffs(vector<double> &diffs)
+{
+    compute_diffs(&m_dtemp[0], NULL);
+    diffs = m_dtemp;
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::get_maxes(vector<double> &maxes)
+{
+    maxes = m_maxes;
+}
+
+// -----------------------------------------------------------------------------
+void attack_mia::write_results(const string &path)
+{
+}
+
+// -----------------------------------------------------------------------------
+bool attack_mia::cleanup()
+{
+    return true;
+}
+
+register_attack(mia, attack_mia);
@@ -32,10 +32,12 @@ public:
     ~attack_pscc();
 
     virtual bool setup(crypto_instance *crypto, const parameters &params);
-    virtual void process(const time_map &tmap, const trace &pt);
+    virtual void process(const trace &pt);
     virtual void record_interval(size_t n);
     virtual void clone(const attack_instance *inst);
     virtual void coalesce(const attack_instance *inst);
+    virtual void coalesce_range(const attack_instance *inst, size_t first,
+                                size_t last);
     virtual void write_results(const string &path);
     virtual bool cleanup();
 
@@ -74,6 +76,13 @@ bool attack_pscc::setup(crypto_instance *crypto, const parameters &params)
     const int key_length = crypto->key_bits() >> 3;
     string key_string;
 
+    // the states are correlated against the whole trace, not a slice of it
+    unsigned int split = 0;
+    if (params.get("split", split) && split) {
+        fprintf(stderr, "pscc cannot split the samples across threads\n");
+        return false;
+    }
+
     if (!params.get("num_events", m_nevents) ||
         !params.get("num_reports", m_nreports) ||
         !params.get("bytes", m_bytes) ||
@@ -102,7 +111,7 @@ bool attack_pscc::setup(crypto_instance *crypto, const parameters &params)
 }
 
 // -----------------------------------------------------------------------------
-void attack_pscc::process(const time_map &tmap, const trace &pt)
+void attack_pscc::process(const trace &pt)
 {
     // accumulate weight and weight^2 of the sensitive value
     real weight = 0;
@@ -115,10 +124,11 @@ void attack_pscc::process(const time_map &tmap, const trace &pt)
     m_w2 += weight * weight;
 
     // accumulate power, power^2, and power*weight for each sample
-    for (size_t s = 0; s < pt.size(); ++s) {
-        m_p1[tmap[s]] += pt[s].power;
-        m_p2[tmap[s]] += pt[s].power * pt[s].power;
-        m_pw[tmap[s]] += pt[s].power * weight;
+    const real *p = pt.power();
+    for (size_t s = 0; s < m_nevents; ++s) {
+        m_p1[s] += p[s];
+        m_p2[s] += p[s] * p[s];
+        m_pw[s] += p[s] * weight;
     }
 
     ++m_traces;
@@ -132,18 +142,40 @@ void attack_pscc::record_interval(size_t n)
 // -----------------------------------------------------------------------------
 void attack_pscc::clone(const attack_instance *inst)
 {
+    const attack_pscc *other = (attack_pscc *)inst;
+
+    m_traces = other->m_traces;
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_bytes = other->m_bytes;
+    m_offset = other->m_offset;
+    m_p1 = other->m_p1;
+    m_p2 = other->m_p2;
+    m_pw = other->m_pw;
+    m_w1 = other->m_w1;
+    m_w2 = other->m_w2;
+    m_crypto = other->m_crypto;
 }
 
 // -----------------------------------------------------------------------------
 void attack_pscc::coalesce(const attack_instance *inst)
 {
-    const attack_pscc *other = (attack_pscc *)inst;
-    
-    m_w1 += other->m_w1;
-    m_w2 += other->m_w2;
-    m_traces += other->m_traces;
+    coalesce_range(inst, 0, m_nevents);
+}
 
-    for (size_t s = 0; s < m_nevents; ++s) {
+// -----------------------------------------------------------------------------
+void attack_pscc::coalesce_range(const attack_instance *inst, size_t first,
+                                 size_t last)
+{
+    const attack_pscc *other = (const attack_pscc *)inst;
+
+    if (!first) {
+        m_w1 += other->m_w1;
+        m_w2 += other->m_w2;
+        m_traces += other->m_traces;
+    }
+
+    for (size_t s = first; s < last; ++s) {
         m_p1[s] += other->m_p1[s];
         m_p2[s] += other->m_p2[s];
         m_pw[s] += other->m_pw[s];
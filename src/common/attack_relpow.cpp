@@ -32,7 +32,7 @@ public:
     ~attack_relpow();
 
     virtual bool setup(crypto_instance *crypto, const parameters &params);
-    virtual void process(const time_map &tmap, const trace &pt);
+    virtual void process(const trace &pt);
     virtual void record_interval(size_t n);
     virtual void clone(const attack_instance *inst);
     virtual void coalesce(const attack_instance *inst);
@@ -65,6 +65,13 @@ attack_relpow::~attack_relpow()
 // -----------------------------------------------------------------------------
 bool attack_relpow::setup(crypto_instance *crypto, const parameters &params)
 {
+    // the relative power is taken over the whole trace, not a slice of it
+    unsigned int split = 0;
+    if (params.get("split", split) && split) {
+        fprintf(stderr, "relpow cannot split the samples across threads\n");
+        return false;
+    }
+
     string key_string;
     if (!params.get("num_events", m_nevents) ||
         !params.get("num_reports", m_nreports) ||
@@ -92,7 +99,7 @@ bool attack_relpow::setup(crypto_instance *crypto, const parameters &params)
 }
 
 // -----------------------------------------------------------------------------
-void attack_relpow::process(const time_map &tmap, const trace &pt)
+void attack_relpow::process(const trace &pt)
 {
     // compute the sensitive value of the known secret information
     int sensitive_value = 0;
@@ -103,8 +110,8 @@ void attack_relpow::process(const time_map &tmap, const trace &pt)
 
     // compute the maximum/peak power consumption across the samples
     real power = 0.0;
-    foreach (const trace::sample &sample, pt.samples())
-        power = max(power, (real)sample.power);
+    for (size_t s = 0; s < pt.size(); ++s)
+        power = max(power, (real)pt.power(s));
 
     m_pow[sensitive_value] += power;
     m_num[sensitive_value] += 1;
@@ -119,15 +126,23 @@ void attack_relpow::record_interval(size_t n)
 // -----------------------------------------------------------------------------
 void attack_relpow::clone(const attack_instance *inst)
 {
+    const attack_relpow *other = (attack_relpow *)inst;
+
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_bytes = other->m_bytes;
+    m_offset = other->m_offset;
+    m_pow = other->m_pow;
+    m_num = other->m_num;
+    m_crypto = other->m_crypto;
 }
 
 // -----------------------------------------------------------------------------
 void attack_relpow::coalesce(const attack_instance *inst)
 {
-    const int num_states = m_crypto->estimate_bits() * m_bytes;
-    attack_relpow *other = (attack_relpow *)inst;
+    const attack_relpow *other = (attack_relpow *)inst;
 
-    for (int i = 0; i < num_states; ++i) {
+    for (size_t i = 0; i < m_pow.size(); ++i) {
         m_pow[i] += other->m_pow[i];
         m_num[i] += other->m_num[i];
     }
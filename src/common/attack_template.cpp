@@ -0,0 +1,771 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "attack_engine.h"
+#include "attack_manager.h"
+
+using namespace std;
+using namespace util;
+
+// identifies a template file written by the profiling pass
+#define TEMPLATE_MAGIC "TEMPLATE.10"
+
+// number of traces whose class scores are evaluated together in an attack
+#define TEMPLATE_TILE_TRACES 64
+
+// -----------------------------------------------------------------------------
+// Profiled template attack on the points of interest 'poi', a list of sample
+// indices separated by colons (ranges as first-last). The class of a trace is
+// the sensitive value of 'byte', or its Hamming weight with 'hw=1'.
+//
+// Given a known 'key', the profiling pass builds the mean of every class and
+// the covariance pooled over the classes, both over the points of interest,
+// and writes them as templates to 'save' (templates.bin in the results
+// directory by default). The signal to noise ratio of every sample is also
+// reported as the differential, to help choose the points of interest; with
+// no 'poi' only the ratio is computed.
+//
+// Given 'templates', the attack pass scores every key guess by the summed log
+// likelihood of its class under the templates. The covariance is whitened by
+// its Cholesky factor L once, so that each trace costs one triangular solve
+// z = L^-1 x and one product per class with the whitened means y = L^-1 m:
+//
+//   log p(x | c) = z.y_c - |y_c|^2 / 2 + (terms common to every class)
+//
+// The scores are reported at the points of interest as the log likelihood of
+// each guess above that of the least likely guess.
+class attack_template: public attack_instance {
+public:
+    typedef double real;
+
+    attack_template();
+    ~attack_template();
+
+    virtual bool setup(crypto_instance *crypto, const parameters &params);
+    virtual void process(const trace &pt);
+    virtual void process_batch(crypto_instance *crypto,
+                               const vector<trace> &batch);
+    virtual void record_interval(size_t n);
+    virtual void clone(const attack_instance *inst);
+    virtual void coalesce(const attack_instance *inst);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
+    virtual void write_results(const string &path);
+    virtual bool cleanup();
+
+    virtual void get_diffs(vector<double> &diffs);
+    virtual void get_maxes(vector<double> &maxes);
+
+    virtual void select_target(size_t t, string &name, int &guesses);
+
+protected:
+    bool parse_pois(const string &str);
+    int classify(int value) const { return m_hw ? popcnt[value] : value; }
+    void profile(const trace &pt);
+    void score_tile(crypto_instance *crypto, const trace *pt, size_t count,
+                    bool set_messages);
+    void compute_snr(vector<real> &snr);
+    void relative_scores(vector<real> &scores);
+    bool write_templates(const string &path);
+    bool read_templates(const string &path);
+    bool whiten(void);
+
+    bool             m_profiling; //!< profiling rather than attacking
+    size_t           m_nevents;   //!< number of unique trace events
+    size_t           m_nreports;  //!< number of reports to compute
+    size_t           m_traces;    //!< number of traces processed
+    int              m_byte;      //!< index of the sensitive byte
+    bool             m_hw;        //!< classify by Hamming weight of the value
+    int              m_nclasses;  //!< number of template classes
+    int              m_nguesses;  //!< number of key guesses
+    string           m_save;      //!< path the templates are written to
+    vector<size_t>   m_pois;      //!< points of interest
+
+    // profiling state
+    vector<uint64_t> m_count;     //!< traces of each class
+    vector<real>     m_s1;        //!< sum of each class (class x events)
+    vector<real>     m_s2;        //!< sum of squares (class x events)
+    vector<real>     m_mean;      //!< class means (class x pois)
+    vector<real>     m_scatter;   //!< pooled scatter matrix (pois x pois)
+
+    // attack state
+    vector<real>     m_chol;      //!< Cholesky factor of the covariance
+    vector<real>     m_white;     //!< whitened class means (class x pois)
+    vector<real>     m_half;      //!< half squared norm of the whitened means
+    vector<real>     m_scores;    //!< log likelihood of each guess
+
+    vector<real>     m_maxes;     //!< reported values at each interval
+    vector<real>     m_power;     //!< power samples, if converted
+    crypto_instance *m_crypto;    //!< crypto instance
+    boost::mutex     m_mutex;
+};
+
+// -----------------------------------------------------------------------------
+attack_template::attack_template()
+: m_profiling(true), m_traces(0), m_nclasses(0), m_nguesses(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+attack_template::~attack_template()
+{
+}
+
+// -----------------------------------------------------------------------------
+bool attack_template::setup(crypto_instance *crypto, const parameters &params)
+{
+    // the points of interest index the whole trace, both when profiling and
+    // when attacking, so a thread cannot work on a slice of the samples
+    unsigned int split = 0;
+    if (params.get("split", split) && split) {
+        fprintf(stderr, "template cannot split the samples across threads\n");
+        return false;
+    }
+
+    if (!params.get("num_events", m_nevents) ||
+        !params.get("num_reports", m_nreports)) {
+        fprintf(stderr, "required parameters: num_events, num_reports\n");
+        return false;
+    }
+
+    m_crypto = crypto;
+    m_traces = 0;
+    m_nguesses = 1 << crypto->estimate_bits();
+    m_power.resize(m_nevents);
+
+    // an attack takes its configuration from the templates
+    const string templates = params["templates"];
+    m_profiling = templates.empty();
+    if (!m_profiling) {
+        if (!read_templates(templates) || !whiten())
+            return false;
+
+        m_scores.assign(m_nguesses, 0);
+        m_maxes.assign(m_nguesses * m_nreports, 0);
+        return true;
+    }
+
+    string key_string;
+    if (!params.get("key", key_string) || !params.get("byte", m_byte)) {
+        fprintf(stderr, "required parameters: key, byte (profiling), or "
+                        "templates (attack)\n");
+        return false;
+    }
+
+    vector<uint8_t> key(crypto->key_bits() >> 3);
+    if (!util::atob(key_string, &key[0], key.size()))
+        return false;
+    crypto->set_key(key);
+
+    int hw = 0;
+    params.get("hw", hw);
+    m_hw = (hw != 0);
+    m_nclasses = m_hw ? (crypto->target_bits() + 1)
+                      : (1 << crypto->target_bits());
+
+    m_pois.clear();
+    if (params["poi"].length() && !parse_pois(params["poi"]))
+        return false;
+
+    m_save = params["save"];
+
+    const size_t npois = m_pois.size();
+    m_count.assign(m_nclasses, 0);
+    m_s1.assign(m_nclasses * m_nevents, 0);
+    m_s2.assign(m_nclasses * m_nevents, 0);
+    m_mean.assign(m_nclasses * npois, 0);
+    m_scatter.assign(npois * npois, 0);
+    m_maxes.assign(m_nreports, 0);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool attack_template::parse_pois(const string &str)
+{
+    foreach (const string &item, util::split(str, ":")) {
+        const size_t dash = item.find('-');
+        const size_t first = strtoul(item.c_str(), NULL, 10);
+        const size_t last = (string::npos == dash) ? first :
+                            strtoul(item.c_str() + dash + 1, NULL, 10);
+
+        if (last < first || last >= m_nevents) {
+            fprintf(stderr, "invalid point of interest: %s\n", item.c_str());
+            return false;
+        }
+        for (size_t s = first; s <= last; ++s)
+            m_pois.push_back(s);
+    }
+
+    return !m_pois.empty();
+}
+
+// -----------------------------------------------------------------------------
+// Accumulate the trace into the sums of its class, and into the class mean
+// and pooled scatter over the points of interest. Each class is updated as
+// in Welford's method, so that the scatter never holds raw squared power.
+void attack_template::profile(const trace &pt)
+{
+    const int k = m_crypto->extract_estimate(m_byte);
+    const int c = classify(m_crypto->compute(m_byte, k));
+    const real *p = power_samples(pt, &m_power[0]);
+
+    real *s1 = &m_s1[c * m_nevents], *s2 = &m_s2[c * m_nevents];
+    for (size_t s = 0; s < m_nevents; ++s) {
+        s1[s] += p[s];
+        s2[s] += p[s] * p[s];
+    }
+
+    const size_t npois = m_pois.size();
+    const real n = (real)++m_count[c];
+    real *mean = npois ? &m_mean[c * npois] : NULL;
+
+    vector<real> d(npois);
+    for (size_t i = 0; i < npois; ++i) {
+        d[i] = p[m_pois[i]] - mean[i];
+        mean[i] += d[i] / n;
+    }
+
+    // (x - old mean)(x - new mean)^T, kept symmetric
+    for (size_t i = 0; i < npois; ++i) {
+        const real e = p[m_pois[i]] - mean[i];
+        real *row = &m_scatter[i * npois];
+        for (size_t j = 0; j <= i; ++j) row[j] += e * d[j];
+    }
+
+    ++m_traces;
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    if (m_profiling) profile(pt);
+    else score_tile(m_crypto, &pt, 1, false);
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::process_batch(crypto_instance *crypto,
+                                    const vector<trace> &batch)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    if (m_profiling) {
+        foreach (const trace &pt, batch) {
+            crypto->set_message(pt.text());
+            profile(pt);
+        }
+        return;
+    }
+
+    for (size_t b = 0; b < batch.size(); b += TEMPLATE_TILE_TRACES) {
+        score_tile(crypto, &batch[b],
+                   min((size_t)TEMPLATE_TILE_TRACES, batch.size() - b), true);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Score a tile of traces: whiten the points of interest of each trace, then
+// evaluate every class against the whole tile at once, so that each whitened
+// mean is read once per tile rather than once per trace.
+void attack_template::score_tile(crypto_instance *crypto, const trace *pt,
+                                 size_t count, bool set_messages)
+{
+    const size_t npois = m_pois.size();
+    vector<real> z(count * npois), u(count * m_nclasses);
+
+    // forward substitution of L z = x
+    for (size_t b = 0; b < count; ++b) {
+        const real *p = power_samples(pt[b], &m_power[0]);
+        real *zb = &z[b * npois];
+        for (size_t i = 0; i < npois; ++i) {
+            const real *row = &m_chol[i * npois];
+            real v = p[m_pois[i]];
+            for (size_t j = 0; j < i; ++j) v -= row[j] * zb[j];
+            zb[i] = v / row[i];
+        }
+    }
+
+    for (int c = 0; c < m_nclasses; ++c) {
+        const real *y = &m_white[c * npois];
+        for (size_t b = 0; b < count; ++b) {
+            const real *zb = &z[b * npois];
+            real v = 0;
+            for (size_t i = 0; i < npois; ++i) v += zb[i] * y[i];
+            u[b * m_nclasses + c] = v - m_half[c];
+        }
+    }
+
+    // each guess takes the score of the class it predicts for the trace
+    vector<int> values(m_nguesses);
+    for (size_t b = 0; b < count; ++b) {
+        if (set_messages) crypto->set_message(pt[b].text());
+        crypto->compute_all(m_byte, &values[0]);
+
+        const real *ub = &u[b * m_nclasses];
+        for (int k = 0; k < m_nguesses; ++k)
+            m_scores[k] += ub[classify(values[k])];
+    }
+
+    m_traces += count;
+}
+
+// -----------------------------------------------------------------------------
+// The ratio of the variance of the class means to the mean of the variances
+// within each class, over the classes seen so far.
+void attack_template::compute_snr(vector<real> &snr)
+{
+    snr.assign(m_nevents, 0);
+
+    int classes = 0;
+    for (int c = 0; c < m_nclasses; ++c) classes += (m_count[c] > 0);
+    if (classes < 2) return;
+
+    for (size_t s = 0; s < m_nevents; ++s) {
+        real m1 = 0, m2 = 0, noise = 0;
+        for (int c = 0; c < m_nclasses; ++c) {
+            if (!m_count[c]) continue;
+            const real n = (real)m_count[c];
+            const real m = m_s1[c * m_nevents + s] / n;
+            m1 += m;
+            m2 += m * m;
+            noise += m_s2[c * m_nevents + s] / n - m * m;
+        }
+
+        m1 /= classes;
+        const real signal = m2 / classes - m1 * m1;
+        noise /= classes;
+        snr[s] = util::nonzero(noise) ? signal / noise : 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Log likelihood of each guess above that of the least likely guess.
+void attack_template::relative_scores(vector<real> &scores)
+{
+    scores = m_scores;
+    const real low = *min_element(scores.begin(), scores.end());
+    for (int k = 0; k < m_nguesses; ++k) scores[k] -= low;
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    vector<real> v;
+    if (m_profiling) {
+        compute_snr(v);
+        m_maxes[n] = *max_element(v.begin(), v.end());
+    }
+    else {
+        relative_scores(v);
+        copy(v.begin(), v.end(), &m_maxes[n * m_nguesses]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::clone(const attack_instance *inst)
+{
+    attack_template *other = (attack_template *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    m_profiling = other->m_profiling;
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_traces = other->m_traces;
+    m_byte = other->m_byte;
+    m_hw = other->m_hw;
+    m_nclasses = other->m_nclasses;
+    m_nguesses = other->m_nguesses;
+    m_save = other->m_save;
+    m_pois = other->m_pois;
+    m_count = other->m_count;
+    m_s1 = other->m_s1;
+    m_s2 = other->m_s2;
+    m_mean = other->m_mean;
+    m_scatter = other->m_scatter;
+    m_chol = other->m_chol;
+    m_white = other->m_white;
+    m_half = other->m_half;
+    m_scores = other->m_scores;
+
+    if (!m_maxes.size())
+        m_maxes.resize(other->m_maxes.size(), 0);
+}
+
+// -----------------------------------------------------------------------------
+// Merge the state of another instance. The scatter of each class combines as
+//
+//   S = S_A + S_B + (nA nB / n) d d^T
+//
+// where d is the difference of the class means, summed over the classes.
+void attack_template::coalesce(const attack_instance *inst)
+{
+    attack_template *other = (attack_template *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    m_traces += other->m_traces;
+    if (!m_profiling) {
+        for (int k = 0; k < m_nguesses; ++k) m_scores[k] += other->m_scores[k];
+        return;
+    }
+
+    for (size_t i = 0; i < m_s1.size(); ++i) {
+        m_s1[i] += other->m_s1[i];
+        m_s2[i] += other->m_s2[i];
+    }
+
+    const size_t npois = m_pois.size();
+    for (size_t i = 0; i < m_scatter.size(); ++i)
+        m_scatter[i] += other->m_scatter[i];
+
+    vector<real> d(npois);
+    for (int c = 0; c < m_nclasses; ++c) {
+        const uint64_t nb = other->m_count[c];
+        if (!nb) continue;
+
+        const real na = (real)m_count[c], n = na + nb;
+        real *mean = &m_mean[c * npois];
+        const real *mb = &other->m_mean[c * npois];
+        for (size_t i = 0; i < npois; ++i) {
+            d[i] = mb[i] - mean[i];
+            mean[i] += d[i] * nb / n;
+        }
+
+        const real w = na * nb / n;
+        for (size_t i = 0; i < npois; ++i) {
+            real *row = &m_scatter[i * npois];
+            for (size_t j = 0; j <= i; ++j) row[j] += w * d[i] * d[j];
+        }
+
+        m_count[c] += nb;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool attack_template::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    m_traces = 0;
+    fill(m_scores.begin(), m_scores.end(), 0);
+    if (!m_profiling) return true;
+
+    fill(m_count.begin(), m_count.end(), 0);
+    fill(m_s1.begin(), m_s1.end(), 0);
+    fill(m_s2.begin(), m_s2.end(), 0);
+    fill(m_mean.begin(), m_mean.end(), 0);
+    fill(m_scatter.begin(), m_scatter.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool attack_template::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    vector<uint64_t> pois(m_pois.begin(), m_pois.end());
+    write_value<uint8_t>(os, m_profiling);
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_traces);
+    write_value<int32_t>(os, m_byte);
+    write_value<uint8_t>(os, m_hw);
+    write_value<int32_t>(os, m_nclasses);
+    write_value<int32_t>(os, m_nguesses);
+    write_string(os, m_save);
+    write_vector(os, pois);
+
+    write_vector(os, m_count);
+    write_vector(os, m_s1);
+    write_vector(os, m_s2);
+    write_vector(os, m_mean);
+    write_vector(os, m_scatter);
+    write_vector(os, m_chol);
+    write_vector(os, m_white);
+    write_vector(os, m_half);
+    write_vector(os, m_scores);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+bool attack_template::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint8_t profiling = 0, hw = 0;
+    uint64_t nevents = 0;
+    vector<uint64_t> pois;
+    if (!read_value(is, profiling) || !read_value(is, nevents) ||
+        !read_value(is, m_traces) || !read_value(is, m_byte) ||
+        !read_value(is, hw) || !read_value(is, m_nclasses) ||
+        !read_value(is, m_nguesses) || !read_string(is, m_save) ||
+        !read_vector(is, pois)) {
+        return false;
+    }
+
+    if (!read_vector(is, m_count) || !read_vector(is, m_s1) ||
+        !read_vector(is, m_s2) || !read_vector(is, m_mean) ||
+        !read_vector(is, m_scatter) || !read_vector(is, m_chol) ||
+        !read_vector(is, m_white) || !read_vector(is, m_half) ||
+        !read_vector(is, m_scores) || !read_vector(is, m_maxes)) {
+        return false;
+    }
+
+    m_profiling = (profiling != 0);
+    m_hw = (hw != 0);
+    m_nevents = nevents;
+    m_pois.assign(pois.begin(), pois.end());
+    m_nreports = m_maxes.size() / (m_profiling ? 1 : m_nguesses);
+    m_power.resize(m_nevents);
+
+    const size_t npois = m_pois.size();
+    if (m_profiling) {
+        return m_count.size() == (size_t)m_nclasses &&
+               m_s1.size() == m_nclasses * m_nevents &&
+               m_s2.size() == m_s1.size() &&
+               m_mean.size() == m_nclasses * npois &&
+               m_scatter.size() == npois * npois;
+    }
+    return m_chol.size() == npois * npois &&
+           m_white.size() == m_nclasses * npois &&
+           m_half.size() == (size_t)m_nclasses &&
+           m_scores.size() == (size_t)m_nguesses;
+}
+
+// -----------------------------------------------------------------------------
+// Write the class means and the pooled covariance over the points of interest.
+// A class that was never seen takes the mean of every profiling trace.
+bool attack_template::write_templates(const string &path)
+{
+    const size_t npois = m_pois.size();
+    vector<real> mean(m_mean), cov(npois * npois);
+
+    int classes = 0;
+    vector<real> grand(npois, 0);
+    for (int c = 0; c < m_nclasses; ++c) {
+        if (!m_count[c]) continue;
+        ++classes;
+        for (size_t i = 0; i < npois; ++i)
+            grand[i] += m_mean[c * npois + i] * m_count[c] / m_traces;
+    }
+
+    if (m_traces <= (uint64_t)classes) {
+        fprintf(stderr, "too few profiling traces to estimate a covariance\n");
+        return false;
+    }
+    else if (classes < m_nclasses) {
+        fprintf(stderr, "warning: %d of %d classes were never seen\n",
+                m_nclasses - classes, m_nclasses);
+        for (int c = 0; c < m_nclasses; ++c) {
+            if (!m_count[c])
+                copy(grand.begin(), grand.end(), &mean[c * npois]);
+        }
+    }
+
+    for (size_t i = 0; i < npois; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            cov[i * npois + j] = cov[j * npois + i] =
+                m_scatter[i * npois + j] / (m_traces - classes);
+        }
+    }
+
+    ofstream os(path.c_str(), ios::binary);
+    if (!os.is_open()) {
+        fprintf(stderr, "failed to open '%s' for writing\n", path.c_str());
+        return false;
+    }
+    printf("writing %s ...\n", path.c_str());
+
+    vector<uint64_t> pois(m_pois.begin(), m_pois.end());
+    write_string(os, TEMPLATE_MAGIC);
+    write_value<int32_t>(os, m_byte);
+    write_value<uint8_t>(os, m_hw);
+    write_value<int32_t>(os, m_nclasses);
+    write_vector(os, pois);
+    write_vector(os, m_count);
+    write_vector(os, mean);
+    write_vector(os, cov);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+// Read templates into the class means and covariance, before they are
+// whitened. The covariance is held in m_chol, to be factored in place.
+bool attack_template::read_templates(const string &path)
+{
+    ifstream is(path.c_str(), ios::binary);
+    if (!is.is_open()) {
+        fprintf(stderr, "failed to open templates '%s'\n", path.c_str());
+        return false;
+    }
+
+    string magic;
+    uint8_t hw = 0;
+    vector<uint64_t> pois;
+    if (!read_string(is, magic) || magic != TEMPLATE_MAGIC ||
+        !read_value(is, m_byte) || !read_value(is, hw) ||
+        !read_value(is, m_nclasses) || !read_vector(is, pois) ||
+        !read_vector(is, m_count) || !read_vector(is, m_mean) ||
+        !read_vector(is, m_chol) || pois.empty() ||
+        m_count.size() != (size_t)m_nclasses ||
+        m_mean.size() != m_nclasses * pois.size() ||
+        m_chol.size() != pois.size() * pois.size()) {
+        fprintf(stderr, "invalid templates '%s'\n", path.c_str());
+        return false;
+    }
+
+    m_hw = (hw != 0);
+    m_pois.assign(pois.begin(), pois.end());
+    for (size_t i = 0; i < m_pois.size(); ++i) {
+        if (m_pois[i] >= m_nevents) {
+            fprintf(stderr, "point of interest %zu is beyond the trace\n",
+                    m_pois[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Factor the covariance as L L^T in place, then whiten each class mean by
+// solving L y = m.
+bool attack_template::whiten(void)
+{
+    const size_t npois = m_pois.size();
+    real *a = &m_chol[0];
+
+    for (size_t j = 0; j < npois; ++j) {
+        real d = a[j * npois + j];
+        for (size_t k = 0; k < j; ++k) d -= a[j * npois + k] * a[j * npois + k];
+        if (d <= 0 || !util::nonzero(d)) {
+            fprintf(stderr, "template covariance is not positive definite; "
+                            "remove redundant points of interest\n");
+            return false;
+        }
+
+        a[j * npois + j] = sqrt(d);
+        for (size_t i = j + 1; i < npois; ++i) {
+            real v = a[i * npois + j];
+            for (size_t k = 0; k < j; ++k)
+                v -= a[i * npois + k] * a[j * npois + k];
+            a[i * npois + j] = v / a[j * npois + j];
+        }
+        for (size_t i = 0; i < j; ++i) a[i * npois + j] = 0;
+    }
+
+    m_white.resize(m_nclasses * npois);
+    m_half.resize(m_nclasses);
+    for (int c = 0; c < m_nclasses; ++c) {
+        const real *m = &m_mean[c * npois];
+        real *y = &m_white[c * npois], h = 0;
+        for (size_t i = 0; i < npois; ++i) {
+            real v = m[i];
+            for (size_t j = 0; j < i; ++j) v -= a[i * npois + j] * y[j];
+            y[i] = v / a[i * npois + i];
+            h += y[i] * y[i];
+        }
+        m_half[c] = h / 2;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::select_target(size_t t, string &name, int &guesses)
+{
+    name = m_profiling ? "profile" : "template";
+    guesses = m_profiling ? 1 : m_nguesses;
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::get_diffs(vector<double> &diffs)
+{
+    vector<real> v;
+    if (m_profiling) {
+        compute_snr(v);
+        diffs.assign(v.begin(), v.end());
+        return;
+    }
+
+    relative_scores(v);
+    diffs.assign(m_nguesses * m_nevents, 0);
+    for (int k = 0; k < m_nguesses; ++k) {
+        foreach (size_t s, m_pois)
+            diffs[k * m_nevents + s] = v[k];
+    }
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::get_maxes(vector<double> &maxes)
+{
+    maxes.assign(m_maxes.begin(), m_maxes.end());
+}
+
+// -----------------------------------------------------------------------------
+void attack_template::write_results(const string &path)
+{
+    if (m_profiling) {
+        printf("profiled %zu trace(s) over %zu point(s) of interest\n",
+               m_traces, m_pois.size());
+        if (m_pois.empty()) {
+            printf("no points of interest were given; choose them from the "
+                   "signal to noise ratio in differentials.csv\n");
+            return;
+        }
+
+        const string save = m_save.length() ? m_save :
+                            util::concat_name(path, "templates.bin");
+        if (!write_templates(save))
+            fprintf(stderr, "failed to write templates '%s'\n", save.c_str());
+        return;
+    }
+
+    // rank the guesses by their log likelihood
+    const string r_path = util::concat_name(path, "template_ranks.csv");
+    ofstream fp_r(r_path.c_str());
+    if (!fp_r.is_open()) {
+        fprintf(stderr, "failed to open '%s' for writing\n", r_path.c_str());
+        return;
+    }
+    printf("writing %s ...\n", r_path.c_str());
+
+    vector<pair<real, int> > ranks(m_nguesses);
+    for (int k = 0; k < m_nguesses; ++k)
+        ranks[k] = make_pair(-m_scores[k], k);
+    sort(ranks.begin(), ranks.end());
+
+    for (int r = 0; r < m_nguesses; ++r) {
+        fp_r << r << "," << ranks[r].second << "," << scientific
+             << -ranks[r].first << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool attack_template::cleanup()
+{
+    return true;
+}
+
+register_attack(template, attack_template);
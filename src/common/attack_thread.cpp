@@ -30,6 +30,8 @@ attack_thread::attack_thread(int id, attack_engine *engine)
 attack_thread::~attack_thread(void)
 {
     m_attack->cleanup();
+    if (m_spare.get())
+        m_spare->cleanup();
 }
 
 // -----------------------------------------------------------------------------
@@ -51,28 +53,54 @@ bool attack_thread::create(const string &attack, const string &crypto,
     return m_attack->setup(m_crypto.get(), params);
 }
 
+// -----------------------------------------------------------------------------
+// Create a second attack instance sharing this thread's crypto instance, which
+// is exchanged for the accumulated state at each report interval. Returns
+// false if the attack cannot be reset to accumulate deltas.
+bool attack_thread::create_spare(const string &attack,
+                                 const util::parameters &params)
+{
+    m_spare.reset(attack_manager::create_attack(attack));
+    if (!m_spare.get() || !m_spare->setup(m_crypto.get(), params) ||
+        !m_spare->reset()) {
+        m_spare.reset();
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Exchange the attack instance for the spare. Only called while this thread is
+// waiting for a batch, never while it is processing one.
+void attack_thread::swap_spare(void)
+{
+    attack_instance *attack = m_attack.release();
+    m_attack.reset(m_spare.release());
+    m_spare.reset(attack);
+}
+
 // -----------------------------------------------------------------------------
 void attack_thread::run(void)
 {
-    trace pt;
-    vector<long> mapper;
+    vector<trace> batch;
 
     // determine correct byte-length of each text and check for erroneous input
     const size_t text_len = m_crypto->block_bits() >> 3;
 
-    while (m_engine->next_trace(m_id, mapper, pt)) {
-        // provide the next plaintext/ciphertext to the crypto instance
-        const vector<uint8_t> text(pt.text());
-        if (text.size() != text_len) {
-            fprintf(stderr, "[%d] invalid plain/ciphertext specified: %s "
-                            "(expected %zu bytes, got %zu)\n",
-                    m_id, util::btoa(text).c_str(), text_len, text.size());
-            return;
+    while (m_engine->next_batch(m_id, batch)) {
+        foreach (const trace &pt, batch) {
+            const vector<uint8_t> &text = pt.text();
+            if (text.size() != text_len) {
+                fprintf(stderr, "[%d] invalid plain/ciphertext specified: %s "
+                                "(expected %zu bytes, got %zu)\n",
+                        m_id, util::btoa(text).c_str(), text_len, text.size());
+                m_engine->cancel();
+                return;
+            }
         }
-        m_crypto->set_message(text);
 
-        // run the attack algorithm on the next set of samples
-        m_attack->process(mapper, pt);
+        // run the attack algorithm on the next set of traces; the attack
+        // provides each plaintext/ciphertext to the crypto instance
+        m_attack->process_batch(m_crypto.get(), batch);
     }
 }
-
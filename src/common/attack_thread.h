@@ -34,14 +34,19 @@ public:
     bool create(const std::string &attack,
                 const std::string &crypto,
                 const util::parameters &params);
+    bool create_spare(const std::string &attack,
+                      const util::parameters &params);
+    void swap_spare(void);
     void run(void);
     attack_instance *attack(void) const { return m_attack.get(); }
+    attack_instance *spare(void) const { return m_spare.get(); }
     crypto_instance *crypto(void) const { return m_crypto.get(); }
 
 protected:
     int m_id;
     attack_engine *m_engine;
     std::auto_ptr<attack_instance> m_attack;
+    std::auto_ptr<attack_instance> m_spare;  // cleared instance to swap in
     std::auto_ptr<crypto_instance> m_crypto;
 };
 
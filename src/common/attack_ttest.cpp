@@ -0,0 +1,495 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cmath>
+#include <sstream>
+#include "attack_engine.h"
+#include "attack_manager.h"
+
+using namespace std;
+using namespace util;
+
+// highest order of t-test supported (central moments up to twice this order)
+#define MAX_TTEST_ORDER 3
+
+// t-statistic beyond which a sample is considered to leak
+#define TTEST_THRESHOLD 4.5
+
+// -----------------------------------------------------------------------------
+// Welch's t-test leakage assessment (TVLA) between two groups of traces,
+// either fixed versus random plaintexts ('fixed' as the hex plaintext), or
+// whether an intermediate value under a known key matches a specific 'value'
+// or has a given 'bit' set ('key' and 'byte'). Every order up to 'order' is
+// tested, each reported as a target with a single "guess", the t-statistic.
+//
+// The mean and central moment sums of each group are kept for every sample,
+// up to twice the highest order, and are updated one trace at a time with the
+// pairwise formulas of Pebay, which are also used to merge two instances. The
+// raw power sums that CPA uses would lose too much precision at the higher
+// orders.
+template <typename real>
+class attack_ttest: public attack_instance {
+public:
+    attack_ttest();
+    virtual ~attack_ttest();
+
+    virtual bool setup(crypto_instance *crypto, const parameters &params);
+    virtual void process(const trace &pt);
+    virtual void record_interval(size_t n);
+    virtual void clone(const attack_instance *inst);
+    virtual void coalesce(const attack_instance *inst);
+    virtual bool reset(void);
+    virtual bool save(ostream &os);
+    virtual bool load(istream &is);
+    virtual void write_results(const string &path);
+    virtual bool cleanup();
+
+    virtual void get_diffs(vector<double> &diffs);
+    virtual void get_maxes(vector<double> &maxes);
+
+    virtual bool split_samples(void) const { return true; }
+
+    virtual size_t num_targets(void) { return m_order; }
+    virtual void select_target(size_t t, string &name, int &guesses);
+
+protected:
+    int classify(const trace &pt);
+    real *moments(int g, int p) { return &m_mom[(g * m_nmom + p) * m_nevents]; }
+    const real *moments(int g, int p) const {
+        return &m_mom[(g * m_nmom + p) * m_nevents];
+    }
+    void compute_t(size_t order, real *t);
+
+    crypto_instance *m_crypto;
+    size_t m_nevents;
+    size_t m_nreports;
+    size_t m_order;    // highest order tested
+    size_t m_nmom;     // mean and central moment sums M2 .. M(2 * order)
+    size_t m_selected; // order returned by get_diffs and get_maxes (less one)
+    unsigned int m_byte;
+    int m_value;       // intermediate value of the first group, or -1
+    int m_bit;         // bit of the intermediate value selecting the group
+    vector<uint8_t> m_fixed; // fixed plaintext of the first group
+    uint64_t m_count[2]; // traces in each group
+    vector<real> m_mom;  // moments (group x moment x events)
+    vector<real> m_maxes; // largest |t| of each order (reports x orders)
+    vector<real> m_power; // power samples, if converted
+    real m_binom[2 * MAX_TTEST_ORDER + 1][2 * MAX_TTEST_ORDER + 1];
+    boost::mutex m_mutex;
+};
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_ttest<real>::attack_ttest()
+: m_order(1), m_nmom(2), m_selected(0)
+{
+    m_count[0] = m_count[1] = 0;
+
+    // binomial coefficients for the moment updates
+    for (int p = 0; p <= 2 * MAX_TTEST_ORDER; ++p) {
+        m_binom[p][0] = m_binom[p][p] = 1;
+        for (int k = 1; k < p; ++k)
+            m_binom[p][k] = m_binom[p - 1][k - 1] + m_binom[p - 1][k];
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+attack_ttest<real>::~attack_ttest()
+{
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_ttest<real>::setup(crypto_instance *crypto,
+                               const parameters &params)
+{
+    if (!params.get("num_events", m_nevents) ||
+        !params.get("num_reports", m_nreports)) {
+        fprintf(stderr, "required parameters: num_events, num_reports\n");
+        return false;
+    }
+
+    m_order = 1;
+    params.get("order", m_order);
+    if (m_order < 1 || m_order > MAX_TTEST_ORDER) {
+        fprintf(stderr, "t-test order must be 1 to %d\n", MAX_TTEST_ORDER);
+        return false;
+    }
+
+    // the groups are either fixed vs. random plaintexts, or split by an
+    // intermediate value under a known key
+    m_value = m_bit = -1;
+    m_fixed.clear();
+    if (params["fixed"].length()) {
+        m_fixed.resize(crypto->block_bits() >> 3);
+        if (!util::atob(params["fixed"], &m_fixed[0], m_fixed.size())) {
+            fprintf(stderr, "invalid fixed plaintext\n");
+            return false;
+        }
+    }
+    else {
+        string key_string;
+        if (!params.get("key", key_string) || !params.get("byte", m_byte) ||
+            (!params.get("value", m_value) && !params.get("bit", m_bit))) {
+            fprintf(stderr, "required parameters: fixed, or key, byte and "
+                            "value or bit\n");
+            return false;
+        }
+
+        vector<uint8_t> key(crypto->key_bits() >> 3);
+        if (!util::atob(key_string, &key[0], key.size()))
+            return false;
+        crypto->set_key(key);
+    }
+
+    m_crypto = crypto;
+    m_nmom = 2 * m_order;
+    m_selected = 0;
+    m_count[0] = m_count[1] = 0;
+
+    // allocate storage for intermediate results in advance
+    m_mom.assign(2 * m_nmom * m_nevents, 0);
+    m_maxes.resize(m_order * m_nreports, 0);
+    m_power.resize(m_nevents, 0);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Return the group of the trace whose message has been given to the crypto.
+template <typename real>
+int attack_ttest<real>::classify(const trace &pt)
+{
+    if (!m_fixed.empty())
+        return (pt.text() == m_fixed) ? 0 : 1;
+
+    const int v = m_crypto->compute(m_byte, m_crypto->extract_estimate(m_byte));
+    if (m_value >= 0)
+        return (v == m_value) ? 0 : 1;
+    return ((v >> m_bit) & 1) ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// Add the trace to its group, updating the mean and then the central moment
+// sums from the highest down, as each depends on the lower sums:
+//
+//   M_p += sum_k C(p, k) (-d / n)^k M_(p-k)
+//        + (d (n - 1) / n)^p (1 - (1 - n)^(1 - p))
+//
+// for k from 1 to p - 2, where d is the difference of the sample from the old
+// mean and n is the new count.
+template <typename real>
+void attack_ttest<real>::process(const trace &pt)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    const int g = classify(pt);
+    const real n = (real)++m_count[g], na = n - 1;
+    const real *p = power_samples(pt, &m_power[0]);
+    const size_t top = m_nmom;
+
+    // coefficients of each power of d for each moment, for this count
+    real cf[2 * MAX_TTEST_ORDER + 1][2 * MAX_TTEST_ORDER + 1];
+    real tail[2 * MAX_TTEST_ORDER + 1];
+    for (size_t q = 2; q <= top; ++q) {
+        real f = 1;
+        for (size_t k = 1; k + 2 <= q; ++k) {
+            f *= -1 / n;
+            cf[q][k] = m_binom[q][k] * f;
+        }
+        tail[q] = (na > 0) ? pow(na / n, (real)q) *
+                             (1 - pow(-1 / na, (real)(q - 1))) : 0;
+    }
+
+    real *mean = moments(g, 0);
+    for (size_t s = 0; s < m_nevents; ++s) {
+        const real d = p[s] - mean[s];
+
+        real dp[2 * MAX_TTEST_ORDER + 1];
+        dp[0] = 1;
+        for (size_t k = 1; k <= top; ++k) dp[k] = dp[k - 1] * d;
+
+        for (size_t q = top; q >= 2; --q) {
+            real m = moments(g, q - 1)[s] + tail[q] * dp[q];
+            for (size_t k = 1; k + 2 <= q; ++k)
+                m += cf[q][k] * dp[k] * moments(g, q - k - 1)[s];
+            moments(g, q - 1)[s] = m;
+        }
+        mean[s] += d / n;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Compute the t-statistic of the specified order for every sample. The
+// statistic of the first order compares the means of the groups, the second
+// their variances, and higher orders their standardized central moments.
+template <typename real>
+void attack_ttest<real>::compute_t(size_t order, real *t)
+{
+    const real n0 = m_count[0], n1 = m_count[1];
+    if (!m_count[0] || !m_count[1]) {
+        fill(t, t + m_nevents, 0);
+        return;
+    }
+
+    for (size_t s = 0; s < m_nevents; ++s) {
+        real m[2], v[2];
+        for (int g = 0; g < 2; ++g) {
+            const real n = m_count[g];
+            const real c2 = moments(g, 1)[s] / n;
+            if (order == 1) {
+                m[g] = moments(g, 0)[s];
+                v[g] = c2;
+            }
+            else if (order == 2) {
+                m[g] = c2;
+                v[g] = moments(g, 3)[s] / n - c2 * c2;
+            }
+            else {
+                const real cd = moments(g, order - 1)[s] / n;
+                const real c2d = moments(g, 2 * order - 1)[s] / n;
+                const real sd = pow(c2, (real)order);
+                m[g] = util::nonzero(sd) ? cd / sqrt(sd) : 0;
+                v[g] = util::nonzero(sd) ? (c2d - cd * cd) / sd : 0;
+            }
+        }
+
+        const real se = v[0] / n0 + v[1] / n1;
+        t[s] = (util::nonzero(se) && se > 0) ? (m[0] - m[1]) / sqrt(se) : 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_ttest<real>::record_interval(size_t n)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // the largest magnitude of the statistic tracks its growth with traces
+    vector<real> t(m_nevents);
+    for (size_t o = 0; o < m_order; ++o) {
+        compute_t(o + 1, &t[0]);
+
+        real &m = m_maxes[n * m_order + o];
+        for (size_t s = 0; s < m_nevents; ++s)
+            m = max(m, (real)fabs(t[s]));
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_ttest<real>::clone(const attack_instance *inst)
+{
+    attack_ttest *other = (attack_ttest *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    m_nevents = other->m_nevents;
+    m_nreports = other->m_nreports;
+    m_order = other->m_order;
+    m_nmom = other->m_nmom;
+    m_count[0] = other->m_count[0];
+    m_count[1] = other->m_count[1];
+    m_mom = other->m_mom;
+
+    if (!m_maxes.size())
+        m_maxes.resize(other->m_maxes.size(), 0);
+}
+
+// -----------------------------------------------------------------------------
+// Merge the groups of another instance, with the pairwise formulas
+//
+//   M_p = M_pA + M_pB
+//       + sum_k C(p, k) ((-nB / n)^k M_(p-k)A + (nA / n)^k M_(p-k)B) d^k
+//       + (nA nB d / n)^p (1 / nB^(p-1) - (-1 / nA)^(p-1))
+//
+// for k from 1 to p - 2, where d is the difference of the means.
+template <typename real>
+void attack_ttest<real>::coalesce(const attack_instance *inst)
+{
+    attack_ttest *other = (attack_ttest *)inst;
+    boost::lock_guard<boost::mutex> lock(other->m_mutex);
+
+    assert(m_nevents == other->m_nevents);
+    assert(m_nmom == other->m_nmom);
+
+    for (int g = 0; g < 2; ++g) {
+        const uint64_t cb = other->m_count[g];
+        if (!cb) continue;
+
+        if (!m_count[g]) {
+            for (size_t q = 0; q < m_nmom; ++q) {
+                copy(other->moments(g, q), other->moments(g, q) + m_nevents,
+                     moments(g, q));
+            }
+            m_count[g] = cb;
+            continue;
+        }
+
+        const real na = m_count[g], nb = cb, n = na + nb;
+        real fa[2 * MAX_TTEST_ORDER + 1], fb[2 * MAX_TTEST_ORDER + 1];
+        real tail[2 * MAX_TTEST_ORDER + 1];
+        fa[0] = fb[0] = 1;
+        for (size_t k = 1; k <= m_nmom; ++k) {
+            fa[k] = fa[k - 1] * (-nb / n);
+            fb[k] = fb[k - 1] * (na / n);
+        }
+        for (size_t q = 2; q <= m_nmom; ++q) {
+            tail[q] = pow(na * nb / n, (real)q) *
+                      (1 / pow(nb, (real)(q - 1)) -
+                       pow(-1 / na, (real)(q - 1)));
+        }
+
+        real *mean = moments(g, 0);
+        const real *ob = other->moments(g, 0);
+        for (size_t s = 0; s < m_nevents; ++s) {
+            const real d = ob[s] - mean[s];
+
+            real dp[2 * MAX_TTEST_ORDER + 1];
+            dp[0] = 1;
+            for (size_t k = 1; k <= m_nmom; ++k) dp[k] = dp[k - 1] * d;
+
+            for (size_t q = m_nmom; q >= 2; --q) {
+                real m = moments(g, q - 1)[s] + other->moments(g, q - 1)[s] +
+                         tail[q] * dp[q];
+                for (size_t k = 1; k + 2 <= q; ++k) {
+                    m += m_binom[q][k] * dp[k] *
+                         (fa[k] * moments(g, q - k - 1)[s] +
+                          fb[k] * other->moments(g, q - k - 1)[s]);
+                }
+                moments(g, q - 1)[s] = m;
+            }
+            mean[s] += d * nb / n;
+        }
+
+        m_count[g] += cb;
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_ttest<real>::reset(void)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    m_count[0] = m_count[1] = 0;
+    fill(m_mom.begin(), m_mom.end(), 0);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_ttest<real>::save(ostream &os)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    write_value<uint32_t>(os, sizeof(real));
+    write_value<uint64_t>(os, m_nevents);
+    write_value<uint64_t>(os, m_order);
+    write_value<uint64_t>(os, m_count[0]);
+    write_value<uint64_t>(os, m_count[1]);
+
+    write_vector(os, m_mom);
+    write_vector(os, m_maxes);
+    return !os.fail();
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_ttest<real>::load(istream &is)
+{
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    uint32_t size = 0;
+    uint64_t nevents = 0, order = 0;
+    if (!read_value(is, size) || size != sizeof(real) ||
+        !read_value(is, nevents) || !read_value(is, order) ||
+        !read_value(is, m_count[0]) || !read_value(is, m_count[1]) ||
+        order < 1 || order > MAX_TTEST_ORDER) {
+        return false;
+    }
+
+    if (!read_vector(is, m_mom) || !read_vector(is, m_maxes))
+        return false;
+
+    m_nevents = nevents;
+    m_order = order;
+    m_nmom = 2 * m_order;
+    m_nreports = m_maxes.size() / m_order;
+
+    return m_mom.size() == 2 * m_nmom * m_nevents;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_ttest<real>::select_target(size_t t, string &name, int &guesses)
+{
+    ostringstream oss;
+    oss << "ttest_order" << (t + 1);
+    name = oss.str();
+    guesses = 1;
+    m_selected = t;
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_ttest<real>::get_diffs(vector<double> &diffs)
+{
+    vector<real> t(m_nevents);
+    compute_t(m_selected + 1, &t[0]);
+    diffs.assign(t.begin(), t.end());
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void attack_ttest<real>::get_maxes(vector<double> &maxes)
+{
+    maxes.resize(m_nreports);
+    for (size_t n = 0; n < m_nreports; ++n)
+        maxes[n] = m_maxes[n * m_order + m_selected];
+}
+
+// -----------------------------------------------------------------------------
+// Summarize the largest statistic of each order against the usual threshold.
+template <typename real>
+void attack_ttest<real>::write_results(const string &path)
+{
+    printf("t-test of %zu and %zu trace(s):\n", (size_t)m_count[0],
+           (size_t)m_count[1]);
+
+    vector<real> t(m_nevents);
+    for (size_t o = 0; o < m_order; ++o) {
+        compute_t(o + 1, &t[0]);
+
+        size_t best = 0;
+        for (size_t s = 1; s < m_nevents; ++s)
+            if (fabs(t[s]) > fabs(t[best])) best = s;
+
+        printf("    order %zu: max |t| = %f at sample %zu (%s)\n", o + 1,
+               (double)fabs(t[best]), best,
+               fabs(t[best]) > TTEST_THRESHOLD ? "leakage" : "no leakage");
+    }
+}
+
+// -----------------------------------------------------------------------------
+template <typename real>
+bool attack_ttest<real>::cleanup()
+{
+    return true;
+}
+
+register_attack(ttest, attack_ttest<double>);
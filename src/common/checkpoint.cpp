@@ -0,0 +1,81 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstring>
+#include "checkpoint.h"
+#include "utility.h"
+
+using namespace std;
+using namespace util;
+
+// checkpoint file identification and format version
+#define CHECKPOINT_MAGIC   "dpackpt"
+#define CHECKPOINT_VERSION 2
+
+// -----------------------------------------------------------------------------
+checkpoint_header::checkpoint_header(void)
+: first(0), num_traces(0), interval(0), processed(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+void checkpoint_header::write(ostream &os) const
+{
+    os.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    write_value<uint32_t>(os, CHECKPOINT_VERSION);
+    write_string(os, attack_name);
+    write_string(os, crypto_name);
+    write_string(os, parameters);
+    write_value(os, first);
+    write_value(os, num_traces);
+    write_value(os, interval);
+    write_value(os, processed);
+    write_vector(os, events);
+}
+
+// -----------------------------------------------------------------------------
+bool checkpoint_header::read(istream &is)
+{
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint32_t version = 0;
+
+    if (is.read(magic, sizeof(magic)).fail() ||
+        memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) ||
+        !read_value(is, version) || version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "not a version %d checkpoint\n", CHECKPOINT_VERSION);
+        return false;
+    }
+
+    if (!read_string(is, attack_name) || !read_string(is, crypto_name) ||
+        !read_string(is, parameters) || !read_value(is, first) ||
+        !read_value(is, num_traces) || !read_value(is, interval) ||
+        !read_value(is, processed) || !read_vector(is, events)) {
+        fprintf(stderr, "truncated checkpoint header\n");
+        return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool checkpoint_header::same_attack(const checkpoint_header &other) const
+{
+    return attack_name == other.attack_name &&
+           crypto_name == other.crypto_name &&
+           parameters == other.parameters &&
+           events == other.events;
+}
@@ -0,0 +1,51 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CHECKPOINT__H
+#define CHECKPOINT__H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+//! Header of a checkpoint file, which is followed by the accumulated state of
+//! the attack instance. A checkpoint identifies the attack configuration and
+//! the range of traces it covers, so that an attack can be resumed, and the
+//! final checkpoints of several trace ranges (shards) can be merged.
+struct checkpoint_header {
+    std::string           attack_name;
+    std::string           crypto_name;
+    std::string           parameters;
+    uint64_t              first;      //!< index of the first trace in range
+    uint64_t              num_traces; //!< number of traces in the range
+    uint64_t              interval;   //!< report interval
+    uint64_t              processed;  //!< traces accumulated in the state
+    std::vector<uint32_t> events;     //!< time of each sample
+
+    checkpoint_header(void);
+
+    //! Write the header to a binary stream.
+    void write(std::ostream &os) const;
+
+    //! Read a header written by write, checking the format version.
+    bool read(std::istream &is);
+
+    //! Returns true if both headers describe the same attack and samples.
+    bool same_attack(const checkpoint_header &other) const;
+};
+
+#endif // CHECKPOINT__H
@@ -42,10 +42,23 @@ public:
         return istate ^ ostate;
     }
 
-    virtual int key_bits()      { return 128; }
-    virtual int block_bits()    { return 128; }
-    virtual int estimate_bits() { return 8; }
-    virtual int target_bits()   { return 8; }
+    virtual void compute_all(int n, int *values) {
+        assert(n < 16);
+        const int m = m_msg[n], ostate = m_msg[aes::shift[n]];
+        for (int k = 0; k < 256; ++k)
+            values[k] = aes::sbox_inv[m ^ k] ^ ostate;
+    }
+
+    virtual int partition(int n) {
+        assert(n < 16);
+        return (m_msg[aes::shift[n]] << 8) | m_msg[n];
+    }
+
+    virtual int partition_bits() { return 16; }
+    virtual int key_bits()       { return 128; }
+    virtual int block_bits()     { return 128; }
+    virtual int estimate_bits()  { return 8; }
+    virtual int target_bits()    { return 8; }
 
 protected:
     std::vector<uint8_t> m_msg;
@@ -40,10 +40,22 @@ public:
         return aes::sbox[m_msg[n] ^ k];
     }
 
-    virtual int key_bits()      { return 128; }
-    virtual int block_bits()    { return 128; }
-    virtual int estimate_bits() { return 8; }
-    virtual int target_bits()   { return 8; }
+    virtual void compute_all(int n, int *values) {
+        assert(n < 16);
+        const int m = m_msg[n];
+        for (int k = 0; k < 256; ++k) values[k] = aes::sbox[m ^ k];
+    }
+
+    virtual int partition(int n) {
+        assert(n < 16);
+        return m_msg[n];
+    }
+
+    virtual int partition_bits() { return 8; }
+    virtual int key_bits()       { return 128; }
+    virtual int block_bits()     { return 128; }
+    virtual int estimate_bits()  { return 8; }
+    virtual int target_bits()    { return 8; }
 
 protected:
     std::vector<uint8_t> m_msg;
@@ -19,11 +19,34 @@
 #include "des.h"
 #include "utility.h"
 
+// sbox output for each sbox and expanded input, after the ps permutation of
+// the input and bit reversal of the output, along with the bit reversed guesses
+static struct des_tables {
+    des_tables() {
+        for (int n = 0; n < 8; ++n) {
+            for (int x = 0; x < 64; ++x) {
+                const int ep = des::permute(des::ps, x, 6);
+                sbox[n][x] = util::revb(des::sbox[n][ep], 4);
+            }
+        }
+        for (int k = 0; k < 64; ++k) guess[k] = util::revb(k, 6);
+    }
+
+    int sbox[8][64];
+    int guess[64];
+} _des_tables;
+
 class crypto_des_hd_r0: public crypto_instance {
 public:
     virtual void set_message(const std::vector<uint8_t> &msg) {
         assert(msg.size() == 8);
         m_bits = util::convert_bytes(&msg[0]);
+
+        // the expansion and sbox xor state depend only on the message
+        uint64_t ip = des::permute(des::ip, m_bits, 64);
+        uint32_t l0 = ip & 0xFFFFFFFF, r0 = ip >> 32;
+        m_e = des::permute(des::e, r0, 48);
+        m_s = des::permute_inv(des::p, l0 ^ r0, 32);
     }
 
     virtual void set_key(const std::vector<uint8_t> &key) {
@@ -39,22 +62,37 @@ public:
     }
 
     virtual int compute(int n, int k) {
-        uint64_t ip = des::permute(des::ip, m_bits, 64);
-        uint32_t l0 = ip & 0xFFFFFFFF, r0 = ip >> 32;
-        uint32_t e0 = ((des::permute(des::e, r0, 48) >> (n * 6)) & 0x3F);
-        uint32_t ep = des::permute(des::ps, e0 ^ util::revb(k, 6), 6);
-        uint32_t s0 = (des::permute_inv(des::p, l0 ^ r0, 32) >> (n * 4)) & 0x0F;
-        uint32_t sb = util::revb(des::sbox[n][ep], 4);
-        return sb ^ s0;
+        assert(n < 8 && k < 64);
+        uint32_t e0 = (m_e >> (n * 6)) & 0x3F;
+        uint32_t s0 = (m_s >> (n * 4)) & 0x0F;
+        return _des_tables.sbox[n][e0 ^ _des_tables.guess[k]] ^ s0;
+    }
+
+    virtual void compute_all(int n, int *values) {
+        assert(n < 8);
+        const int *sb = _des_tables.sbox[n];
+        uint32_t e0 = (m_e >> (n * 6)) & 0x3F;
+        uint32_t s0 = (m_s >> (n * 4)) & 0x0F;
+        for (int k = 0; k < 64; ++k)
+            values[k] = sb[e0 ^ _des_tables.guess[k]] ^ s0;
+    }
+
+    virtual int partition(int n) {
+        uint32_t e0 = (m_e >> (n * 6)) & 0x3F;
+        uint32_t s0 = (m_s >> (n * 4)) & 0x0F;
+        return (e0 << 4) | s0;
     }
 
-    virtual int key_bits()      { return 48; }
-    virtual int block_bits()    { return 64; }
-    virtual int estimate_bits() { return 6; }
-    virtual int target_bits()   { return 4; }
+    virtual int partition_bits() { return 10; }
+    virtual int key_bits()       { return 48; }
+    virtual int block_bits()     { return 64; }
+    virtual int estimate_bits()  { return 6; }
+    virtual int target_bits()    { return 4; }
 
 protected:
     uint64_t m_bits;
+    uint64_t m_e; // expansion of the initial right half
+    uint32_t m_s; // inverse p permutation of the initial left ^ right halves
     std::vector<int> m_key;
 };
 
@@ -43,10 +43,24 @@ public:
         return aes::sbox[q] ^ aes::sbox[p];
     }
 
-    virtual int key_bits()      { return 512; }
-    virtual int block_bits()    { return 512; }
-    virtual int estimate_bits() { return 8; }
-    virtual int target_bits()   { return 8; }
+    virtual void compute_all(int n, int *values) {
+        assert(n < 64);
+        const int p = ( n & 7) ? m_msg[n] : m_msg[n] ^ (n << 1);
+        const int q = ((~n & 7) ? m_msg[n] : m_msg[n] ^ ((n & ~7) << 1)) ^ 0xFF;
+        const int sq = aes::sbox[q];
+        for (int k = 0; k < 256; ++k) values[k] = sq ^ aes::sbox[p ^ k];
+    }
+
+    virtual int partition(int n) {
+        assert(n < 64);
+        return m_msg[n];
+    }
+
+    virtual int partition_bits() { return 8; }
+    virtual int key_bits()       { return 512; }
+    virtual int block_bits()     { return 512; }
+    virtual int estimate_bits()  { return 8; }
+    virtual int target_bits()    { return 8; }
 
 protected:
     std::vector<uint8_t> m_msg;
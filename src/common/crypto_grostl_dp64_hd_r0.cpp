@@ -44,10 +44,26 @@ public:
         return aes::sbox[q] ^ aes::sbox[p];
     }
 
-    virtual int key_bits()      { return 512; }
-    virtual int block_bits()    { return 512; }
-    virtual int estimate_bits() { return 8; }
-    virtual int target_bits()   { return 8; }
+    virtual void compute_all(int n, int *values) {
+        assert(n < 64);
+        const int m = grostl::shift_q[grostl::shift_inv_p[n]];
+        const int p = ( n & 7) ? m_msg[n] : m_msg[n] ^ (n << 1);
+        const int q = ((~m & 7) ? m_msg[m] : m_msg[m] ^ ((m & ~7) << 1)) ^ 0xFF;
+        const int sq = aes::sbox[q];
+        for (int k = 0; k < 256; ++k) values[k] = sq ^ aes::sbox[p ^ k];
+    }
+
+    virtual int partition(int n) {
+        assert(n < 64);
+        const int m = grostl::shift_q[grostl::shift_inv_p[n]];
+        return (m_msg[m] << 8) | m_msg[n];
+    }
+
+    virtual int partition_bits() { return 16; }
+    virtual int key_bits()       { return 512; }
+    virtual int block_bits()     { return 512; }
+    virtual int estimate_bits()  { return 8; }
+    virtual int target_bits()    { return 8; }
 
 protected:
     std::vector<uint8_t> m_msg;
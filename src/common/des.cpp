@@ -147,6 +147,77 @@ uint64_t encrypt(uint64_t pt, const uint64_t *sk)
     return permute_inv(ip, r_n | (uint64_t)l_n << 32, 64);
 }
 
+// -----------------------------------------------------------------------------
+// Lookup tables for encrypt_batch. A bit permutation of a value is the union
+// of the permutations of each of its bytes, so each permutation has a table
+// for every input byte. sp[i][x] is the output of F for the value x of the six
+// bits selecting sbox i, with the sbox and p permutation combined.
+static struct batch_tables {
+    batch_tables() {
+        for (int b = 0; b < 8; ++b) {
+            for (uint64_t x = 0; x < 256; ++x) {
+                const uint64_t v = x << (b * 8);
+                ip_fwd[b][x] = permute(ip, v, 64);
+                ip_inv[b][x] = permute_inv(ip, v, 64);
+                pc1_fwd[b][x] = permute(pc1, v, 56);
+                if (b < 7) pc2_fwd[b][x] = permute(pc2, v, 48);
+                if (b < 4) e_fwd[b][x] = permute(e, v, 48);
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            for (int x = 0; x < 64; ++x) {
+                const int sel = permute(ps, x, 6);
+                const uint64_t y = (uint64_t)util::revb(sbox[i][sel], 4);
+                sp[i][x] = permute(p, y << (i * 4), 32);
+            }
+        }
+    }
+
+    uint64_t ip_fwd[8][256];
+    uint64_t ip_inv[8][256];
+    uint64_t pc1_fwd[8][256];
+    uint64_t pc2_fwd[7][256];   // only 56 input bits
+    uint64_t e_fwd[4][256];     // only 32 input bits
+    uint32_t sp[8][64];
+} _batch_tables;
+
+template <size_t bytes>
+static inline uint64_t lookup(const uint64_t (*tab)[256], uint64_t in)
+{
+    uint64_t x = 0;
+    for (size_t b = 0; b < bytes; ++b) x |= tab[b][(in >> (b * 8)) & 0xFF];
+    return x;
+}
+
+// -----------------------------------------------------------------------------
+void encrypt_batch(uint64_t pt, const uint64_t *keys, uint64_t *ct, size_t n)
+{
+    const batch_tables &t = _batch_tables;
+    const uint64_t ip_out = lookup<8>(t.ip_fwd, pt);
+
+    for (size_t k = 0; k < n; ++k) {
+        const uint64_t x = lookup<8>(t.pc1_fwd, keys[k]);
+        uint32_t cl = x & 0xFFFFFFF, cr = x >> 28;
+        uint32_t l_n = ip_out & 0xFFFFFFFF, r_n = ip_out >> 32;
+
+        for (int i = 0; i < 16; ++i) {
+            cl = ((cl >> rot[i]) | (cl << (28 - rot[i]))) & 0xFFFFFFF;
+            cr = ((cr >> rot[i]) | (cr << (28 - rot[i]))) & 0xFFFFFFF;
+            const uint64_t sk = lookup<7>(t.pc2_fwd, cl | (uint64_t)cr << 28);
+
+            const uint64_t v = lookup<4>(t.e_fwd, r_n) ^ sk;
+            uint32_t fv = 0;
+            for (int j = 0; j < 8; ++j) fv ^= t.sp[j][(v >> (j * 6)) & 0x3F];
+
+            const uint32_t f_n = l_n ^ fv;
+            l_n = r_n;
+            r_n = f_n;
+        }
+
+        ct[k] = lookup<8>(t.ip_inv, r_n | (uint64_t)l_n << 32);
+    }
+}
+
 // -----------------------------------------------------------------------------
 uint64_t decrypt(uint64_t ct, const uint64_t *sk)
 {
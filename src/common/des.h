@@ -56,6 +56,11 @@ void key_schedule(uint64_t key, uint64_t *sk);
 /// Perform a DES encryption operation on the specified plaintext.
 uint64_t encrypt(uint64_t pt, const uint64_t *sk);
 
+/// Encrypt one plaintext under each of n encryption keys, scheduling each key
+/// on the fly, for testing many candidate keys. The bit permutations are
+/// replaced by a lookup per byte of their inputs.
+void encrypt_batch(uint64_t pt, const uint64_t *keys, uint64_t *ct, size_t n);
+
 /// Perform a DES decryption operation on the specified ciphertext.
 uint64_t decrypt(uint64_t pt, const uint64_t *sk);
 
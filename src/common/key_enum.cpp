@@ -0,0 +1,354 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include "key_enum.h"
+#include "utility.h"
+
+using namespace std;
+
+namespace key_enum {
+
+// number of candidates given to the verifier at once
+#define BATCH_SIZE 1024
+
+// minimum number of batches for each thread in a band of scores
+#define BAND_BATCHES 64
+
+// fraction of the score range of the first band
+#define FIRST_BAND (1.0 / (1 << 20))
+
+// -----------------------------------------------------------------------------
+ranked_list::ranked_list(const vector<double> &scores) :
+    m_a(NULL), m_b(NULL), m_parts(1)
+{
+    for (size_t k = 0; k < scores.size(); ++k) {
+        const entry e = { scores[k], k, 0 };
+        m_entries.push_back(e);
+    }
+
+    // decreasing order of score, and increasing order of guess among ties
+    reverse(m_entries.begin(), m_entries.end());
+    stable_sort(m_entries.begin(), m_entries.end());
+    reverse(m_entries.begin(), m_entries.end());
+}
+
+// -----------------------------------------------------------------------------
+ranked_list::ranked_list(ranked_list *a, ranked_list *b) :
+    m_a(a), m_b(b), m_parts(a->parts() + b->parts())
+{
+    if (m_a->reach(0) && m_b->reach(0)) {
+        const entry e = { m_a->score(0) + m_b->score(0), 0, 0 };
+        m_frontier.push_back(e);
+    }
+}
+
+// -----------------------------------------------------------------------------
+ranked_list::~ranked_list(void)
+{
+    delete m_a;
+    delete m_b;
+}
+
+// -----------------------------------------------------------------------------
+// Move the best candidate entry into the list. Entry (a, b) is followed by
+// (a + 1, b), and (0, b) also by (0, b + 1), so that every entry is a
+// candidate exactly once, and only after every entry that scores higher.
+void ranked_list::pop(void)
+{
+    pop_heap(m_frontier.begin(), m_frontier.end());
+    const entry e = m_frontier.back();
+    m_frontier.pop_back();
+    m_entries.push_back(e);
+
+    if (m_a->reach(e.a + 1)) {
+        const entry n = { m_a->score(e.a + 1) + m_b->score(e.b), e.a + 1, e.b };
+        m_frontier.push_back(n);
+        push_heap(m_frontier.begin(), m_frontier.end());
+    }
+    if (!e.a && m_b->reach(e.b + 1)) {
+        const entry n = { m_a->score(0) + m_b->score(e.b + 1), 0, e.b + 1 };
+        m_frontier.push_back(n);
+        push_heap(m_frontier.begin(), m_frontier.end());
+    }
+}
+
+// -----------------------------------------------------------------------------
+void ranked_list::extend(double score)
+{
+    while (!m_frontier.empty() && m_frontier.front().score >= score)
+        pop();
+}
+
+// -----------------------------------------------------------------------------
+bool ranked_list::reach(size_t n)
+{
+    while (m_entries.size() <= n && !m_frontier.empty())
+        pop();
+    return m_entries.size() > n;
+}
+
+// -----------------------------------------------------------------------------
+void ranked_list::guesses(size_t n, int *guesses) const
+{
+    const entry &e = m_entries[n];
+    if (!m_a) {
+        guesses[0] = (int)e.a;
+        return;
+    }
+    m_a->guesses(e.a, guesses);
+    m_b->guesses(e.b, guesses + m_a->parts());
+}
+
+// -----------------------------------------------------------------------------
+// Build the balanced tree of lists of parts [first, last).
+static ranked_list *build(const vector<vector<double> > &scores, size_t first,
+                          size_t last)
+{
+    if (last - first == 1)
+        return new ranked_list(scores[first]);
+
+    const size_t mid = (first + last) / 2;
+    return new ranked_list(build(scores, first, mid),
+                           build(scores, mid, last));
+}
+
+// -----------------------------------------------------------------------------
+// The candidates of one band of scores: entries first[j] onwards of list a
+// paired with entry j of list b, numbered from offset[j] to offset[j + 1].
+struct band {
+    const ranked_list      *a;
+    const ranked_list      *b;
+    const vector<size_t>   *first;
+    const vector<uint64_t> *offset;
+    uint64_t                count;
+    verifier               *v;
+
+    boost::mutex            lock;
+    uint64_t                next;
+    uint64_t                tested;
+    bool                    found;
+    size_t                  found_a;
+    size_t                  found_b;
+};
+
+// -----------------------------------------------------------------------------
+// Test batches of the candidates of a band until none remain or the key is
+// found.
+static void search_band(band *bd)
+{
+    const size_t pa = bd->a->parts(), parts = pa + bd->b->parts();
+    const vector<uint64_t> &offset = *bd->offset;
+    vector<int> guesses(BATCH_SIZE * parts), gb(parts - pa);
+    vector<size_t> ia(BATCH_SIZE), ib(BATCH_SIZE);
+    size_t gb_j = (size_t)-1;
+
+    for (;;) {
+        uint64_t first, last;
+        {
+            boost::lock_guard<boost::mutex> lock(bd->lock);
+            if (bd->found || bd->next >= bd->count)
+                break;
+            first = bd->next;
+            last = min(first + BATCH_SIZE, bd->count);
+            bd->next = last;
+        }
+
+        // walk the candidates from the column of list b holding the first
+        size_t j = upper_bound(offset.begin(), offset.end(), first) -
+                   offset.begin() - 1;
+        size_t n = 0;
+        for (uint64_t c = first; c < last; ++c, ++n) {
+            while (c >= offset[j + 1]) ++j;
+            if (j != gb_j) {
+                bd->b->guesses(j, &gb[0]);
+                gb_j = j;
+            }
+
+            int *g = &guesses[n * parts];
+            ia[n] = (*bd->first)[j] + (size_t)(c - offset[j]);
+            ib[n] = j;
+            bd->a->guesses(ia[n], g);
+            copy(gb.begin(), gb.end(), g + pa);
+        }
+
+        const size_t hit = bd->v->verify(&guesses[0], n);
+
+        boost::lock_guard<boost::mutex> lock(bd->lock);
+        bd->tested += n;
+        if (hit < n && !bd->found) {
+            bd->found = true;
+            bd->found_a = ia[hit];
+            bd->found_b = ib[hit];
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool search(const vector<vector<double> > &scores, verifier &v,
+            size_t threads, uint64_t limit, result &res)
+{
+    res.found = false;
+    res.key.clear();
+    res.rank = res.tested = 0;
+    res.seconds = 0;
+
+    const size_t parts = scores.size();
+    if (parts < 2) {
+        fprintf(stderr, "key enumeration needs at least two key parts\n");
+        return false;
+    }
+
+    double min_total = 0;
+    foreach (const vector<double> &s, scores) {
+        if (s.empty()) {
+            fprintf(stderr, "key part without guesses\n");
+            return false;
+        }
+        min_total += *min_element(s.begin(), s.end());
+    }
+    threads = max(threads, (size_t)1);
+
+    boost::scoped_ptr<ranked_list> a(build(scores, 0, parts / 2));
+    boost::scoped_ptr<ranked_list> b(build(scores, parts / 2, parts));
+    a->reach(0);
+    b->reach(0);
+    const double a0 = a->score(0), b0 = b->score(0), top = a0 + b0;
+
+    // a column j of list b beyond the band scores below the band even with
+    // rounding, which the slack in its extension absorbs
+    const double slack = 1e-9 * (fabs(a0) + fabs(b0) + fabs(min_total));
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_REALTIME, &t0);
+
+    vector<size_t> first, last;
+    vector<uint64_t> offset;
+    double hi = HUGE_VAL, width = (top - min_total) * FIRST_BAND;
+    double prev_density = 0, prev_width = 0;
+    uint64_t before = 0;
+
+    while (before < limit) {
+        double lo = (hi == HUGE_VAL ? top : hi) - width;
+        const bool last_band = lo <= min_total;
+        if (last_band) lo = -HUGE_VAL;
+
+        a->extend(lo - b0 - slack);
+        b->extend(lo - a0 - slack);
+
+        // a candidate is in the band if a[i] >= lo - b[j], but not hi - b[j],
+        // so every candidate is in exactly one band; the entries of a column
+        // of b new to this band start where the band starts
+        const size_t nb = b->size(), na = a->size(), old_nb = last.size();
+        first.resize(nb);
+        last.resize(nb);
+        offset.resize(nb + 1);
+        for (size_t j = old_nb; j < nb; ++j) {
+            size_t n = 0;
+            if (hi != HUGE_VAL) {
+                const double t = hi - b->score(j);
+                for (size_t step = na; step; step >>= 1) {
+                    while (n + step <= na && a->score(n + step - 1) >= t)
+                        n += step;
+                }
+            }
+            last[j] = n;
+        }
+        for (size_t j = 0; j < nb; ++j) {
+            const double t = lo - b->score(j);
+            size_t n = last[j];
+            while (n < na && a->score(n) >= t) ++n;
+            first[j] = last[j];
+            last[j] = n;
+            offset[j + 1] = offset[j] + (last[j] - first[j]);
+        }
+
+        band bd;
+        bd.a = a.get();
+        bd.b = b.get();
+        bd.first = &first;
+        bd.offset = &offset;
+        bd.count = min(offset[nb], limit - before);
+        bd.v = &v;
+        bd.next = bd.tested = 0;
+        bd.found = false;
+
+        const size_t nthreads =
+            min(threads, (size_t)((bd.count + BATCH_SIZE - 1) / BATCH_SIZE));
+        boost::thread_group group;
+        for (size_t t = 1; t < nthreads; ++t)
+            group.create_thread(boost::bind(search_band, &bd));
+        search_band(&bd);
+        group.join_all();
+
+        clock_gettime(CLOCK_REALTIME, &t1);
+        res.seconds = time_delta_ns(&t0, &t1) / 1e9;
+        res.tested = before + bd.tested;
+
+        if (bd.found) {
+            // rank among the candidates of the band by score
+            const double s = a->score(bd.found_a) + b->score(bd.found_b);
+            res.rank = before + 1;
+            for (size_t j = 0; j < nb; ++j) {
+                for (size_t i = first[j]; i < last[j]; ++i)
+                    res.rank += (a->score(i) + b->score(j) > s);
+            }
+
+            res.found = true;
+            res.key.resize(parts);
+            a->guesses(bd.found_a, &res.key[0]);
+            b->guesses(bd.found_b, &res.key[a->parts()]);
+            break;
+        }
+
+        before += bd.count;
+        v.progress(before, res.seconds);
+        if (last_band)
+            break;
+
+        // choose the width of the next band to hold a batch of work for every
+        // thread, and enough candidates to amortize the walk of the columns,
+        // extrapolating the growth of the density of candidates per unit of
+        // score over the last two bands
+        const uint64_t target = max((uint64_t)threads * BAND_BATCHES *
+                                    BATCH_SIZE, (uint64_t)nb / 8);
+        const double density = offset[nb] / width, last_width = width;
+        if (!offset[nb]) width *= 2;
+        else {
+            double w = target / density;
+            if (prev_density > 0 && density > prev_density) {
+                const double growth = log(density / prev_density) /
+                                      ((width + prev_width) / 2);
+                w = log1p(target * growth /
+                          (density * exp(growth * width / 2))) / growth;
+            }
+            width = min(w, 4 * width);
+        }
+        prev_density = density;
+        prev_width = last_width;
+        hi = lo;
+    }
+
+    return true;
+}
+
+}; // namespace key_enum
@@ -0,0 +1,124 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef KEY_ENUM__H
+#define KEY_ENUM__H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+//! Enumeration of full keys in decreasing order of score, from independent
+//! attacks on their parts, to test candidates against a known plaintext and
+//! ciphertext.
+//!
+//! As in key_rank, each part has a score for every guess and scores add across
+//! parts. The parts are split into two halves, and the combined guesses of
+//! each half are listed in decreasing order of score, merging smaller lists in
+//! a balanced tree. Every candidate is a pair of entries, one from each half.
+//! The search tests the candidates one band of total scores at a time, and in
+//! any order within a band, so that every thread tests candidates at once; the
+//! order is exact up to the width of a band, which adapts to hold a batch of
+//! work for every thread.
+namespace key_enum {
+
+//! The combined guesses of a range of key parts, in decreasing order of total
+//! score. The list of two lists is extended lazily, as deeper entries are
+//! requested, and entries are never removed, so an index stays valid.
+class ranked_list {
+public:
+    //! Create the list of the guesses of a single part, given their scores.
+    explicit ranked_list(const std::vector<double> &scores);
+
+    //! Create the list of every combination of an entry of a with an entry
+    //! of b, taking ownership of both.
+    ranked_list(ranked_list *a, ranked_list *b);
+
+    ~ranked_list(void);
+
+    //! Extend the list with every entry scoring at least 'score'.
+    void extend(double score);
+
+    //! Extend the list to hold entry n, returning false if it has no more.
+    bool reach(size_t n);
+
+    //! Return the number of entries listed so far.
+    size_t size(void) const { return m_entries.size(); }
+
+    //! Return the total score of entry n.
+    double score(size_t n) const { return m_entries[n].score; }
+
+    //! Return the number of key parts combined in each entry.
+    size_t parts(void) const { return m_parts; }
+
+    //! Write the guess of each part of entry n to guesses[0 .. parts()).
+    void guesses(size_t n, int *guesses) const;
+
+protected:
+    struct entry {
+        double   score;
+        uint64_t a;     // guess of a single part, or the entry of list a
+        uint64_t b;     // entry of list b
+
+        bool operator<(const entry &e) const { return score < e.score; }
+    };
+
+    void pop(void);
+
+    std::vector<entry> m_entries;
+    std::vector<entry> m_frontier;  // heap of the next candidate entries
+    ranked_list       *m_a;
+    ranked_list       *m_b;
+    size_t             m_parts;
+
+private:
+    ranked_list(const ranked_list &);
+    ranked_list &operator=(const ranked_list &);
+};
+
+//! Tests the candidate keys of a search.
+class verifier {
+public:
+    //! Test 'count' candidate keys, where guesses[i * parts + p] is the guess
+    //! of part p of candidate i. Return the index of the correct candidate, or
+    //! count if there is none. Called concurrently from every search thread.
+    virtual size_t verify(const int *guesses, size_t count) = 0;
+
+    //! Report progress after each band of the search (from a single thread).
+    virtual void progress(uint64_t tested, double seconds) {}
+
+    //! Explicit virtual destructor, as verifier will be subclassed
+    virtual ~verifier() {}
+};
+
+//! The outcome of a search.
+struct result {
+    bool             found;
+    std::vector<int> key;       //! guess of each part of the correct key
+    uint64_t         rank;      //! position of the key in order of score
+    uint64_t         tested;    //! number of candidates tested
+    double           seconds;   //! time spent searching
+};
+
+//! Search for the key among the candidates of the scores[i][k] of each guess
+//! k of part i, testing at most 'limit' candidates across 'threads' threads.
+//! Returns false if the arguments are invalid.
+bool search(const std::vector<std::vector<double> > &scores, verifier &v,
+            size_t threads, uint64_t limit, result &res);
+
+}; // namespace key_enum
+
+#endif // KEY_ENUM__H
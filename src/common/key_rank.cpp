@@ -0,0 +1,303 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <algorithm>
+#include "key_rank.h"
+#include "utility.h"
+
+using namespace std;
+
+namespace key_rank {
+
+typedef complex<double> cplx;
+
+// limit of the tilt per bin, beyond which the key is at the very edge of
+// the distribution and a steeper tilt changes nothing
+#define MAX_TILT 8.0
+
+// relative magnitude below which a convolved bin is rounding noise
+#define NOISE_FLOOR 1e-13
+
+// -----------------------------------------------------------------------------
+// In-place radix-2 fast Fourier transform of a power of two sized array; the
+// inverse is not scaled by 1 / n.
+static void fft(vector<cplx> &a, bool inverse)
+{
+    const size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) swap(a[i], a[j]);
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+        const cplx step(cos(angle), sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            cplx w(1);
+            for (size_t j = 0; j < len / 2; ++j) {
+                const cplx u = a[i + j], v = a[i + j + len / 2] * w;
+                a[i + j] = u + v;
+                a[i + j + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Return log(sum of exp(x[i])) over the values of x greater than -HUGE_VAL.
+static double log_sum(const vector<double> &x)
+{
+    double top = -HUGE_VAL, sum = 0;
+    for (size_t i = 0; i < x.size(); ++i) top = max(top, x[i]);
+    if (top == -HUGE_VAL) return top;
+
+    for (size_t i = 0; i < x.size(); ++i) sum += exp(x[i] - top);
+    return top + log(sum);
+}
+
+// -----------------------------------------------------------------------------
+// The histogram of one part under the tilt theta, as log weights log h(b) +
+// theta b, and the mean bin of the tilted distribution.
+static double tilted_mean(const vector<double> &lh, double theta,
+                          vector<double> &lw)
+{
+    lw.resize(lh.size());
+    for (size_t b = 0; b < lh.size(); ++b) lw[b] = lh[b] + theta * b;
+
+    const double lz = log_sum(lw);
+    double mean = 0;
+    for (size_t b = 0; b < lh.size(); ++b) mean += b * exp(lw[b] - lz);
+    return mean;
+}
+
+// -----------------------------------------------------------------------------
+// The mean total bin under the tilt theta, the sum of the mean of each part.
+static double total_mean(const vector<vector<double> > &lh, double theta,
+                         vector<double> &lw)
+{
+    double mean = 0;
+    for (size_t i = 0; i < lh.size(); ++i)
+        mean += tilted_mean(lh[i], theta, lw);
+    return mean;
+}
+
+// -----------------------------------------------------------------------------
+// Return log2(1 + exp(lc)), the log2 rank of a key with exp(lc) keys ahead.
+static double log2_rank(double lc)
+{
+    if (lc == -HUGE_VAL) return 0;
+    return (max(lc, 0.0) + log1p(exp(-fabs(lc)))) / M_LN2;
+}
+
+// -----------------------------------------------------------------------------
+bool estimate(const vector<vector<double> > &scores, const vector<int> &key,
+              size_t bins, bounds &result)
+{
+    const size_t parts = scores.size();
+    if (!parts || key.size() != parts || bins < 2)
+        return false;
+
+    // a common bin width, so that the bins of every part add up
+    vector<double> low(parts);
+    double width = 0;
+    for (size_t i = 0; i < parts; ++i) {
+        if (scores[i].empty() || key[i] < 0 ||
+            (size_t)key[i] >= scores[i].size()) {
+            return false;
+        }
+        low[i] = *min_element(scores[i].begin(), scores[i].end());
+        const double high = *max_element(scores[i].begin(), scores[i].end());
+        width = max(width, (high - low[i]) / (bins - 1));
+    }
+    if (!(width > 0)) width = 1;
+
+    // the log histogram of each part, and the total bin of the key
+    vector<vector<double> > lh(parts);
+    size_t total = 0, key_bin = 0;
+    for (size_t i = 0; i < parts; ++i) {
+        vector<double> h(bins, 0);
+        size_t top = 0;
+        for (size_t k = 0; k < scores[i].size(); ++k) {
+            const size_t b = min(bins - 1, (size_t)floor(
+                                 (scores[i][k] - low[i]) / width));
+            h[b] += 1;
+            top = max(top, b);
+            if ((int)k == key[i]) key_bin += b;
+        }
+
+        lh[i].resize(top + 1);
+        for (size_t b = 0; b <= top; ++b)
+            lh[i][b] = h[b] ? log(h[b]) : -HUGE_VAL;
+        total += top;
+    }
+
+    // choose the tilt whose distribution of the total is centred on the key.
+    // Only a key above the bulk of the distribution needs one; the keys ahead
+    // of any other are the bulk itself, which an untilted transform keeps.
+    vector<double> lw;
+    double theta = 0;
+    if (total_mean(lh, 0, lw) < key_bin) {
+        double lo = 0, hi = MAX_TILT;
+        for (int it = 0; it < 40; ++it) {
+            theta = (lo + hi) / 2;
+            if (total_mean(lh, theta, lw) < key_bin) lo = theta;
+            else hi = theta;
+        }
+        theta = (lo + hi) / 2;
+    }
+
+    // convolve the normalized tilted histograms in the frequency domain
+    size_t n = 1;
+    while (n < total + 1) n <<= 1;
+
+    vector<cplx> product(n, cplx(1)), a(n);
+    double scale = 0;
+    for (size_t i = 0; i < parts; ++i) {
+        tilted_mean(lh[i], theta, lw);
+        const double lz = log_sum(lw);
+        scale += lz;
+
+        fill(a.begin(), a.end(), cplx(0));
+        for (size_t b = 0; b < lw.size(); ++b) a[b] = exp(lw[b] - lz);
+        fft(a, false);
+        for (size_t j = 0; j < n; ++j) product[j] *= a[j];
+    }
+    fft(product, true);
+
+    // undo the tilt: log H(B) = log T(B) + scale - theta B
+    double peak = 0;
+    for (size_t b = 0; b <= total; ++b)
+        peak = max(peak, product[b].real() / n);
+
+    vector<double> lcount(total + 1);
+    for (size_t b = 0; b <= total; ++b) {
+        const double t = product[b].real() / n;
+        lcount[b] = (t > NOISE_FLOOR * peak) ? log(t) + scale - theta * b
+                                              : -HUGE_VAL;
+    }
+
+    // a key's total bin is below its exact total by less than one bin per
+    // part, so keys more than 'parts' bins above the key certainly score
+    // higher, and those 'parts' or more bins below certainly score lower
+    vector<double> ahead;
+    for (size_t b = key_bin + 1; b <= total; ++b) ahead.push_back(lcount[b]);
+
+    vector<double> sure(ahead.begin() + min(ahead.size(), parts - 1),
+                        ahead.end());
+
+    vector<double> maybe(ahead);
+    for (size_t b = (key_bin >= parts - 1) ? key_bin - parts + 1 : 0;
+         b <= key_bin; ++b) {
+        maybe.push_back(lcount[b]);
+    }
+
+    // half the other keys in the key's own bin are expected to be ahead
+    const double lkey = lcount[key_bin];
+    if (lkey > 0) ahead.push_back(lkey + log1p(-exp(-lkey)) - M_LN2);
+
+    const double lmaybe = log_sum(maybe);
+    result.low = log2_rank(log_sum(sure));
+    result.estimate = log2_rank(log_sum(ahead));
+    result.high = (lmaybe > 0) ? log2_rank(lmaybe + log1p(-exp(-lmaybe)))
+                               : 0;
+
+    // keep the bounds ordered despite rounding in the transform
+    result.high = max(result.high, result.low);
+    result.estimate = min(max(result.estimate, result.low), result.high);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+double correlation_score(double r, double n)
+{
+    const double r2 = min(r * r, 1 - 1e-12);
+    return -0.5 * n * log1p(-r2);
+}
+
+// -----------------------------------------------------------------------------
+// Read the rows of a report written by the attack, each a trace count or
+// sample time followed by a value for every key guess.
+static bool read_report(const string &path, vector<vector<double> > &rows)
+{
+    ifstream in(path.c_str());
+    if (!in.is_open())
+        return false;
+
+    rows.clear();
+    string line;
+    while (getline(in, line)) {
+        if (util::trim(line).empty()) continue;
+
+        vector<double> row;
+        foreach (const string &field, util::split(line, ","))
+            row.push_back(atof(field.c_str()));
+        if (row.size() < 2 || (!rows.empty() && row.size() != rows[0].size()))
+            return false;
+        rows.push_back(row);
+    }
+
+    return !rows.empty();
+}
+
+// -----------------------------------------------------------------------------
+bool read_scores(const string &dir, bool correlation, vector<size_t> &traces,
+                 vector<vector<double> > &scores)
+{
+    vector<vector<double> > rows;
+    traces.clear();
+    scores.clear();
+
+    if (read_report(util::concat_name(dir, "interval_maxes.csv"), rows)) {
+        foreach (const vector<double> &row, rows) {
+            traces.push_back((size_t)row[0]);
+            scores.push_back(vector<double>(row.begin() + 1, row.end()));
+        }
+    }
+    else if (read_report(util::concat_name(dir, "differentials.csv"), rows)) {
+        vector<double> peak(rows[0].size() - 1, 0);
+        foreach (const vector<double> &row, rows) {
+            for (size_t k = 1; k < row.size(); ++k)
+                peak[k - 1] = max(peak[k - 1], fabs(row[k]));
+        }
+        traces.push_back(0);
+        scores.push_back(peak);
+    }
+    else {
+        fprintf(stderr, "no attack reports in '%s'\n", dir.c_str());
+        return false;
+    }
+
+    // the scores must add across parts; correlations are converted to log
+    // likelihoods, where an unknown trace count scales every part equally
+    if (correlation) {
+        for (size_t i = 0; i < scores.size(); ++i) {
+            const double n = traces[i] ? (double)traces[i] : 1.0;
+            foreach (double &s, scores[i])
+                s = correlation_score(s, n);
+        }
+    }
+    return true;
+}
+
+}; // namespace key_rank
@@ -0,0 +1,65 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef KEY_RANK__H
+#define KEY_RANK__H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//! Estimation of the rank of a full key from independent attacks on its parts.
+//!
+//! Each part (such as a key byte) has a score for every guess, where scores
+//! add across parts, such as log likelihoods. The scores of each part are
+//! binned into a histogram of a common bin width, and the histograms are
+//! convolved into the distribution of the total score of every full key, so
+//! that the keys scoring above the known key can be counted without
+//! enumerating them. The convolution is a product of fast Fourier transforms,
+//! taken under an exponential tilt that centres the distribution on the known
+//! key, so that the bins that decide its rank keep full precision.
+namespace key_rank {
+
+//! Bounds on the rank of a key, as log2 of the rank; the best key has rank 1.
+struct bounds {
+    double low;
+    double estimate;
+    double high;
+};
+
+//! Estimate the rank of the key whose part i has guess key[i], given the
+//! scores[i][k] of each guess k of part i, with higher scores more likely.
+//! Each part is binned into at most 'bins' bins. Returns false if the
+//! arguments are inconsistent.
+bool estimate(const std::vector<std::vector<double> > &scores,
+              const std::vector<int> &key, size_t bins, bounds &result);
+
+//! Return the log likelihood score of a correlation r over n traces, which
+//! under a linear model with Gaussian noise is -(n / 2) log(1 - r^2).
+double correlation_score(double r, double n);
+
+//! Read the score of every guess of one attacked key part from the reports of
+//! the attack in 'dir', at each report interval of traces[i]. The interval
+//! maxes are preferred; without them, the peak of each guess's differential is
+//! its single score, over an unknown number of traces (0). Correlations are
+//! converted to log likelihoods if 'correlation' is set.
+bool read_scores(const std::string &dir, bool correlation,
+                 std::vector<size_t> &traces,
+                 std::vector<std::vector<double> > &scores);
+
+}; // namespace key_rank
+
+#endif // KEY_RANK__H
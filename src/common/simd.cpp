@@ -0,0 +1,180 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include "simd.h"
+
+using namespace std;
+
+namespace simd
+{
+#ifdef ENABLE_SIMD_X86
+    namespace sse2 {
+        void assign(kernel_table<float> &tf, kernel_table<double> &td);
+    };
+    namespace avx2 {
+        void assign(kernel_table<float> &tf, kernel_table<double> &td);
+    };
+    namespace avx512 {
+        void assign(kernel_table<float> &tf, kernel_table<double> &td);
+    };
+#endif
+
+    kernel_table<float>  n_float;
+    kernel_table<double> n_double;
+    isa                  n_isa = ISA_SCALAR;
+
+    // select the best supported kernels before main() is entered
+    static struct select_default {
+        select_default() { select("auto"); }
+    } _select_default;
+};
+
+// -----------------------------------------------------------------------------
+simd::isa simd::detect(void)
+{
+#ifdef ENABLE_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return ISA_AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+        return ISA_AVX2;
+    else if (__builtin_cpu_supports("sse2"))
+        return ISA_SSE2;
+#endif
+    return ISA_SCALAR;
+}
+
+// -----------------------------------------------------------------------------
+bool simd::select(const string &isa_name)
+{
+    isa requested = ISA_SCALAR;
+    if (isa_name == "auto")
+        requested = detect();
+    else if (isa_name == "avx512")
+        requested = ISA_AVX512;
+    else if (isa_name == "avx2")
+        requested = ISA_AVX2;
+    else if (isa_name == "sse2")
+        requested = ISA_SSE2;
+    else if (isa_name != "scalar") {
+        fprintf(stderr, "unknown instruction set: %s\n", isa_name.c_str());
+        return false;
+    }
+
+    if (requested > detect()) {
+        fprintf(stderr, "instruction set not supported: %s\n", name(requested));
+        return false;
+    }
+
+    switch (requested) {
+#ifdef ENABLE_SIMD_X86
+    case ISA_AVX512: avx512::assign(n_float, n_double); break;
+    case ISA_AVX2:   avx2::assign(n_float, n_double);   break;
+    case ISA_SSE2:   sse2::assign(n_float, n_double);   break;
+#endif
+    default:
+        n_float.assign<scalar_vec<float> >();
+        n_double.assign<scalar_vec<double> >();
+        break;
+    }
+
+    n_isa = requested;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+simd::isa simd::selected(void)
+{
+    return n_isa;
+}
+
+// -----------------------------------------------------------------------------
+const char *simd::name(isa i)
+{
+    switch (i) {
+    case ISA_AVX512: return "avx512";
+    case ISA_AVX2:   return "avx2";
+    case ISA_SSE2:   return "sse2";
+    default:         return "scalar";
+    }
+}
+
+// -----------------------------------------------------------------------------
+namespace simd {
+
+template <> void add(float *y, const float *x, size_t n)
+{ n_float.add(y, x, n); }
+
+template <> void add(double *y, const double *x, size_t n)
+{ n_double.add(y, x, n); }
+
+template <> void axpy(float *y, const float *x, float a, size_t n)
+{ n_float.axpy(y, x, a, n); }
+
+template <> void axpy(double *y, const double *x, double a, size_t n)
+{ n_double.axpy(y, x, a, n); }
+
+template <> void add_sq(float *s1, float *s2, const float *x, size_t n)
+{ n_float.add_sq(s1, s2, x, n); }
+
+template <> void add_sq(double *s1, double *s2, const double *x, size_t n)
+{ n_double.add_sq(s1, s2, x, n); }
+
+template <> float max(const float *x, size_t n, float m)
+{ return n_float.max(x, n, m); }
+
+template <> double max(const double *x, size_t n, double m)
+{ return n_double.max(x, n, m); }
+
+template <> void correlate(float *d, const float *tw, const float *t1,
+                           const float *sd, float w, float ni, float sh,
+                           size_t n)
+{ n_float.correlate(d, tw, t1, sd, w, ni, sh, n); }
+
+template <> void correlate(double *d, const double *tw, const double *t1,
+                           const double *sd, double w, double ni, double sh,
+                           size_t n)
+{ n_double.correlate(d, tw, t1, sd, w, ni, sh, n); }
+
+template <> void diff_means(float *d, const float *a, float na,
+                            const float *b, float nb, size_t n)
+{ n_float.diff_means(d, a, na, b, nb, n); }
+
+template <> void diff_means(double *d, const double *a, double na,
+                            const double *b, double nb, size_t n)
+{ n_double.diff_means(d, a, na, b, nb, n); }
+
+template <> float correlate_max(float *d, const float *tw, const float *t1,
+                                const float *sd, float w, float ni, float sh,
+                                size_t n, float m)
+{ return n_float.correlate_max(d, tw, t1, sd, w, ni, sh, n, m); }
+
+template <> double correlate_max(double *d, const double *tw,
+                                 const double *t1, const double *sd, double w,
+                                 double ni, double sh, size_t n, double m)
+{ return n_double.correlate_max(d, tw, t1, sd, w, ni, sh, n, m); }
+
+template <> float diff_means_max(float *d, const float *a, float na,
+                                 const float *b, float nb, size_t n, float m)
+{ return n_float.diff_means_max(d, a, na, b, nb, n, m); }
+
+template <> double diff_means_max(double *d, const double *a, double na,
+                                  const double *b, double nb, size_t n,
+                                  double m)
+{ return n_double.diff_means_max(d, a, na, b, nb, n, m); }
+
+}; // namespace simd
@@ -0,0 +1,134 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SIMD__H
+#define SIMD__H
+
+#include <cstddef>
+#include <string>
+#include "simd_kernels.h"
+
+//! Vectorized kernels for the attack accumulate and finalize loops.
+//!
+//! The float and double kernels are dispatched at runtime to the best
+//! instruction set supported by the processor (or the one selected by the
+//! user). Other types, such as long double, always use the scalar kernels.
+//! Every implementation performs the same operations in the same order
+//! (without fused multiply-add), so the results do not depend on the ISA.
+namespace simd {
+
+//! Instruction set extensions supported by the kernels.
+enum isa {
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_AVX512,
+};
+
+//! Return the best instruction set supported by this processor.
+isa detect(void);
+
+//! Select the kernels by name: auto, scalar, sse2, avx2 or avx512.
+bool select(const std::string &name);
+
+//! Return the currently selected instruction set.
+isa selected(void);
+
+//! Return the name of the specified instruction set.
+const char *name(isa i);
+
+//! Compute y[i] += x[i].
+template <typename real>
+void add(real *y, const real *x, size_t n)
+{ kernels<scalar_vec<real> >::add(y, x, n); }
+
+//! Compute y[i] += a * x[i].
+template <typename real>
+void axpy(real *y, const real *x, real a, size_t n)
+{ kernels<scalar_vec<real> >::axpy(y, x, a, n); }
+
+//! Compute s1[i] += x[i] and s2[i] += x[i] * x[i].
+template <typename real>
+void add_sq(real *s1, real *s2, const real *x, size_t n)
+{ kernels<scalar_vec<real> >::add_sq(s1, s2, x, n); }
+
+//! Return the maximum of m and x[0] through x[n - 1].
+template <typename real>
+real max(const real *x, size_t n, real m)
+{ return kernels<scalar_vec<real> >::max(x, n, m); }
+
+//! Compute d[i] = ((tw[i] - (w * t1[i]) * ni) * ni) / sd[i] / sh, where
+//! d[i] is zero if sd[i] is zero.
+template <typename real>
+void correlate(real *d, const real *tw, const real *t1, const real *sd,
+               real w, real ni, real sh, size_t n)
+{ kernels<scalar_vec<real> >::correlate(d, tw, t1, sd, w, ni, sh, n); }
+
+//! Compute d[i] = (b[i] / nb) - (a[i] / na).
+template <typename real>
+void diff_means(real *d, const real *a, real na, const real *b, real nb,
+                size_t n)
+{ kernels<scalar_vec<real> >::diff_means(d, a, na, b, nb, n); }
+
+//! Compute d[i] as correlate does, and return the maximum of m and every d[i].
+//! If d is NULL, only the maximum is computed.
+template <typename real>
+real correlate_max(real *d, const real *tw, const real *t1, const real *sd,
+                   real w, real ni, real sh, size_t n, real m)
+{ return kernels<scalar_vec<real> >::correlate_max(d, tw, t1, sd, w, ni, sh,
+                                                   n, m); }
+
+//! Compute d[i] as diff_means does, and return the maximum of m and every
+//! d[i]. If d is NULL, only the maximum is computed.
+template <typename real>
+real diff_means_max(real *d, const real *a, real na, const real *b, real nb,
+                    size_t n, real m)
+{ return kernels<scalar_vec<real> >::diff_means_max(d, a, na, b, nb, n, m); }
+
+// runtime dispatched specializations for float and double
+template <> void add(float *y, const float *x, size_t n);
+template <> void add(double *y, const double *x, size_t n);
+template <> void axpy(float *y, const float *x, float a, size_t n);
+template <> void axpy(double *y, const double *x, double a, size_t n);
+template <> void add_sq(float *s1, float *s2, const float *x, size_t n);
+template <> void add_sq(double *s1, double *s2, const double *x, size_t n);
+template <> float max(const float *x, size_t n, float m);
+template <> double max(const double *x, size_t n, double m);
+template <> void correlate(float *d, const float *tw, const float *t1,
+                           const float *sd, float w, float ni, float sh,
+                           size_t n);
+template <> void correlate(double *d, const double *tw, const double *t1,
+                           const double *sd, double w, double ni, double sh,
+                           size_t n);
+template <> void diff_means(float *d, const float *a, float na,
+                            const float *b, float nb, size_t n);
+template <> void diff_means(double *d, const double *a, double na,
+                            const double *b, double nb, size_t n);
+template <> float correlate_max(float *d, const float *tw, const float *t1,
+                                const float *sd, float w, float ni, float sh,
+                                size_t n, float m);
+template <> double correlate_max(double *d, const double *tw,
+                                 const double *t1, const double *sd, double w,
+                                 double ni, double sh, size_t n, double m);
+template <> float diff_means_max(float *d, const float *a, float na,
+                                 const float *b, float nb, size_t n, float m);
+template <> double diff_means_max(double *d, const double *a, double na,
+                                  const double *b, double nb, size_t n,
+                                  double m);
+
+}; // namespace simd
+
+#endif // SIMD__H
@@ -0,0 +1,89 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <immintrin.h>
+#include "simd_kernels.h"
+
+namespace simd {
+namespace avx2 {
+
+// -----------------------------------------------------------------------------
+struct vec_f {
+    typedef float  real;
+    typedef __m256 reg;
+    static const size_t width = 8;
+
+    static reg load(const real *p)       { return _mm256_loadu_ps(p); }
+    static void store(real *p, reg r)    { _mm256_storeu_ps(p, r); }
+    static reg set1(real x)              { return _mm256_set1_ps(x); }
+    static reg add(reg a, reg b)         { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b)         { return _mm256_sub_ps(a, b); }
+    static reg mul(reg a, reg b)         { return _mm256_mul_ps(a, b); }
+    static reg div(reg a, reg b)         { return _mm256_div_ps(a, b); }
+    static reg max(reg a, reg b)         { return _mm256_max_ps(a, b); }
+
+    static reg nonzero(reg m, reg x) {
+        const reg z = _mm256_cmp_ps(m, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        return _mm256_andnot_ps(z, x);
+    }
+
+    static real hmax(reg r) {
+        real v[width];
+        _mm256_storeu_ps(v, r);
+        real m = v[0];
+        for (size_t i = 1; i < width; ++i) m = (m < v[i]) ? v[i] : m;
+        return m;
+    }
+};
+
+// -----------------------------------------------------------------------------
+struct vec_d {
+    typedef double  real;
+    typedef __m256d reg;
+    static const size_t width = 4;
+
+    static reg load(const real *p)       { return _mm256_loadu_pd(p); }
+    static void store(real *p, reg r)    { _mm256_storeu_pd(p, r); }
+    static reg set1(real x)              { return _mm256_set1_pd(x); }
+    static reg add(reg a, reg b)         { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b)         { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b)         { return _mm256_mul_pd(a, b); }
+    static reg div(reg a, reg b)         { return _mm256_div_pd(a, b); }
+    static reg max(reg a, reg b)         { return _mm256_max_pd(a, b); }
+
+    static reg nonzero(reg m, reg x) {
+        const reg z = _mm256_cmp_pd(m, _mm256_setzero_pd(), _CMP_EQ_OQ);
+        return _mm256_andnot_pd(z, x);
+    }
+
+    static real hmax(reg r) {
+        real v[width];
+        _mm256_storeu_pd(v, r);
+        real m = v[0];
+        for (size_t i = 1; i < width; ++i) m = (m < v[i]) ? v[i] : m;
+        return m;
+    }
+};
+
+// -----------------------------------------------------------------------------
+void assign(kernel_table<float> &tf, kernel_table<double> &td)
+{
+    tf.assign<vec_f>();
+    td.assign<vec_d>();
+}
+
+}; // namespace avx2
+}; // namespace simd
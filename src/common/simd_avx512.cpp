@@ -0,0 +1,99 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <immintrin.h>
+#include "simd_kernels.h"
+
+namespace simd {
+namespace avx512 {
+
+// -----------------------------------------------------------------------------
+struct vec_f {
+    typedef float  real;
+    typedef __m512 reg;
+    static const size_t width = 16;
+
+    static reg load(const real *p)       { return _mm512_loadu_ps(p); }
+    static void store(real *p, reg r)    { _mm512_storeu_ps(p, r); }
+    static reg set1(real x)              { return _mm512_set1_ps(x); }
+    static reg add(reg a, reg b)         { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b)         { return _mm512_sub_ps(a, b); }
+    static reg mul(reg a, reg b)         { return _mm512_mul_ps(a, b); }
+    static reg div(reg a, reg b)         { return _mm512_div_ps(a, b); }
+
+    static reg max(reg a, reg b) {
+        const __mmask16 lt = _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+        return _mm512_mask_blend_ps(lt, a, b);
+    }
+
+    static reg nonzero(reg m, reg x) {
+        const __mmask16 nz = _mm512_cmp_ps_mask(m, _mm512_setzero_ps(),
+                                                _CMP_NEQ_UQ);
+        return _mm512_maskz_mov_ps(nz, x);
+    }
+
+    static real hmax(reg r) {
+        real v[width];
+        _mm512_storeu_ps(v, r);
+        real m = v[0];
+        for (size_t i = 1; i < width; ++i) m = (m < v[i]) ? v[i] : m;
+        return m;
+    }
+};
+
+// -----------------------------------------------------------------------------
+struct vec_d {
+    typedef double  real;
+    typedef __m512d reg;
+    static const size_t width = 8;
+
+    static reg load(const real *p)       { return _mm512_loadu_pd(p); }
+    static void store(real *p, reg r)    { _mm512_storeu_pd(p, r); }
+    static reg set1(real x)              { return _mm512_set1_pd(x); }
+    static reg add(reg a, reg b)         { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b)         { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b)         { return _mm512_mul_pd(a, b); }
+    static reg div(reg a, reg b)         { return _mm512_div_pd(a, b); }
+
+    static reg max(reg a, reg b) {
+        const __mmask8 lt = _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+        return _mm512_mask_blend_pd(lt, a, b);
+    }
+
+    static reg nonzero(reg m, reg x) {
+        const __mmask8 nz = _mm512_cmp_pd_mask(m, _mm512_setzero_pd(),
+                                               _CMP_NEQ_UQ);
+        return _mm512_maskz_mov_pd(nz, x);
+    }
+
+    static real hmax(reg r) {
+        real v[width];
+        _mm512_storeu_pd(v, r);
+        real m = v[0];
+        for (size_t i = 1; i < width; ++i) m = (m < v[i]) ? v[i] : m;
+        return m;
+    }
+};
+
+// -----------------------------------------------------------------------------
+void assign(kernel_table<float> &tf, kernel_table<double> &td)
+{
+    tf.assign<vec_f>();
+    td.assign<vec_d>();
+}
+
+}; // namespace avx512
+}; // namespace simd
@@ -0,0 +1,198 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SIMD_KERNELS__H
+#define SIMD_KERNELS__H
+
+#include <cstddef>
+
+namespace simd {
+
+//! Vector traits for plain scalar code, used as the fallback implementation.
+template <typename T>
+struct scalar_vec {
+    typedef T real;
+    typedef T reg;
+    static const size_t width = 1;
+
+    static reg load(const real *p)       { return *p; }
+    static void store(real *p, reg r)    { *p = r; }
+    static reg set1(real x)              { return x; }
+    static reg add(reg a, reg b)         { return a + b; }
+    static reg sub(reg a, reg b)         { return a - b; }
+    static reg mul(reg a, reg b)         { return a * b; }
+    static reg div(reg a, reg b)         { return a / b; }
+    static reg max(reg a, reg b)         { return (a < b) ? b : a; }
+    static reg nonzero(reg m, reg x)     { return (m != 0) ? x : 0; }
+    static real hmax(reg r)              { return r; }
+};
+
+//! Kernels written once in terms of the vector traits V. Each instruction set
+//! provides its own traits, and any remainder is processed one at a time.
+template <class V>
+struct kernels {
+    typedef typename V::real real;
+    typedef typename V::reg  reg;
+
+    static void add(real *y, const real *x, size_t n) {
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width)
+            V::store(y + i, V::add(V::load(y + i), V::load(x + i)));
+        for (; i < n; ++i) y[i] += x[i];
+    }
+
+    static void axpy(real *y, const real *x, real a, size_t n) {
+        const reg va = V::set1(a);
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width) {
+            const reg vx = V::mul(V::load(x + i), va);
+            V::store(y + i, V::add(V::load(y + i), vx));
+        }
+        for (; i < n; ++i) y[i] += x[i] * a;
+    }
+
+    static void add_sq(real *s1, real *s2, const real *x, size_t n) {
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width) {
+            const reg vx = V::load(x + i);
+            V::store(s1 + i, V::add(V::load(s1 + i), vx));
+            V::store(s2 + i, V::add(V::load(s2 + i), V::mul(vx, vx)));
+        }
+        for (; i < n; ++i) {
+            s1[i] += x[i];
+            s2[i] += x[i] * x[i];
+        }
+    }
+
+    static real max(const real *x, size_t n, real m) {
+        reg vm = V::set1(m);
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width)
+            vm = V::max(vm, V::load(x + i));
+
+        real r = V::hmax(vm);
+        for (; i < n; ++i) r = (r < x[i]) ? x[i] : r;
+        return r;
+    }
+
+    static void correlate(real *d, const real *tw, const real *t1,
+                          const real *sd, real w, real ni, real sh, size_t n) {
+        const reg vw = V::set1(w), vni = V::set1(ni), vsh = V::set1(sh);
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width) {
+            const reg vsd = V::load(sd + i);
+            const reg vc = V::mul(V::mul(vw, V::load(t1 + i)), vni);
+            const reg vd = V::mul(V::sub(V::load(tw + i), vc), vni);
+            V::store(d + i, V::div(V::nonzero(vsd, V::div(vd, vsd)), vsh));
+        }
+        for (; i < n; ++i) {
+            const real v = (tw[i] - w * t1[i] * ni) * ni;
+            d[i] = ((sd[i] != 0) ? (v / sd[i]) : 0) / sh;
+        }
+    }
+
+    static void diff_means(real *d, const real *a, real na, const real *b,
+                           real nb, size_t n) {
+        const reg vna = V::set1(na), vnb = V::set1(nb);
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width) {
+            const reg vb = V::div(V::load(b + i), vnb);
+            const reg va = V::div(V::load(a + i), vna);
+            V::store(d + i, V::sub(vb, va));
+        }
+        for (; i < n; ++i) d[i] = (b[i] / nb) - (a[i] / na);
+    }
+
+    static real correlate_max(real *d, const real *tw, const real *t1,
+                              const real *sd, real w, real ni, real sh,
+                              size_t n, real m) {
+        const reg vw = V::set1(w), vni = V::set1(ni), vsh = V::set1(sh);
+        reg vm = V::set1(m);
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width) {
+            const reg vsd = V::load(sd + i);
+            const reg vc = V::mul(V::mul(vw, V::load(t1 + i)), vni);
+            const reg vd = V::mul(V::sub(V::load(tw + i), vc), vni);
+            const reg vr = V::div(V::nonzero(vsd, V::div(vd, vsd)), vsh);
+            vm = V::max(vm, vr);
+            if (d) V::store(d + i, vr);
+        }
+
+        real r = V::hmax(vm);
+        for (; i < n; ++i) {
+            const real v = (tw[i] - w * t1[i] * ni) * ni;
+            const real c = ((sd[i] != 0) ? (v / sd[i]) : 0) / sh;
+            r = (r < c) ? c : r;
+            if (d) d[i] = c;
+        }
+        return r;
+    }
+
+    static real diff_means_max(real *d, const real *a, real na, const real *b,
+                               real nb, size_t n, real m) {
+        const reg vna = V::set1(na), vnb = V::set1(nb);
+        reg vm = V::set1(m);
+        size_t i = 0;
+        for (; i + V::width <= n; i += V::width) {
+            const reg vb = V::div(V::load(b + i), vnb);
+            const reg vr = V::sub(vb, V::div(V::load(a + i), vna));
+            vm = V::max(vm, vr);
+            if (d) V::store(d + i, vr);
+        }
+
+        real r = V::hmax(vm);
+        for (; i < n; ++i) {
+            const real c = (b[i] / nb) - (a[i] / na);
+            r = (r < c) ? c : r;
+            if (d) d[i] = c;
+        }
+        return r;
+    }
+};
+
+//! Table of kernel entry points for one instruction set and scalar type.
+template <typename T>
+struct kernel_table {
+    typedef T real;
+
+    void (*add)(real *, const real *, size_t);
+    void (*axpy)(real *, const real *, real, size_t);
+    void (*add_sq)(real *, real *, const real *, size_t);
+    real (*max)(const real *, size_t, real);
+    void (*correlate)(real *, const real *, const real *, const real *,
+                      real, real, real, size_t);
+    void (*diff_means)(real *, const real *, real, const real *, real, size_t);
+    real (*correlate_max)(real *, const real *, const real *, const real *,
+                          real, real, real, size_t, real);
+    real (*diff_means_max)(real *, const real *, real, const real *, real,
+                           size_t, real);
+
+    //! Point each entry at the kernels built from the vector traits V.
+    template <class V> void assign(void) {
+        add        = &kernels<V>::add;
+        axpy       = &kernels<V>::axpy;
+        add_sq     = &kernels<V>::add_sq;
+        max        = &kernels<V>::max;
+        correlate  = &kernels<V>::correlate;
+        diff_means = &kernels<V>::diff_means;
+        correlate_max  = &kernels<V>::correlate_max;
+        diff_means_max = &kernels<V>::diff_means_max;
+    }
+};
+
+}; // namespace simd
+
+#endif // SIMD_KERNELS__H
@@ -0,0 +1,85 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <emmintrin.h>
+#include "simd_kernels.h"
+
+namespace simd {
+namespace sse2 {
+
+// -----------------------------------------------------------------------------
+struct vec_f {
+    typedef float  real;
+    typedef __m128 reg;
+    static const size_t width = 4;
+
+    static reg load(const real *p)       { return _mm_loadu_ps(p); }
+    static void store(real *p, reg r)    { _mm_storeu_ps(p, r); }
+    static reg set1(real x)              { return _mm_set1_ps(x); }
+    static reg add(reg a, reg b)         { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b)         { return _mm_sub_ps(a, b); }
+    static reg mul(reg a, reg b)         { return _mm_mul_ps(a, b); }
+    static reg div(reg a, reg b)         { return _mm_div_ps(a, b); }
+    static reg max(reg a, reg b)         { return _mm_max_ps(a, b); }
+
+    static reg nonzero(reg m, reg x) {
+        return _mm_andnot_ps(_mm_cmpeq_ps(m, _mm_setzero_ps()), x);
+    }
+
+    static real hmax(reg r) {
+        real v[width];
+        _mm_storeu_ps(v, r);
+        real m = v[0];
+        for (size_t i = 1; i < width; ++i) m = (m < v[i]) ? v[i] : m;
+        return m;
+    }
+};
+
+// -----------------------------------------------------------------------------
+struct vec_d {
+    typedef double  real;
+    typedef __m128d reg;
+    static const size_t width = 2;
+
+    static reg load(const real *p)       { return _mm_loadu_pd(p); }
+    static void store(real *p, reg r)    { _mm_storeu_pd(p, r); }
+    static reg set1(real x)              { return _mm_set1_pd(x); }
+    static reg add(reg a, reg b)         { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b)         { return _mm_sub_pd(a, b); }
+    static reg mul(reg a, reg b)         { return _mm_mul_pd(a, b); }
+    static reg div(reg a, reg b)         { return _mm_div_pd(a, b); }
+    static reg max(reg a, reg b)         { return _mm_max_pd(a, b); }
+
+    static reg nonzero(reg m, reg x) {
+        return _mm_andnot_pd(_mm_cmpeq_pd(m, _mm_setzero_pd()), x);
+    }
+
+    static real hmax(reg r) {
+        real v[width];
+        _mm_storeu_pd(v, r);
+        return (v[0] < v[1]) ? v[1] : v[0];
+    }
+};
+
+// -----------------------------------------------------------------------------
+void assign(kernel_table<float> &tf, kernel_table<double> &td)
+{
+    tf.assign<vec_f>();
+    td.assign<vec_d>();
+}
+
+}; // namespace sse2
+}; // namespace simd
@@ -20,11 +20,26 @@
 #include <stdint.h>
 #include <vector>
 #include <set>
-
+#include <boost/shared_ptr.hpp>
+#include "utility.h"
+
+//! A power trace stored as a contiguous array of power values. The time of
+//! each sample is kept in a separate time axis, which is normally shared by
+//! every trace produced by a reader. The power values may also be a read-only
+//! view of memory owned by the reader, which is copied before modification.
+//!
+//! A trace read from an integer dataset instead holds the integer samples
+//! (levels) as digitized by the scope, either owned or as a view. The power
+//! values are then converted from the levels when they are first accessed.
 class trace {
 public:
     typedef std::set<uint32_t> event_set;
     typedef float real;
+    typedef int16_t level;
+    typedef std::vector<uint32_t> time_axis;
+    typedef boost::shared_ptr<const time_axis> time_axis_ptr;
+    typedef std::vector<real, util::aligned_allocator<real> > power_array;
+    typedef std::vector<level, util::aligned_allocator<level> > level_array;
 
     struct sample {
         sample(void) { }
@@ -35,51 +50,184 @@ public:
     };
 
     //! create an empty trace
-    trace(void) { }
+    trace(void) : m_view(NULL), m_lview(NULL) { }
 
     //! create an empty trace with the specified message text
-    trace(const std::vector<uint8_t> &text) : m_text(text) { }
+    trace(const std::vector<uint8_t> &text)
+    : m_text(text), m_view(NULL), m_lview(NULL) { }
 
     //! initialize a trace with the specified message text and sample data
     trace(const std::vector<uint8_t> &text, const std::vector<sample> &samples)
-    : m_text(text), m_samples(samples) { }
+    : m_text(text), m_view(NULL), m_lview(NULL) { set_samples(samples); }
 
     //! set the plaintext or ciphertext value
     void set_text(const std::vector<uint8_t> &data) { m_text = data; } 
 
+    //! set the plaintext or ciphertext value from an array of bytes
+    void set_text(const uint8_t *data, size_t n) {
+        m_text.assign(data, data + n);
+    }
+
     //! get the plaintext or ciphertext value
     const std::vector<uint8_t> &text(void) const { return m_text; }
 
-    //! set the sample data from an existing vector
-    void set_samples(const std::vector<sample> &data) { m_samples = data; }
+    //! attach a (shared) time axis and size the power array to match it
+    void set_axis(const time_axis_ptr &axis) {
+        m_times = axis;
+        m_view = NULL;
+        m_power.resize(axis->size());
+        drop_levels();
+    }
+
+    //! attach a (shared) time axis and refer to power samples owned by the
+    //! caller, which must remain valid while this trace refers to them
+    void set_view(const real *power, const time_axis_ptr &axis) {
+        m_times = axis;
+        m_view = power;
+        m_power.clear();
+        drop_levels();
+    }
+
+    //! attach a (shared) time axis and copy the integer samples into this
+    //! trace, widening them if they are narrower than a level
+    template <typename T>
+    void set_levels(const T *levels, const time_axis_ptr &axis) {
+        m_times = axis;
+        m_view = NULL;
+        m_power.clear();
+        m_levels.assign(levels, levels + axis->size());
+        m_lview = NULL;
+    }
+
+    //! attach a (shared) time axis and refer to integer samples owned by the
+    //! caller, which must remain valid while this trace refers to them
+    void set_level_view(const level *levels, const time_axis_ptr &axis) {
+        m_times = axis;
+        m_view = NULL;
+        m_power.clear();
+        m_levels.clear();
+        m_lview = levels;
+    }
+
+    //! return the integer samples, or NULL if the trace has none
+    const level *levels(void) const {
+        if (m_lview) return m_lview;
+        return m_levels.empty() ? NULL : &m_levels[0];
+    }
+
+    //! convert the integer samples to power values now, so that the power
+    //! may later be read concurrently by several threads
+    void decode_levels(void) const {
+        if (!levels() || m_power.size() == size()) return;
+        m_power.assign(levels(), levels() + size());
+    }
+
+    //! return the time axis of this trace
+    const time_axis_ptr &axis(void) const { return m_times; }
+
+    //! adopt the shared axis if it matches this trace's sample times,
+    //! otherwise make this trace's axis the shared axis for later traces
+    void share_axis(time_axis_ptr &shared) {
+        if (!m_times) return;
+        if (shared && *shared == *m_times) m_times = shared;
+        else shared = m_times;
+    }
+
+    //! return a pointer to the contiguous power samples (read-only)
+    const real *power(void) const {
+        decode_levels();
+        return m_view ? m_view : &m_power[0];
+    }
+
+    //! return a pointer to the contiguous power samples
+    real *power(void) { own_power(); return &m_power[0]; }
+
+    //! access the power of a specific sample index (read-only)
+    real power(size_t i) const { return power()[i]; }
+
+    //! access the power of a specific sample index
+    real &power(size_t i) { own_power(); return m_power[i]; }
+
+    //! return the time of a specific sample index
+    uint32_t time(size_t i) const { return (*m_times)[i]; }
 
-    //! return constant reference to this trace's samples
-    const std::vector<sample> &samples(void) const { return m_samples; }
+    //! set the sample data from an existing vector
+    void set_samples(const std::vector<sample> &data) {
+        clear();
+        for (size_t i = 0; i < data.size(); ++i) push_back(data[i]);
+    }
+
+    //! return a copy of this trace's samples as (time, power) pairs
+    std::vector<sample> samples(void) const {
+        std::vector<sample> data(size());
+        for (size_t i = 0; i < size(); ++i) data[i] = (*this)[i];
+        return data;
+    }
 
     //! access a specific sample index (read-only)
-    const sample &operator[](size_t i) const { return m_samples[i]; }
-
-    //! access a specific sample index
-    sample &operator[](size_t i) { return m_samples[i]; }
+    sample operator[](size_t i) const { return sample(time(i), power(i)); }
 
     //! add a new sample to the trace
-    void push_back(const sample &data) { m_samples.push_back(data); }
+    void push_back(const sample &data) {
+        own_power();
+        own_axis().push_back(data.time);
+        m_power.push_back(data.power);
+    }
 
-    //! access the last sample
-    sample &back(void) { return m_samples.back(); }
+    //! access the last sample (read-only)
+    sample back(void) const { return (*this)[size() - 1]; }
 
     //! return the number of samples in this trace
-    size_t size(void) const { return m_samples.size(); }
+    size_t size(void) const {
+        return (m_view || levels()) ? m_times->size() : m_power.size();
+    }
 
     //! remove all samples from the trace
-    void clear(void) { m_samples.clear(); }
+    void clear(void) {
+        m_times.reset();
+        m_view = NULL;
+        m_power.clear();
+        drop_levels();
+    }
 
     //! set the maximum number of samples in this trace
-    void resize(size_t n) { m_samples.resize(n); }
+    void resize(size_t n) {
+        own_power();
+        own_axis().resize(n);
+        m_power.resize(n);
+    }
 
 protected:
+    //! return a private copy of the time axis that may be modified
+    time_axis &own_axis(void) {
+        if (!m_times.unique())
+            m_times.reset(m_times ? new time_axis(*m_times) : new time_axis);
+
+        // every axis is allocated as non-const, so this cast is well-defined
+        return const_cast<time_axis &>(*m_times);
+    }
+
+    //! copy viewed power samples into this trace so that they may be modified
+    void own_power(void) {
+        decode_levels();
+        drop_levels();
+        if (!m_view) return;
+        m_power.assign(m_view, m_view + m_times->size());
+        m_view = NULL;
+    }
+
+    //! forget the integer samples, once the power is set or modified
+    void drop_levels(void) {
+        m_levels.clear();
+        m_lview = NULL;
+    }
+
     std::vector<uint8_t> m_text;
-    std::vector<sample>  m_samples;
+    time_axis_ptr        m_times;
+    mutable power_array  m_power;
+    const real          *m_view;
+    level_array          m_levels;
+    const level         *m_lview;
 };
 
 #endif // TRACE__H
@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include <cstdio>
+#include <sys/stat.h>
 #include "trace_format.h"
 #include "utility.h"
 
@@ -25,12 +26,15 @@ extern trace_reader *create_trace_reader_out(void);
 extern trace_reader *create_trace_reader_packed(void);
 extern trace_reader *create_trace_reader_simv(void);
 extern trace_reader *create_trace_reader_sqlite(void);
+extern trace_reader *create_trace_reader_stream(void);
 extern trace_reader *create_trace_reader_v1(void);
 extern trace_reader *create_trace_reader_v2(void);
 extern trace_reader *create_trace_reader_v3(void);
 
 extern trace_writer *create_trace_writer_csv(void);
 extern trace_writer *create_trace_writer_packed(void);
+extern trace_writer *create_trace_writer_packed8(void);
+extern trace_writer *create_trace_writer_packed16(void);
 extern trace_writer *create_trace_writer_sqlite(void);
 extern trace_writer *create_trace_writer_v3(void);
 
@@ -38,6 +42,12 @@ extern trace_writer *create_trace_writer_v3(void);
 // static
 string trace_reader::guess_format(const string &path)
 {
+    // standard input, a fifo, or a unix socket is read as a trace stream
+    struct stat st;
+    if (path == "-" || !path.compare(0, 5, "unix:") ||
+        (!stat(path.c_str(), &st) && S_ISFIFO(st.st_mode)))
+        return "stream";
+
     if (!util::path_exists(path) || !util::is_directory(path)) {
         // input path is a file, or does not exist, so determine type by name
         const string ext(util::path_extension(path));
@@ -79,6 +89,7 @@ trace_reader *trace_reader::create(const string &format)
     if      (format == "out")    return create_trace_reader_out();
     else if (format == "packed") return create_trace_reader_packed();
     else if (format == "simv")   return create_trace_reader_simv();
+    else if (format == "stream") return create_trace_reader_stream();
     else if (format == "v1")     return create_trace_reader_v1();
     else if (format == "v2")     return create_trace_reader_v2();
     else if (format == "v3")     return create_trace_reader_v3();
@@ -91,33 +102,47 @@ trace_reader *trace_reader::create(const string &format)
     }
 }
 
+// -----------------------------------------------------------------------------
+// static
+trace::time_axis_ptr trace_reader::make_axis(const trace::event_set &events)
+{
+    return trace::time_axis_ptr(new trace::time_axis(events.begin(),
+                                                     events.end()));
+}
+
 // -----------------------------------------------------------------------------
 // static
 bool trace_reader::copy_trace(const trace &pt_in, trace &pt_out,
-                              const trace::event_set &events)
+                              const trace::time_axis_ptr &axis)
 {
+    const trace::time_axis &events = *axis;
     trace::real last_power = 0.0f;
-    trace::event_set::const_iterator curr_event = events.begin();
+    size_t curr_event = 0;
+
+    pt_out.set_axis(axis);
+    trace::real *power = pt_out.power();
+
+    for (size_t i = 0; i < pt_in.size(); ++i) {
+        const uint32_t time = pt_in.time(i);
 
-    foreach (const trace::sample sample, pt_in.samples()) {
         // primetime may break the power sample into multiple events
-        if (pt_out.size() && pt_out.back().time == sample.time)
+        if (curr_event && events[curr_event - 1] == time)
             return false;
 
         // sample and hold by copying the previous power into each empty sample
-        while ((curr_event != events.end()) && (*curr_event < sample.time))
-            pt_out.push_back(trace::sample(*curr_event++, sample.power));
+        while ((curr_event < events.size()) && (events[curr_event] < time))
+            power[curr_event++] = pt_in.power(i);
 
-        assert(sample.time == *curr_event);
-        pt_out.push_back(trace::sample(*curr_event++, sample.power));
+        assert(curr_event < events.size() && time == events[curr_event]);
+        power[curr_event++] = pt_in.power(i);
 
         // if this is disabled, last_power will always be 0 (ie. empty samples)
-        last_power = sample.power;
+        last_power = pt_in.power(i);
     }
 
     // pad out (with sample and hold) any trailing samples, if necessary
-    while (curr_event != events.end())
-        pt_out.push_back(trace::sample(*curr_event++, last_power));
+    while (curr_event < events.size())
+        power[curr_event++] = last_power;
 
     return true;
 }
@@ -128,6 +153,8 @@ trace_writer *trace_writer::create(const string &format)
 {
     if      (format == "csv")    return create_trace_writer_csv();
     else if (format == "packed") return create_trace_writer_packed();
+    else if (format == "packed8")  return create_trace_writer_packed8();
+    else if (format == "packed16") return create_trace_writer_packed16();
     else if (format == "v3")     return create_trace_writer_v3();
 #ifdef HAVE_SQLITE3_H
     else if (format == "sqlite") return create_trace_writer_sqlite();
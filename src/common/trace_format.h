@@ -37,9 +37,12 @@ struct trace_reader {
     //! Create a trace_reader instance for the given trace format.
     static trace_reader *create(const std::string &format);
 
-    //! Copy the input trace to the output trace, expanding if necessary.
+    //! Build a time axis containing each of the specified events in order.
+    static trace::time_axis_ptr make_axis(const trace::event_set &events);
+
+    //! Copy the input trace onto the given time axis, expanding if necessary.
     static bool copy_trace(const trace &pt_in, trace &pt_out,
-                           const trace::event_set &events);
+                           const trace::time_axis_ptr &axis);
 
     //! Provide a summary of the specified trace directory.
     virtual bool summary(const std::string &path) const = 0;
@@ -53,9 +56,26 @@ struct trace_reader {
     //! Read the next trace into pt, limited to the specified time range.
     virtual bool read(trace &pt) = 0;
 
-    //! Returns the number traces available for reading.
+    //! Skip over the next count traces, as when resuming an attack.
+    virtual bool skip(size_t count) {
+        trace pt;
+        for (size_t i = 0; i < count; ++i) {
+            if (!read(pt)) return false;
+        }
+        return true;
+    }
+
+    //! Returns the number traces available for reading. For a streaming
+    //! reader this is only an upper bound, and zero if the stream is open-ended.
     virtual size_t trace_count(void) const = 0;
 
+    //! Returns true if traces are read from a stream as they are acquired.
+    virtual bool streaming(void) const { return false; }
+
+    //! Returns true if the traces hold the integer samples (levels) of the
+    //! scope, as read from an integer dataset.
+    virtual bool integer(void) const { return false; }
+
     //! Returns a set of time events across the traces read so far.
     virtual const trace::event_set &events(void) const = 0;
 
@@ -67,8 +67,8 @@ bool trace_writer_csv::write(const trace &pt)
         return false;
     }
 
-    foreach (const trace::sample &sample, pt.samples())
-        fout << sample.time << "," << sample.power << ",\n";
+    for (size_t i = 0; i < pt.size(); ++i)
+        fout << pt.time(i) << "," << pt.power(i) << ",\n";
 
     return true;
 }
@@ -35,10 +35,11 @@ public:
 protected:
     bool read_waveform_data(const string &path);
 
-    options          m_opt;
-    trace::event_set m_events;  // set of unique power event timestamps
-    vector<trace>    m_traces;  // power waveforms
-    unsigned int     m_current; // current trace index for ::read()
+    options              m_opt;
+    trace::event_set     m_events;  // set of unique power event timestamps
+    trace::time_axis_ptr m_axis;    // time axis shared by every trace read
+    vector<trace>        m_traces;  // power waveforms
+    unsigned int         m_current; // current trace index for ::read()
 };
 
 // -----------------------------------------------------------------------------
@@ -74,6 +75,7 @@ bool trace_reader_out::open(const string &path, const options &opt)
     }
 
     printf("\n");
+    m_axis = trace_reader::make_axis(m_events);
     return true;
 }
 
@@ -110,7 +112,8 @@ bool trace_reader_out::read_waveform_data(const string &path)
                 fprintf(stderr, "error: read power sample before event time\n");
                 return false;
             }
-            curr_trace.back().power += strtof(&curr_line[2], NULL);
+            curr_trace.power(curr_trace.size() - 1) +=
+                strtof(&curr_line[2], NULL);
         }
         else {
             // time index -- add a new trace entry, break if max time reached
@@ -132,6 +135,7 @@ bool trace_reader_out::read_waveform_data(const string &path)
 void trace_reader_out::close()
 {
     m_events.clear();
+    m_axis.reset();
     m_traces.clear();
     m_current = 0;
 }
@@ -144,10 +148,9 @@ bool trace_reader_out::read(trace &pt)
         return false;
 
     // initialize the trace object with the previously extracted message text
-    pt.clear();
     pt.set_text(m_traces[m_current].text());
 
-    return trace_reader::copy_trace(m_traces[m_current++], pt, m_events);
+    return trace_reader::copy_trace(m_traces[m_current++], pt, m_axis);
 }
 
 register_trace_reader(out, trace_reader_out);
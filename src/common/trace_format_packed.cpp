@@ -17,44 +17,74 @@
 #include <fstream>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "trace_format.h"
 #include "utility.h"
 
 using namespace std;
 
 // -----------------------------------------------------------------------------
+// Reads packed traces from a memory mapping of the trace file. Each trace is a
+// view of its power samples within the mapping, so no samples are copied.
+//
+// A float dataset (TRACE.30) holds single precision power samples, while an
+// integer dataset (TRACE.31) holds the 8 or 16 bit samples of the scope, and
+// records their width after the sample count. 16 bit samples are viewed in
+// place as the levels of each trace; 8 bit samples are widened.
 class trace_reader_packed: public trace_reader {
 public:
+    trace_reader_packed(void);
+    ~trace_reader_packed(void);
+
     bool summary(const string &path) const;
     bool open(const string &path, const options &opt);
     void close(void);
     bool read(trace &pt);
+    bool skip(size_t count);
     size_t trace_count(void) const             { return m_ntraces; }
+    bool integer(void) const                   { return 32 != m_bits; }
     const trace::event_set &events(void) const { return m_events; }
 
 protected:
-    trace::event_set m_events;
-    vector<uint32_t> m_times;
-    ifstream         m_input;
-    uint32_t         m_textlen;
-    uint32_t         m_ntraces;
-    unsigned long    m_tmin;
-    unsigned long    m_tmax;
-    size_t           m_current;
+    trace::event_set     m_events;
+    trace::time_axis_ptr m_axis;    // time axis shared by every trace read
+    int                  m_fd;      // trace file descriptor
+    const uint8_t       *m_map;     // memory mapping of the trace file
+    size_t               m_size;    // size of the trace file in bytes
+    size_t               m_data;    // offset of the first trace record
+    size_t               m_stride;  // size of each trace record in bytes
+    size_t               m_first;   // index of the first sample in range
+    uint32_t             m_bits;    // bits per sample (32 for float samples)
+    uint32_t             m_textlen;
+    uint32_t             m_ntraces;
+    size_t               m_current;
 };
 
 // -----------------------------------------------------------------------------
+// Writes packed traces of float samples, or of 8 or 16 bit integer samples.
+// Integer samples are the levels of each trace if it has them, otherwise the
+// power values are rounded to the nearest level and saturated.
 class trace_writer_packed: public trace_writer {
 public:
+    trace_writer_packed(uint32_t bits = 32);
+
     bool open(const string &path, const string &key, const trace::event_set &e);
     void close(void);
     bool write(const trace &pt);
 
 protected:
     ofstream m_output;
+    uint32_t m_bits;
     uint32_t m_textlen;
     uint32_t m_ntraces;
     uint32_t m_samples;
+    size_t   m_clipped; // number of integer samples saturated
+    vector<int16_t> m_levels;
 };
 
 // -----------------------------------------------------------------------------
@@ -66,46 +96,100 @@ bool trace_reader_packed::summary(const string &path) const
     return true;
 }
 
+// -----------------------------------------------------------------------------
+trace_reader_packed::trace_reader_packed(void)
+: m_fd(-1), m_map(NULL), m_size(0), m_bits(32), m_ntraces(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+trace_reader_packed::~trace_reader_packed(void)
+{
+    close();
+}
+
 // -----------------------------------------------------------------------------
 // virtual
 bool trace_reader_packed::open(const string &path, const options &opt)
 {
     close();
-    m_tmin = opt.min_time;
-    m_tmax = opt.max_time;
 
-    // attempt to open the trace archive for reading in binary mode
-    m_input.open(path.c_str(), ios::binary);
-    if (!m_input.is_open()) {
+    // map the entire trace archive into memory for reading
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (m_fd < 0 || fstat(m_fd, &st) < 0) {
         fprintf(stderr, "unable to open bin file '%s'\n", path.c_str());
         return false;
     }
 
-    // read in the header and version number, and verify that they are correct
-    string header(8, 0);
-    m_input.read(&header[0], 8);
-
-    if (header != "TRACE.30") {
-        fprintf(stderr, "read invalid header %s\n", header.c_str());
+    m_size = st.st_size;
+    void *map = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (MAP_FAILED == map) {
+        fprintf(stderr, "unable to map bin file '%s'\n", path.c_str());
+        m_size = 0;
         return false;
     }
 
-    // read the text length, trace count, and sample/event count
+    // the traces are read once from start to finish, so read ahead eagerly
+    // and back the mapping with huge pages if the kernel supports it
+    madvise(map, m_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(map, m_size, MADV_HUGEPAGE);
+#endif
+    m_map = (const uint8_t *)map;
+
+    // verify the header and version number, followed by the text length,
+    // trace count, and sample/event count (and the sample width if integer)
     uint32_t num_samples = 0;
-    m_input.read((char *)&m_textlen, sizeof(uint32_t));
-    m_input.read((char *)&m_ntraces, sizeof(uint32_t));
-    m_input.read((char *)&num_samples, sizeof(uint32_t));
+    const bool integer = m_size >= 24 && !memcmp(m_map, "TRACE.31", 8);
+    if (!integer && (m_size < 20 || memcmp(m_map, "TRACE.30", 8))) {
+        fprintf(stderr, "read invalid header in '%s'\n", path.c_str());
+        return false;
+    }
 
-    // read in the complete set of event times
-    m_times.resize(num_samples);
-    m_input.read((char *)&m_times[0], sizeof(uint32_t) * num_samples);
+    memcpy(&m_textlen, m_map + 8, sizeof(uint32_t));
+    memcpy(&m_ntraces, m_map + 12, sizeof(uint32_t));
+    memcpy(&num_samples, m_map + 16, sizeof(uint32_t));
+
+    const size_t header = integer ? 24 : 20;
+    m_bits = 32;
+    if (integer) {
+        memcpy(&m_bits, m_map + 20, sizeof(uint32_t));
+        if (m_bits != 8 && m_bits != 16) {
+            fprintf(stderr, "unsupported sample width (%u bits) in '%s'\n",
+                    m_bits, path.c_str());
+            return false;
+        }
+    }
+
+    m_data = header + sizeof(uint32_t) * num_samples;
+    m_stride = m_textlen + (m_bits / 8) * num_samples;
+    if (m_size < m_data) {
+        fprintf(stderr, "truncated event times in '%s'\n", path.c_str());
+        return false;
+    }
 
-    foreach (uint32_t event_time, m_times) {
-        if (m_tmin && event_time < m_tmin) continue;
-        if (m_tmax && event_time > m_tmax) break;
+    // read in the complete set of event times, limited to the time range
+    vector<uint32_t> times(num_samples);
+    memcpy(&times[0], m_map + header, sizeof(uint32_t) * num_samples);
+
+    m_first = 0;
+    foreach (uint32_t event_time, times) {
+        if (opt.min_time && event_time < opt.min_time) { ++m_first; continue; }
+        if (opt.max_time && event_time > opt.max_time) break;
         m_events.insert(event_time);
     }
 
+    m_axis = trace_reader::make_axis(m_events);
+
+    // only hand out traces that are completely contained in the file
+    const size_t available = m_stride ? (m_size - m_data) / m_stride : 0;
+    if (m_ntraces > available) {
+        fprintf(stderr, "warning: only %zu of %u traces present in '%s'\n",
+                available, m_ntraces, path.c_str());
+        m_ntraces = available;
+    }
+
     if (opt.num_traces > 0) {
         // if specified, limit the maximum number of traces to process
         m_ntraces = min(m_ntraces, (uint32_t)opt.num_traces);
@@ -120,10 +204,17 @@ bool trace_reader_packed::open(const string &path, const options &opt)
 void trace_reader_packed::close(void)
 {
     m_events.clear();
-    m_times.clear();
+    m_axis.reset();
+    m_ntraces = 0;
+
+    if (m_map)
+        munmap((void *)m_map, m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
 
-    if (m_input.is_open())
-        m_input.close();
+    m_map = NULL;
+    m_size = 0;
+    m_fd = -1;
 }
 
 // -----------------------------------------------------------------------------
@@ -133,28 +224,55 @@ bool trace_reader_packed::read(trace &pt)
     if (m_current >= m_ntraces)
         return false;
 
-    // read in the message text
-    vector<uint8_t> text(m_textlen, 0);
-    m_input.read((char *)&text[0], sizeof(uint8_t) * m_textlen);
+    // each record is the message text followed by the power waveform
+    const uint8_t *record = m_map + m_data + m_current++ * m_stride;
+    pt.set_text(record, m_textlen);
 
-    pt.clear();
-    pt.set_text(text);
-
-    // read in the sample data
-    trace::sample data;
-    foreach (uint32_t event_time, m_times) {
-        m_input.read((char *)&data.power, sizeof(trace::real));
+    // skip straight to the first sample in range, and refer to the samples in
+    // place unless they are misaligned (only copy them in that case)
+    const uint8_t *samples = record + m_textlen + m_first * (m_bits / 8);
+    if (8 == m_bits) {
+        pt.set_levels((const int8_t *)samples, m_axis);
+    }
+    else if (16 == m_bits) {
+        if (!((uintptr_t)samples % sizeof(trace::level))) {
+            pt.set_level_view((const trace::level *)samples, m_axis);
+        }
+        else {
+            vector<trace::level> levels(m_axis->size());
+            memcpy(&levels[0], samples, sizeof(trace::level) * levels.size());
+            pt.set_levels(&levels[0], m_axis);
+        }
+    }
+    else if (!((uintptr_t)samples % sizeof(trace::real))) {
+        pt.set_view((const trace::real *)samples, m_axis);
+    }
+    else {
+        pt.set_axis(m_axis);
+        memcpy(pt.power(), samples, sizeof(trace::real) * pt.size());
+    }
 
-        if (m_tmin && data.time < m_tmin) continue;
-        if (m_tmax && data.time > m_tmax) continue; // NOTE: can NOT break!
+    return true;
+}
 
-        data.time = event_time;
-        pt.push_back(data);
-    }
+// -----------------------------------------------------------------------------
+// virtual
+bool trace_reader_packed::skip(size_t count)
+{
+    // the records are a fixed size, so skipping only moves the current index
+    if (count > m_ntraces - m_current)
+        return false;
 
+    m_current += count;
     return true;
 }
 
+// -----------------------------------------------------------------------------
+trace_writer_packed::trace_writer_packed(uint32_t bits)
+: m_bits(bits), m_clipped(0)
+{
+}
+
 // -----------------------------------------------------------------------------
 // virtual
 bool trace_writer_packed::open(const string &path, const string &key,
@@ -171,10 +289,12 @@ bool trace_writer_packed::open(const string &path, const string &key,
     m_ntraces = 0;
     m_samples = events.size();
 
-    m_output.write("TRACE.30", 8);
+    m_output.write((32 == m_bits) ? "TRACE.30" : "TRACE.31", 8);
     m_output.write((const char *)&m_textlen, sizeof(uint32_t));
     m_output.write((const char *)&m_ntraces, sizeof(uint32_t));
     m_output.write((const char *)&m_samples, sizeof(uint32_t));
+    if (32 != m_bits)
+        m_output.write((const char *)&m_bits, sizeof(uint32_t));
 
     // write the complete set of event times immediately before the samples
     foreach (uint32_t event_time, events)
@@ -192,6 +312,11 @@ void trace_writer_packed::close(void)
     m_output.write((const char *)&m_textlen, sizeof(uint32_t));
     m_output.write((const char *)&m_ntraces, sizeof(uint32_t));
     m_output.close();
+
+    if (m_clipped) {
+        fprintf(stderr, "warning: %zu sample(s) saturated at %u bits\n",
+                m_clipped, m_bits);
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -208,7 +333,7 @@ bool trace_writer_packed::write(const trace &pt)
         return false;
     }
 
-    if (m_samples != pt.samples().size()) {
+    if (m_samples != pt.size()) {
         fprintf(stderr, "invalid sample count: got %zu, expected %zu\n",
                 pt.size(), (size_t)m_samples);
         return false;
@@ -217,8 +342,32 @@ bool trace_writer_packed::write(const trace &pt)
     // write the message text followed by the power waveform
     m_output.write((const char *)&pt.text()[0], sizeof(uint8_t) * m_textlen);
 
-    foreach (const trace::sample &sample, pt.samples())
-        m_output.write((const char *)&sample.power, sizeof(trace::real));
+    if (32 == m_bits) {
+        m_output.write((const char *)pt.power(),
+                       sizeof(trace::real) * pt.size());
+        ++m_ntraces;
+        return true;
+    }
+
+    // store the levels of the trace, or its power rounded to the nearest level
+    const long top = (1L << (m_bits - 1)) - 1;
+    const trace::level *levels = pt.levels();
+
+    m_levels.resize(pt.size());
+    for (size_t i = 0; i < pt.size(); ++i) {
+        const long v = levels ? levels[i] : lrint(pt.power(i));
+        m_levels[i] = (int16_t)max(-top - 1, min(top, v));
+        if (m_levels[i] != v) ++m_clipped;
+    }
+
+    if (8 == m_bits) {
+        const vector<int8_t> narrow(m_levels.begin(), m_levels.end());
+        m_output.write((const char *)&narrow[0], narrow.size());
+    }
+    else {
+        m_output.write((const char *)&m_levels[0],
+                       sizeof(int16_t) * m_levels.size());
+    }
 
     ++m_ntraces;
     return true;
@@ -226,4 +375,6 @@ bool trace_writer_packed::write(const trace &pt)
 
 register_trace_reader(packed, trace_reader_packed);
 register_trace_writer(packed, trace_writer_packed);
+register_trace_writer(packed8, trace_writer_packed(8));
+register_trace_writer(packed16, trace_writer_packed(16));
 
@@ -46,12 +46,13 @@ protected:
     bool read_events(const string &path, size_t base);
     bool read_waveforms(const string &path, size_t base);
 
-    options          m_opt;
-    size_t           m_current; //!< current trace index for ::read()
-    size_t           m_traces;  //!< maximum number of traces to process
-    trace::event_set m_events;  //!< set of unique power event timestamps
-    fstream          m_wavfile; //!< temporary waveform input file
-    vector<record>   m_records; //!< simulation base event and text
+    options              m_opt;
+    size_t               m_current; //!< current trace index for ::read()
+    size_t               m_traces;  //!< maximum number of traces to process
+    trace::event_set     m_events;  //!< set of unique power event timestamps
+    trace::time_axis_ptr m_axis;    //!< time axis shared by every trace read
+    fstream              m_wavfile; //!< temporary waveform input file
+    vector<record>       m_records; //!< simulation base event and text
 };
 
 // -----------------------------------------------------------------------------
@@ -110,6 +111,8 @@ bool trace_reader_simv::open(const string &path, const options &opt)
         fprintf(stderr, "failed to open temporary waveform file for reading\n");
         return false;
     }
+
+    m_axis = trace_reader::make_axis(m_events);
     return true;
 }
 
@@ -189,8 +192,10 @@ bool trace_reader_simv::read_waveforms(const string &path, size_t base)
             else if (event_time >= m_records[record_index + 1].event) {
                 // dump the current trace data and select the next timestamp
                 m_wavfile << record_index << ' ';
-                foreach (const trace::sample &sample, curr_trace.samples())
-                    m_wavfile << sample.time << ' ' << sample.power << ' ';
+                for (size_t i = 0; i < curr_trace.size(); ++i) {
+                    m_wavfile << curr_trace.time(i) << ' '
+                              << curr_trace.power(i) << ' ';
+                }
                 m_wavfile << endl;
                 curr_trace.clear();
                 ++m_traces;
@@ -215,7 +220,8 @@ bool trace_reader_simv::read_waveforms(const string &path, size_t base)
         }
         else if (curr_line[0] == '1' && curr_trace.size()) {
             // only write out data for the top level events (pp_root)
-            curr_trace.back().power += strtod(&curr_line[split_pos], NULL);
+            curr_trace.power(curr_trace.size() - 1) +=
+                strtod(&curr_line[split_pos], NULL);
         }
     }
 
@@ -252,11 +258,10 @@ bool trace_reader_simv::read(trace &pt)
         curr_trace.push_back(sample);
 
     // initialize the trace object with the message text from simulation.txt
-    pt.clear();
     pt.set_text(util::atob(m_records[record_index].text));
 
     ++m_current;
-    return trace_reader::copy_trace(curr_trace, pt, m_events);
+    return trace_reader::copy_trace(curr_trace, pt, m_axis);
 }
 
 register_trace_reader(simv, trace_reader_simv);
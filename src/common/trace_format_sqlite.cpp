@@ -33,12 +33,13 @@ public:
     const trace::event_set &events(void) const { return m_events; }
 
 protected:
-    trace::event_set  m_events;
-    sqlite3          *m_db;
-    sqlite3_stmt     *m_stmt;
-    size_t            m_count;
-    unsigned long     m_tmin;
-    unsigned long     m_tmax;
+    trace::event_set     m_events;
+    trace::time_axis_ptr m_axis; // time axis shared by every trace read
+    sqlite3             *m_db;
+    sqlite3_stmt        *m_stmt;
+    size_t               m_count;
+    unsigned long        m_tmin;
+    unsigned long        m_tmax;
 };
 
 // -----------------------------------------------------------------------------
@@ -138,6 +139,7 @@ bool trace_reader_sqlite::read(trace &pt)
         m_events.insert(i);
     }
 
+    pt.share_axis(m_axis);
     return true;
 }
 
@@ -191,10 +193,7 @@ bool trace_writer_sqlite::write(const trace &pt)
 {
     const string text(util::btoa(pt.text()));
 
-    vector<float> samples;
-    for (size_t i = 0; i < pt.size(); ++i)
-        samples.push_back(pt[i].power);
-    const char *data = (const char *)&samples[0];
+    const char *data = (const char *)pt.power();
 
     sqlite3_bind_text(m_stmt, 1, m_key.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(m_stmt, 2, text.c_str(), -1, SQLITE_TRANSIENT);
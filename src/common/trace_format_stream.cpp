@@ -0,0 +1,247 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "trace_format.h"
+#include "utility.h"
+
+using namespace std;
+
+// prefix of an input path naming a unix socket to listen on
+#define UNIX_SOCKET_PREFIX "unix:"
+
+// -----------------------------------------------------------------------------
+// Reads traces from a stream as they are acquired: standard input ("-"), a
+// FIFO, or a single producer connected to a unix socket ("unix:PATH"). The
+// stream uses the packed trace framing: the "TRACE.30" header with the text
+// length, trace count and sample count, followed by the event times and then
+// one record (message text and power samples) per trace. A trace count of
+// zero means the stream is open-ended, and traces are read until it closes.
+class trace_reader_stream: public trace_reader {
+public:
+    trace_reader_stream(void);
+    ~trace_reader_stream(void);
+
+    bool summary(const string &path) const;
+    bool open(const string &path, const options &opt);
+    void close(void);
+    bool read(trace &pt);
+    bool streaming(void) const                 { return true; }
+    size_t trace_count(void) const             { return m_ntraces; }
+    const trace::event_set &events(void) const { return m_events; }
+
+protected:
+    bool read_data(void *buf, size_t count, bool &eof);
+
+    trace::event_set     m_events;
+    trace::time_axis_ptr m_axis;    // time axis shared by every trace read
+    int                  m_fd;      // stream file descriptor
+    string               m_socket;  // path of the unix socket, if any
+    vector<uint8_t>      m_record;  // buffer for a single trace record
+    size_t               m_first;   // index of the first sample in range
+    uint32_t             m_textlen;
+    size_t               m_ntraces; // traces to read, or zero if open-ended
+    size_t               m_current;
+};
+
+// -----------------------------------------------------------------------------
+// virtual
+bool trace_reader_stream::summary(const string &path) const
+{
+    fprintf(stderr, "trace_reader_stream::summary is not supported\n");
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+trace_reader_stream::trace_reader_stream(void)
+: m_fd(-1), m_ntraces(0), m_current(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+trace_reader_stream::~trace_reader_stream(void)
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------
+// Read exactly count bytes, blocking until they arrive. Returns false with eof
+// set if the stream closes before the first byte.
+bool trace_reader_stream::read_data(void *buf, size_t count, bool &eof)
+{
+    size_t total = 0;
+    eof = false;
+
+    while (total < count) {
+        const ssize_t bytes = ::read(m_fd, (char *)buf + total, count - total);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        else if (bytes < 0) {
+            perror("read");
+            return false;
+        }
+        else if (bytes == 0) {
+            eof = !total;
+            if (total)
+                fprintf(stderr, "stream closed within a trace record\n");
+            return false;
+        }
+        total += bytes;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// virtual
+bool trace_reader_stream::open(const string &path, const options &opt)
+{
+    close();
+
+    if (path == "-") {
+        m_fd = dup(STDIN_FILENO);
+    }
+    else if (!path.compare(0, strlen(UNIX_SOCKET_PREFIX), UNIX_SOCKET_PREFIX)) {
+        // listen on the socket and accept the connection of a single producer
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+
+        const string name = path.substr(strlen(UNIX_SOCKET_PREFIX));
+        if (name.empty() || name.length() >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "invalid unix socket path '%s'\n", name.c_str());
+            return false;
+        }
+        strcpy(addr.sun_path, name.c_str());
+
+        const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(name.c_str());
+        if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+            listen(sock, 1)) {
+            fprintf(stderr, "unable to listen on '%s'\n", name.c_str());
+            if (sock >= 0) ::close(sock);
+            return false;
+        }
+
+        m_socket = name;
+        printf("waiting for a trace source to connect to '%s'...\n",
+               name.c_str());
+        m_fd = accept(sock, NULL, NULL);
+        ::close(sock);
+    }
+    else {
+        m_fd = ::open(path.c_str(), O_RDONLY);
+    }
+
+    if (m_fd < 0) {
+        fprintf(stderr, "unable to open trace stream '%s'\n", path.c_str());
+        return false;
+    }
+
+    // verify the header and version number, followed by the text length,
+    // trace count, and sample/event count
+    char magic[8];
+    uint32_t num_traces = 0, num_samples = 0;
+    bool eof = false;
+    if (!read_data(magic, sizeof(magic), eof) || memcmp(magic, "TRACE.30", 8) ||
+        !read_data(&m_textlen, sizeof(uint32_t), eof) ||
+        !read_data(&num_traces, sizeof(uint32_t), eof) ||
+        !read_data(&num_samples, sizeof(uint32_t), eof)) {
+        fprintf(stderr, "read invalid header in '%s'\n", path.c_str());
+        return false;
+    }
+
+    vector<uint32_t> times(num_samples);
+    if (num_samples &&
+        !read_data(&times[0], sizeof(uint32_t) * num_samples, eof)) {
+        fprintf(stderr, "truncated event times in '%s'\n", path.c_str());
+        return false;
+    }
+
+    // read in the complete set of event times, limited to the time range
+    m_first = 0;
+    foreach (uint32_t event_time, times) {
+        if (opt.min_time && event_time < opt.min_time) { ++m_first; continue; }
+        if (opt.max_time && event_time > opt.max_time) break;
+        m_events.insert(event_time);
+    }
+
+    m_axis = trace_reader::make_axis(m_events);
+    m_record.resize(m_textlen + sizeof(trace::real) * num_samples);
+    if (m_record.empty()) {
+        fprintf(stderr, "empty trace records in '%s'\n", path.c_str());
+        return false;
+    }
+
+    // the stream ends after the first num_traces traces, if either is given
+    m_ntraces = num_traces;
+    if (opt.num_traces > 0)
+        m_ntraces = m_ntraces ? min(m_ntraces, opt.num_traces) : opt.num_traces;
+
+    m_current = 0;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// virtual
+void trace_reader_stream::close(void)
+{
+    m_events.clear();
+    m_axis.reset();
+    m_ntraces = 0;
+
+    if (m_fd >= 0)
+        ::close(m_fd);
+    if (m_socket.length())
+        unlink(m_socket.c_str());
+
+    m_socket.clear();
+    m_fd = -1;
+}
+
+// -----------------------------------------------------------------------------
+// virtual
+bool trace_reader_stream::read(trace &pt)
+{
+    if (m_fd < 0 || (m_ntraces && m_current >= m_ntraces))
+        return false;
+
+    // each record is the message text followed by the power waveform
+    bool eof = false;
+    if (!read_data(&m_record[0], m_record.size(), eof)) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    pt.set_text(&m_record[0], m_textlen);
+    pt.set_axis(m_axis);
+
+    const uint8_t *samples =
+        &m_record[m_textlen + m_first * sizeof(trace::real)];
+    memcpy(pt.power(), samples, sizeof(trace::real) * pt.size());
+
+    ++m_current;
+    return true;
+}
+
+register_trace_reader(stream, trace_reader_stream);
@@ -36,8 +36,9 @@ public:
 protected:
     bool read_waveform(const string &path, trace &pt) const;
 
-    trace::event_set m_events;
-    vector<string>   m_paths;
+    trace::event_set     m_events;
+    trace::time_axis_ptr m_axis; // time axis shared by every trace read
+    vector<string>       m_paths;
     string           m_search;
     unsigned int     m_current;
     unsigned long    m_tmin;
@@ -105,6 +106,7 @@ bool trace_reader_v2::open(const string &path, const options &opt)
 void trace_reader_v2::close()
 {
     m_events.clear();
+    m_axis.reset();
     m_paths.clear();
     m_current = 0;
 }
@@ -122,7 +124,11 @@ bool trace_reader_v2::read(trace &pt)
     pt.clear();
     pt.set_text(util::atob(msg_str));
 
-    return read_waveform(path, pt);
+    if (!read_waveform(path, pt))
+        return false;
+
+    pt.share_axis(m_axis);
+    return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -35,8 +35,9 @@ public:
 
 protected:
     typedef vector<uint8_t> text_t;
-    trace::event_set m_events;
-    vector<text_t>   m_texts;
+    trace::event_set     m_events;
+    trace::time_axis_ptr m_axis; // time axis shared by every trace read
+    vector<text_t>       m_texts;
     ifstream         m_wave_in;
     string           m_line;
     unsigned int     m_current;
@@ -147,6 +148,7 @@ bool trace_reader_v3::read(trace &pt)
         pt.push_back(trace::sample(i, (float)wave[i]));
     }
 
+    pt.share_axis(m_axis);
     return true;
 }
 
@@ -210,7 +212,7 @@ bool trace_writer_v3::write(const trace &pt)
 
     // write each sample for this trace (one line per trace)
     for (size_t i = 0; i < pt.size(); ++i)
-        fprintf(m_wave_out, "%g ", pt[i].power);
+        fprintf(m_wave_out, "%g ", pt.power(i));
     fprintf(m_wave_out, "\n");
 
     return true;
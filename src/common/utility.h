@@ -18,7 +18,9 @@
 #define UTILITY__H
 
 #include <stdint.h>
+#include <cstdlib>
 #include <ctime>
+#include <new>
 #include <string>
 #include <vector>
 #include <map>
@@ -178,6 +180,44 @@ static const int popcnt[256] = {
     6, 7, 6, 7, 7, 8, 
 };
 
+//! Allocator for vector storage aligned to the specified boundary (in bytes),
+//! so that the vectorized kernels start on a cache line.
+template <typename T, size_t N = 64>
+struct aligned_allocator {
+    typedef T         value_type;
+    typedef T        *pointer;
+    typedef const T  *const_pointer;
+    typedef T        &reference;
+    typedef const T  &const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U> struct rebind {
+        typedef aligned_allocator<U, N> other;
+    };
+
+    aligned_allocator() { }
+    template <typename U> aligned_allocator(const aligned_allocator<U, N> &) { }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    size_type max_size() const { return (size_t)-1 / sizeof(T); }
+
+    void construct(pointer p, const T &v) { new (p) T(v); }
+    void destroy(pointer p) { p->~T(); }
+
+    pointer allocate(size_type n, const void * = 0) {
+        void *p = NULL;
+        if (posix_memalign(&p, N, n * sizeof(T))) throw std::bad_alloc();
+        return (pointer)p;
+    }
+
+    void deallocate(pointer p, size_type) { free(p); }
+
+    bool operator==(const aligned_allocator &) const { return true; }
+    bool operator!=(const aligned_allocator &) const { return false; }
+};
+
 class parameters {
     typedef std::map<std::string, std::string> item_map;
     item_map m_items;
@@ -210,6 +250,54 @@ public:
     }
 };
 
+//! Write a plain value to a binary stream.
+template <typename T> void write_value(std::ostream &os, const T &value)
+{
+    os.write((const char *)&value, sizeof(T));
+}
+
+//! Read a plain value from a binary stream.
+template <typename T> bool read_value(std::istream &is, T &value)
+{
+    return !is.read((char *)&value, sizeof(T)).fail();
+}
+
+//! Write a vector of plain values to a binary stream, preceded by its size.
+template <typename T, typename A>
+void write_vector(std::ostream &os, const std::vector<T, A> &v)
+{
+    write_value<uint64_t>(os, v.size());
+    if (!v.empty()) os.write((const char *)&v[0], v.size() * sizeof(T));
+}
+
+//! Read a vector of plain values written by write_vector.
+template <typename T, typename A>
+bool read_vector(std::istream &is, std::vector<T, A> &v)
+{
+    uint64_t count = 0;
+    if (!read_value(is, count)) return false;
+
+    v.resize(count);
+    return !count || !is.read((char *)&v[0], count * sizeof(T)).fail();
+}
+
+//! Write a string to a binary stream, preceded by its length.
+inline void write_string(std::ostream &os, const std::string &str)
+{
+    write_value<uint64_t>(os, str.size());
+    os.write(str.data(), str.size());
+}
+
+//! Read a string written by write_string.
+inline bool read_string(std::istream &is, std::string &str)
+{
+    uint64_t length = 0;
+    if (!read_value(is, length)) return false;
+
+    str.resize(length);
+    return !length || !is.read(&str[0], length).fail();
+}
+
 }; // namespace util
 
 // -----------------------------------------------------------------------------
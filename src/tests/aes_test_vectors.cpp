@@ -77,6 +77,49 @@ BOOST_AUTO_TEST_CASE(aes_test_decrypt)
     }
 }
 
+// -----------------------------------------------------------------------------
+// test batched encryption of one plaintext under each test vector key
+BOOST_AUTO_TEST_CASE(aes_test_encrypt_batch)
+{
+    const size_t n = NUM_ELEMENTS(aes_test_vectors);
+    uint8_t pt[16], keys[16 * n], out[16 * n];
+
+    for (size_t i = 0; i < n; i++)
+        BOOST_CHECK( util::atob(aes_test_vectors[i].key, &keys[i * 16], 16) );
+    BOOST_CHECK( util::atob(aes_test_vectors[0].pt, pt, 16) );
+
+    aes::encrypt_batch(pt, keys, out, n);
+
+    for (size_t i = 0; i < n; i++) {
+        uint8_t sk[16 * 11], ct[16];
+        std::copy(&keys[i * 16], &keys[i * 16] + 16, sk);
+        aes::key_schedule(sk, 10);
+        aes::encrypt(pt, sk, ct);
+
+        BOOST_CHECK( util::btoa(&out[i * 16], 16) == util::btoa(ct, 16) );
+    }
+    BOOST_CHECK( util::btoa(out, 16) ==
+                 boost::to_upper_copy(std::string(aes_test_vectors[0].ct)) );
+}
+
+// -----------------------------------------------------------------------------
+// test recovery of the encryption key from the last round subkey
+BOOST_AUTO_TEST_CASE(aes_test_key_schedule_inv)
+{
+    uint8_t key[16], sk[16 * 11];
+
+    for (size_t i = 0; i < NUM_ELEMENTS(aes_test_vectors); i++) {
+        BOOST_CHECK( util::atob(aes_test_vectors[i].key, key, 16) );
+        std::copy(key, key + 16, sk);
+        aes::key_schedule(sk, 10);
+
+        std::fill(sk, sk + 16 * 10, 0);
+        aes::key_schedule_inv(sk, 10);
+
+        BOOST_CHECK( util::btoa(sk, 16) == util::btoa(key, 16) );
+    }
+}
+
 // -----------------------------------------------------------------------------
 // test encryption with simple one byte mask, where imask == omask
 BOOST_AUTO_TEST_CASE(aes_test_encrypt_simple_mask_1)
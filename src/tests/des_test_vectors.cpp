@@ -0,0 +1,87 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE des
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/included/unit_test.hpp>
+#include "utility.h"
+#include "des.h"
+
+#define NUM_ELEMENTS(x) (sizeof(x) / sizeof(x[0]))
+
+static struct {
+    const char *key, *pt, *ct;
+} des_test_vectors[] = {
+    { "133457799BBCDFF1", "0123456789ABCDEF", "85E813540F0AB405" },
+    { "0E329232EA6D0D73", "8787878787878787", "0000000000000000" },
+    { "0000000000000000", "0000000000000000", "8CA64DE9C1B123A7" },
+    { "FFFFFFFFFFFFFFFF", "FFFFFFFFFFFFFFFF", "7359B2163E4EDC58" },
+    { "3000000000000000", "1000000000000001", "958E6E627A05557B" },
+};
+
+// -----------------------------------------------------------------------------
+// Convert a hex block to the bit order used by the des routines.
+static uint64_t block(const char *hex)
+{
+    uint8_t data[8];
+    BOOST_CHECK( util::atob(hex, data, 8) );
+    return util::convert_bytes(data);
+}
+
+// -----------------------------------------------------------------------------
+// test encryption and decryption of each test vector
+BOOST_AUTO_TEST_CASE(des_test_encrypt)
+{
+    for (size_t i = 0; i < NUM_ELEMENTS(des_test_vectors); i++) {
+        uint64_t sk[16];
+        des::key_schedule(block(des_test_vectors[i].key), sk);
+
+        const uint64_t pt = block(des_test_vectors[i].pt);
+        const uint64_t ct = block(des_test_vectors[i].ct);
+        BOOST_CHECK( des::encrypt(pt, sk) == ct );
+        BOOST_CHECK( des::decrypt(ct, sk) == pt );
+    }
+}
+
+// -----------------------------------------------------------------------------
+// test batched encryption against encryption with a key schedule, for the test
+// vector keys and for random keys
+BOOST_AUTO_TEST_CASE(des_test_encrypt_batch)
+{
+    const size_t n = NUM_ELEMENTS(des_test_vectors) + 1000;
+    const uint64_t pt = block(des_test_vectors[0].pt);
+    std::vector<uint64_t> keys(n), out(n);
+
+    for (size_t i = 0; i < n; i++) {
+        if (i < NUM_ELEMENTS(des_test_vectors))
+            keys[i] = block(des_test_vectors[i].key);
+        else {
+            for (int b = 0; b < 64; b += 16)
+                keys[i] |= (uint64_t)(rand() & 0xffff) << b;
+        }
+    }
+
+    des::encrypt_batch(pt, &keys[0], &out[0], n);
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t sk[16];
+        des::key_schedule(keys[i], sk);
+        BOOST_CHECK( out[i] == des::encrypt(pt, sk) );
+    }
+    BOOST_CHECK( out[0] == block(des_test_vectors[0].ct) );
+}
@@ -0,0 +1,108 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "cmdline.h"
+#include "simd.h"
+#include "utility.h"
+
+using namespace std;
+
+// -----------------------------------------------------------------------------
+template <typename real>
+void bench_kernels(size_t n, size_t iters)
+{
+    vector<real> x(n), y(n, 0), z(n, 0), sd(n);
+    for (size_t i = 0; i < n; ++i) {
+        x[i]  = (real)rand() / RAND_MAX;
+        sd[i] = (real)rand() / RAND_MAX + 1;
+    }
+
+    struct timespec t0, t1;
+    double total = 0.0;
+    real m = 0;
+
+#define BENCH(name, stmt)                                                      \
+    clock_gettime(CLOCK_REALTIME, &t0);                                        \
+    for (size_t it = 0; it < iters; ++it) { stmt; }                            \
+    clock_gettime(CLOCK_REALTIME, &t1);                                        \
+    total = time_delta_ns(&t0, &t1);                                           \
+    printf("    %-12s %10.3f ns/iter %8.3f GB/s\n", name, total / iters,        \
+           (double)iters * n * sizeof(real) / total);
+
+    BENCH("add",        simd::add(&y[0], &x[0], n));
+    BENCH("axpy",       simd::axpy(&y[0], &x[0], (real)3, n));
+    BENCH("add_sq",     simd::add_sq(&y[0], &z[0], &x[0], n));
+    BENCH("max",        m = simd::max(&x[0], n, m));
+    BENCH("correlate",  simd::correlate(&z[0], &y[0], &x[0], &sd[0],
+                                        (real)3, (real)0.5, (real)2, n));
+    BENCH("diff_means", simd::diff_means(&z[0], &x[0], (real)3, &y[0],
+                                         (real)5, n));
+    BENCH("corr_max",   m = simd::correlate_max((real *)NULL, &y[0], &x[0],
+                                                &sd[0], (real)3, (real)0.5,
+                                                (real)2, n, m));
+    BENCH("dmeans_max", m = simd::diff_means_max((real *)NULL, &x[0],
+                                                 (real)3, &y[0], (real)5, n,
+                                                 m));
+#undef BENCH
+
+    // keep the results live so that the loops are not optimized away
+    if (m < 0 || z[n / 2] == 12345) printf("\n");
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    // build and parse the table of command line arguments
+    static const string usage_message = string(argv[0]) + " [options]";
+    static const cmdline_option cmdline_args[] = {
+        { CL_LONG, "samples,n",     "number of samples per kernel call" },
+        { CL_LONG, "iterations,k",  "number of kernel calls to time" },
+        { CL_FLAG, "help,h",        "display this usage message" },
+        { CL_TERM, 0, 0 }
+    };
+
+    cmdline cl(cmdline_args, usage_message);
+    if (!cl.parse(argc, argv) || cl.count("help")) {
+        cl.print_usage();
+        return 1;
+    }
+
+    const size_t n     = cl.get_long("samples", 4096);
+    const size_t iters = cl.get_long("iterations", 10000);
+
+    // time every kernel for each instruction set supported by this processor
+    static const simd::isa isas[] = {
+        simd::ISA_SCALAR, simd::ISA_SSE2, simd::ISA_AVX2, simd::ISA_AVX512
+    };
+
+    for (size_t i = 0; i < NUM_ELEMENTS(isas); ++i) {
+        if (isas[i] > simd::detect())
+            break;
+
+        simd::select(simd::name(isas[i]));
+        printf("%s float:\n", simd::name(isas[i]));
+        bench_kernels<float>(n, iters);
+        printf("%s double:\n", simd::name(isas[i]));
+        bench_kernels<double>(n, iters);
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE key_enum
+
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/test/included/unit_test.hpp>
+#include "key_enum.h"
+
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Random small integer scores for each guess of each part, so that sums are
+// exact and many keys tie.
+static vector<vector<double> > make_scores(size_t parts, size_t guesses)
+{
+    vector<vector<double> > scores(parts, vector<double>(guesses));
+    for (size_t i = 0; i < parts; ++i) {
+        for (size_t k = 0; k < guesses; ++k)
+            scores[i][k] = rand() % 5;
+    }
+    return scores;
+}
+
+// -----------------------------------------------------------------------------
+// Records every candidate tested, and matches a single key if one is given.
+class test_verifier: public key_enum::verifier {
+public:
+    test_verifier(size_t parts, const vector<int> &key = vector<int>()) :
+        m_parts(parts), m_key(key) {}
+
+    virtual size_t verify(const int *guesses, size_t count) {
+        boost::lock_guard<boost::mutex> lock(m_lock);
+        for (size_t i = 0; i < count; ++i) {
+            const vector<int> g(guesses + i * m_parts,
+                                guesses + (i + 1) * m_parts);
+            ++m_tested[g];
+            if (g == m_key) return i;
+        }
+        return count;
+    }
+
+    map<vector<int>, int> m_tested;
+
+protected:
+    size_t       m_parts;
+    vector<int>  m_key;
+    boost::mutex m_lock;
+};
+
+// -----------------------------------------------------------------------------
+// a list of lists holds every combination once, in decreasing order of score
+BOOST_AUTO_TEST_CASE(key_enum_list_order)
+{
+    const vector<vector<double> > scores = make_scores(3, 10);
+    key_enum::ranked_list list(
+        new key_enum::ranked_list(new key_enum::ranked_list(scores[0]),
+                                  new key_enum::ranked_list(scores[1])),
+        new key_enum::ranked_list(scores[2]));
+
+    BOOST_CHECK( list.parts() == 3 );
+    BOOST_CHECK( list.reach(999) );
+    BOOST_CHECK( !list.reach(1000) );
+
+    set<vector<int> > seen;
+    for (size_t n = 0; n < list.size(); ++n) {
+        vector<int> g(3);
+        list.guesses(n, &g[0]);
+        seen.insert(g);
+
+        BOOST_CHECK( list.score(n) ==
+                     scores[0][g[0]] + scores[1][g[1]] + scores[2][g[2]] );
+        if (n) BOOST_CHECK( list.score(n) <= list.score(n - 1) );
+    }
+    BOOST_CHECK( seen.size() == 1000 );
+}
+
+// -----------------------------------------------------------------------------
+// an exhaustive search tests every candidate exactly once
+BOOST_AUTO_TEST_CASE(key_enum_search_all)
+{
+    const vector<vector<double> > scores = make_scores(4, 12);
+    test_verifier v(4);
+    key_enum::result res;
+
+    BOOST_CHECK( key_enum::search(scores, v, 3, 1 << 20, res) );
+    BOOST_CHECK( !res.found );
+    BOOST_CHECK( res.tested == 12 * 12 * 12 * 12 );
+    BOOST_CHECK( v.m_tested.size() == 12 * 12 * 12 * 12 );
+
+    bool once = true;
+    for (map<vector<int>, int>::const_iterator it = v.m_tested.begin();
+         it != v.m_tested.end(); ++it) {
+        once = once && it->second == 1;
+    }
+    BOOST_CHECK( once );
+}
+
+// -----------------------------------------------------------------------------
+// the key is found at its exact rank, with ties ranked in its favour
+BOOST_AUTO_TEST_CASE(key_enum_search_rank)
+{
+    for (size_t threads = 1; threads <= 3; threads += 2) {
+        const vector<vector<double> > scores = make_scores(5, 8);
+        vector<int> key(5);
+        double target = 0;
+        for (size_t i = 0; i < 5; ++i) {
+            key[i] = rand() % 8;
+            target += scores[i][key[i]];
+        }
+
+        uint64_t rank = 1;
+        for (size_t k = 0; k < 8 * 8 * 8 * 8 * 8; ++k) {
+            double s = 0;
+            for (size_t i = 0, x = k; i < 5; ++i, x /= 8) s += scores[i][x % 8];
+            rank += (s > target);
+        }
+
+        test_verifier v(5, key);
+        key_enum::result res;
+        BOOST_CHECK( key_enum::search(scores, v, threads, 1 << 20, res) );
+        BOOST_CHECK( res.found );
+        BOOST_CHECK( res.key == key );
+        BOOST_CHECK( res.rank == rank );
+    }
+}
+
+// -----------------------------------------------------------------------------
+// the search stops at the limit, and rejects invalid scores
+BOOST_AUTO_TEST_CASE(key_enum_search_limits)
+{
+    key_enum::result res;
+    test_verifier v(3);
+
+    BOOST_CHECK( key_enum::search(make_scores(3, 16), v, 2, 100, res) );
+    BOOST_CHECK( !res.found );
+    BOOST_CHECK( res.tested == 100 );
+
+    BOOST_CHECK( !key_enum::search(make_scores(1, 16), v, 1, 100, res) );
+
+    vector<vector<double> > scores = make_scores(3, 16);
+    scores[1].clear();
+    BOOST_CHECK( !key_enum::search(scores, v, 1, 100, res) );
+}
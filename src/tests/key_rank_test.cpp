@@ -0,0 +1,114 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MODULE key_rank
+
+#include <cmath>
+#include <cstdlib>
+#include <boost/test/included/unit_test.hpp>
+#include "key_rank.h"
+
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Random scores for each guess of three parts, with the given guess of every
+// part raised by 'lead' standard deviations.
+static void make_scores(vector<vector<double> > &scores, vector<int> &key,
+                        double lead)
+{
+    scores.assign(3, vector<double>(256));
+    key.resize(3);
+    for (size_t i = 0; i < scores.size(); ++i) {
+        for (size_t k = 0; k < 256; ++k) {
+            // approximately normal, as the sum of uniform values
+            double s = -6;
+            for (int j = 0; j < 12; ++j) s += (double)rand() / RAND_MAX;
+            scores[i][k] = s;
+        }
+        key[i] = rand() % 256;
+        scores[i][key[i]] += lead;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Return log2 of the exact rank of the key, by enumerating every key.
+static double exact_rank(const vector<vector<double> > &scores,
+                         const vector<int> &key)
+{
+    const double target = scores[0][key[0]] + scores[1][key[1]] +
+                          scores[2][key[2]];
+    double ahead = 0;
+    for (size_t a = 0; a < 256; ++a) {
+        for (size_t b = 0; b < 256; ++b) {
+            const double ab = scores[0][a] + scores[1][b];
+            for (size_t c = 0; c < 256; ++c)
+                if (ab + scores[2][c] > target) ahead += 1;
+        }
+    }
+    return log2(ahead + 1);
+}
+
+// -----------------------------------------------------------------------------
+// the bounds contain the exact rank, and the estimate is close to it
+BOOST_AUTO_TEST_CASE(key_rank_test_bounds)
+{
+    srand(1);
+    const double leads[] = { 0, 1, 2, 3, 4 };
+    for (size_t i = 0; i < sizeof(leads) / sizeof(leads[0]); ++i) {
+        vector<vector<double> > scores;
+        vector<int> key;
+        make_scores(scores, key, leads[i]);
+
+        key_rank::bounds rank;
+        BOOST_REQUIRE( key_rank::estimate(scores, key, 2048, rank) );
+
+        const double exact = exact_rank(scores, key);
+        BOOST_CHECK( rank.low <= exact + 1e-6 );
+        BOOST_CHECK( rank.high >= exact - 1e-6 );
+        BOOST_CHECK( rank.low <= rank.estimate );
+        BOOST_CHECK( rank.estimate <= rank.high );
+        BOOST_CHECK_SMALL( rank.estimate - exact, 0.5 );
+    }
+}
+
+// -----------------------------------------------------------------------------
+// the best and worst keys take the extreme ranks
+BOOST_AUTO_TEST_CASE(key_rank_test_extremes)
+{
+    vector<vector<double> > scores(2, vector<double>(16));
+    for (size_t i = 0; i < 2; ++i)
+        for (size_t k = 0; k < 16; ++k) scores[i][k] = (double)k;
+
+    key_rank::bounds rank;
+    BOOST_REQUIRE( key_rank::estimate(scores, vector<int>(2, 15), 16, rank) );
+    BOOST_CHECK_SMALL( rank.estimate, 1e-6 );
+    BOOST_CHECK_SMALL( rank.low, 1e-6 );
+
+    BOOST_REQUIRE( key_rank::estimate(scores, vector<int>(2, 0), 16, rank) );
+    BOOST_CHECK_CLOSE( rank.estimate, 8.0, 1e-3 );
+}
+
+// -----------------------------------------------------------------------------
+// inconsistent arguments are rejected
+BOOST_AUTO_TEST_CASE(key_rank_test_invalid)
+{
+    vector<vector<double> > scores(2, vector<double>(16, 0));
+    key_rank::bounds rank;
+
+    BOOST_CHECK( !key_rank::estimate(scores, vector<int>(1, 0), 16, rank) );
+    BOOST_CHECK( !key_rank::estimate(scores, vector<int>(2, 16), 16, rank) );
+    BOOST_CHECK( !key_rank::estimate(scores, vector<int>(2, 0), 1, rank) );
+}
@@ -14,9 +14,11 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cstdlib>
 #include "attack_engine.h"
 #include "attack_manager.h"
 #include "cmdline.h"
+#include "simd.h"
 
 using namespace std;
 
@@ -34,8 +36,17 @@ int main(int argc, char *argv[])
         { CL_LONG, "num-traces,n", "maximum number of traces to process" },
         { CL_STR,  "params,p",     "specify attack specific parameters" },
         { CL_LONG, "report,r",     "generate report every N traces" },
+        { CL_LONG, "report-secs",  "generate report every N seconds (stream)" },
         { CL_FLAG, "ciphertext",   "use ciphertext rather than plaintext" },
         { CL_LONG, "threads",      "number of worker threads to run" },
+        { CL_LONG, "batch",        "number of traces processed per batch" },
+        { CL_FLAG, "split",        "divide samples rather than traces" },
+        { CL_STR,  "simd",         "kernel instruction set (auto, scalar, ...)" },
+        { CL_LONG, "checkpoint",   "save a checkpoint every N reports" },
+        { CL_STR,  "resume",       "resume from the specified checkpoint" },
+        { CL_LONG, "converge",     "stop once the best guess leads N reports" },
+        { CL_STR,  "converge-ratio", "minimum best/second best ratio to lead" },
+        { CL_STR,  "shard",        "attack trace range I of N (I/N)" },
         { CL_FLAG, "list",         "print a list of attack algorithms" },
         { CL_FLAG, "help,h",       "display this usage message" },
         { CL_FLAG, "version,V",    "display the program version" },
@@ -55,6 +66,11 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    // select the instruction set used by the vectorized attack kernels
+    if (!simd::select(cl.get_str("simd", "auto")))
+        return 1;
+    printf("using simd kernels: %s\n", simd::name(simd::selected()));
+
     // determine the input trace file format, either specified or guessed
     const string input_path = cl.get_str("input-path", "trace_input_path");
     string src_fmt = cl.get_str("src-fmt", "auto");
@@ -78,6 +94,25 @@ int main(int argc, char *argv[])
     engine_opt.result_path = cl.get_str("output-dir");
     engine_opt.num_threads = cl.get_long("threads", 1);
     engine_opt.report_tick = cl.get_long("report", 0);
+    engine_opt.report_secs = cl.get_long("report-secs", 0);
+    engine_opt.batch_size  = cl.get_long("batch", 1);
+    engine_opt.checkpoint  = cl.get_long("checkpoint", 0);
+    engine_opt.resume_path = cl.get_str("resume");
+    engine_opt.converge    = cl.get_long("converge", 0);
+    engine_opt.converge_ratio = atof(cl.get_str("converge-ratio", "1").c_str());
+    engine_opt.split       = cl.get_flag("split");
+    engine_opt.shard_index = 0;
+    engine_opt.shard_count = 1;
+
+    // a shard is given as its zero based index and the total shard count
+    const string shard = cl.get_str("shard");
+    if (shard.length() && (2 != sscanf(shard.c_str(), "%u/%u",
+                                       &engine_opt.shard_index,
+                                       &engine_opt.shard_count) ||
+                           !engine_opt.shard_count)) {
+        fprintf(stderr, "invalid shard '%s', expected I/N\n", shard.c_str());
+        return 1;
+    }
 
     // allocate the reader object given the specified trace input format
     auto_ptr<trace_reader> pReader(trace_reader::create(src_fmt));
@@ -0,0 +1,310 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <memory>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include "aes.h"
+#include "cmdline.h"
+#include "des.h"
+#include "key_enum.h"
+#include "key_rank.h"
+#include "utility.h"
+
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Tests the candidates of a search against a known plaintext and ciphertext,
+// where each candidate may stand for several full keys, and keeps the key
+// that matches.
+class cipher_verifier: public key_enum::verifier {
+public:
+    cipher_verifier(size_t keys_per_candidate) :
+        m_keys_per_candidate(keys_per_candidate), m_reported(0) {}
+
+    virtual void progress(uint64_t tested, double seconds) {
+        if (seconds < m_reported + 2)
+            return;
+        const double keys = (double)tested * m_keys_per_candidate;
+        fprintf(stderr, "tested 2^%.2f keys, %.4g keys/s\n", log2(keys),
+                keys / seconds);
+        m_reported = seconds;
+    }
+
+    size_t keys_per_candidate(void) const { return m_keys_per_candidate; }
+    const string &key(void) const { return m_key; }
+
+protected:
+    void record(const string &key) {
+        boost::lock_guard<boost::mutex> lock(m_lock);
+        m_key = key;
+    }
+
+    size_t       m_keys_per_candidate;
+    double       m_reported;
+    boost::mutex m_lock;
+    string       m_key;
+};
+
+// -----------------------------------------------------------------------------
+// AES-128, with the bytes of the encryption key as the parts, or with
+// 'last_round' the bytes of the last round subkey.
+class aes_verifier: public cipher_verifier {
+public:
+    aes_verifier(const vector<uint8_t> &pt, const vector<uint8_t> &ct,
+                 bool last_round) :
+        cipher_verifier(1), m_pt(pt), m_ct(ct), m_last_round(last_round) {}
+
+    virtual size_t verify(const int *guesses, size_t count) {
+        vector<uint8_t> keys(count * 16), out(count * 16);
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t *key = &keys[i * 16];
+            if (m_last_round) {
+                uint8_t sk[16 * 11];
+                for (int b = 0; b < 16; ++b) sk[160 + b] = guesses[i * 16 + b];
+                aes::key_schedule_inv(sk, 10);
+                copy(sk, sk + 16, key);
+            }
+            else {
+                for (int b = 0; b < 16; ++b) key[b] = guesses[i * 16 + b];
+            }
+        }
+
+        aes::encrypt_batch(&m_pt[0], &keys[0], &out[0], count);
+        for (size_t i = 0; i < count; ++i) {
+            if (!memcmp(&out[i * 16], &m_ct[0], 16)) {
+                record(util::btoa(&keys[i * 16], 16));
+                return i;
+            }
+        }
+        return count;
+    }
+
+protected:
+    vector<uint8_t> m_pt;
+    vector<uint8_t> m_ct;
+    bool            m_last_round;
+};
+
+// -----------------------------------------------------------------------------
+// DES, with the six bit sbox inputs of the first round subkey as the parts,
+// as attacked by des_hd_r0. The first round subkey holds 48 of the 56 key
+// bits; each candidate stands for the 256 keys of the other 8 bits.
+class des_verifier: public cipher_verifier {
+public:
+    des_verifier(const vector<uint8_t> &pt, const vector<uint8_t> &ct) :
+        cipher_verifier(256), m_pt(util::convert_bytes(&pt[0])),
+        m_ct(util::convert_bytes(&ct[0]))
+    {
+        // the key bits of each subkey part, a permutation of the bit
+        // reversed guess (as in des_hd_r0) back through the key schedule
+        for (int n = 0; n < 8; ++n) {
+            for (int g = 0; g < 64; ++g) {
+                const uint64_t sk = (uint64_t)util::revb(g, 6) << (n * 6);
+                m_part_keys[n][g] = key_bits(des::permute_inv(des::pc2, sk,
+                                                              48));
+            }
+        }
+
+        // the key bits dropped from the first round subkey
+        vector<int> dropped;
+        for (int b = 0; b < 56; ++b) {
+            if (find(des::pc2, des::pc2 + 48, b + 1) == des::pc2 + 48)
+                dropped.push_back(b);
+        }
+        for (int u = 0; u < 256; ++u) {
+            uint64_t cd = 0;
+            for (size_t b = 0; b < dropped.size(); ++b)
+                cd |= (uint64_t)((u >> b) & 1) << dropped[b];
+            m_free_keys[u] = key_bits(cd);
+        }
+    }
+
+    virtual size_t verify(const int *guesses, size_t count) {
+        uint64_t keys[256], out[256];
+        for (size_t i = 0; i < count; ++i, guesses += 8) {
+            uint64_t base = 0;
+            for (int n = 0; n < 8; ++n) base |= m_part_keys[n][guesses[n]];
+            for (int u = 0; u < 256; ++u) keys[u] = base | m_free_keys[u];
+
+            des::encrypt_batch(m_pt, keys, out, 256);
+            for (int u = 0; u < 256; ++u) {
+                if (out[u] == m_ct) {
+                    record(key_string(keys[u]));
+                    return i;
+                }
+            }
+        }
+        return count;
+    }
+
+protected:
+    // Return the key bits of the halves C and D of the key schedule state,
+    // as rotated for the first round subkey.
+    static uint64_t key_bits(uint64_t cd) {
+        uint32_t l = cd & 0xFFFFFFF, r = cd >> 28;
+        l = ((l << des::rot[0]) | (l >> (28 - des::rot[0]))) & 0xFFFFFFF;
+        r = ((r << des::rot[0]) | (r >> (28 - des::rot[0]))) & 0xFFFFFFF;
+        return des::permute_inv(des::pc1, l | (uint64_t)r << 28, 56);
+    }
+
+    // Return the key bytes as taken by destool, with odd parity.
+    static string key_string(uint64_t key) {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = util::revb((key >> (i * 8)) & 0xFF, 8);
+            if (!(util::popcnt[bytes[i]] & 1)) bytes[i] ^= 1;
+        }
+        return util::btoa(bytes, 8);
+    }
+
+    uint64_t m_pt;
+    uint64_t m_ct;
+    uint64_t m_part_keys[8][64];
+    uint64_t m_free_keys[256];
+};
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    // build and parse the table of command line arguments
+    static const string usage_message =
+        "enumerate [options] -p PT -c CT -i DIR -i DIR ...";
+    static const cmdline_option cmdline_args[] = {
+        { CL_STRV, "input,i",      "results of the attack on each key part" },
+        { CL_STR,  "cipher",       "aes (default), aes_r10 or des" },
+        { CL_STR,  "plaintext,p",  "known plaintext block" },
+        { CL_STR,  "ciphertext,c", "ciphertext of the known plaintext" },
+        { CL_LONG, "traces",       "use the scores after this many traces" },
+        { CL_STR,  "scores",       "reported values: corr (default) or log" },
+        { CL_LONG, "limit",        "test at most 2^N candidates (default 40)" },
+        { CL_LONG, "threads",      "number of threads (default all cores)" },
+        { CL_FLAG, "help,h",       "display this usage message" },
+        { CL_TERM, 0, 0 }
+    };
+
+    cmdline cl(cmdline_args, usage_message);
+    if (!cl.parse(argc, argv) || cl.count("help") || !cl.count("input") ||
+        !cl.count("plaintext") || !cl.count("ciphertext")) {
+        cl.print_usage();
+        return 1;
+    }
+
+    // the number of parts, guesses per part and block size of the cipher
+    const string cipher = cl.get_str("cipher", "aes");
+    size_t num_parts, num_guesses, block_size;
+    if (cipher == "aes" || cipher == "aes_r10") {
+        num_parts = 16;
+        num_guesses = 256;
+        block_size = 16;
+    }
+    else if (cipher == "des") {
+        num_parts = 8;
+        num_guesses = 64;
+        block_size = 8;
+    }
+    else {
+        fprintf(stderr, "unknown cipher: %s\n", cipher.c_str());
+        return 1;
+    }
+
+    const vector<string> inputs = cl.get_strv("input");
+    if (inputs.size() != num_parts) {
+        fprintf(stderr, "%s needs the attack on each of its %zu key parts\n",
+                cipher.c_str(), num_parts);
+        return 1;
+    }
+
+    const vector<uint8_t> pt = util::atob(cl.get_str("plaintext"));
+    const vector<uint8_t> ct = util::atob(cl.get_str("ciphertext"));
+    if (pt.size() != block_size || ct.size() != block_size) {
+        fprintf(stderr, "the plaintext and ciphertext must be %zu bytes\n",
+                block_size);
+        return 1;
+    }
+
+    const string score_type = cl.get_str("scores", "corr");
+    if (score_type != "corr" && score_type != "log") {
+        fprintf(stderr, "unknown score type: %s\n", score_type.c_str());
+        return 1;
+    }
+
+    // the scores of each part at the requested interval
+    const long traces = cl.get_long("traces", -1);
+    vector<vector<double> > scores(num_parts);
+    for (size_t i = 0; i < num_parts; ++i) {
+        vector<size_t> part_traces;
+        vector<vector<double> > part_scores;
+        if (!key_rank::read_scores(inputs[i], score_type == "corr",
+                                   part_traces, part_scores)) {
+            return 1;
+        }
+
+        size_t n = part_traces.size() - 1;
+        if (traces >= 0) {
+            n = find(part_traces.begin(), part_traces.end(), (size_t)traces) -
+                part_traces.begin();
+            if (n == part_traces.size()) {
+                fprintf(stderr, "'%s' has no report after %ld trace(s)\n",
+                        inputs[i].c_str(), traces);
+                return 1;
+            }
+        }
+
+        scores[i] = part_scores[n];
+        if (scores[i].size() != num_guesses) {
+            fprintf(stderr, "'%s' does not have %zu guesses\n",
+                    inputs[i].c_str(), num_guesses);
+            return 1;
+        }
+    }
+
+    auto_ptr<cipher_verifier> verifier;
+    if (cipher == "des") verifier.reset(new des_verifier(pt, ct));
+    else verifier.reset(new aes_verifier(pt, ct, cipher == "aes_r10"));
+
+    const long limit_bits = cl.get_long("limit", 40);
+    if (limit_bits < 0 || limit_bits > 63) {
+        fprintf(stderr, "invalid limit: 2^%ld\n", limit_bits);
+        return 1;
+    }
+
+    long threads = cl.get_long("threads", 0);
+    if (threads <= 0) threads = max(1u, boost::thread::hardware_concurrency());
+
+    key_enum::result res;
+    if (!key_enum::search(scores, *verifier, threads, (uint64_t)1 << limit_bits,
+                          res)) {
+        return 1;
+    }
+
+    const double keys = (double)res.tested * verifier->keys_per_candidate();
+    const double rate = res.seconds > 0 ? keys / res.seconds : 0;
+    if (res.found) {
+        printf("found key %s at rank %llu (2^%.2f)\n", verifier->key().c_str(),
+               (unsigned long long)res.rank, log2((double)res.rank));
+    }
+    else {
+        printf("key not found\n");
+    }
+    printf("tested %.0f keys in %.3f s on %ld thread(s), %.4g keys/s\n",
+           keys, res.seconds, threads, rate);
+
+    return res.found ? 0 : 1;
+}
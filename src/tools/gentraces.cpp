@@ -83,6 +83,7 @@ int main(int argc, char *argv[])
 
     const size_t text_size = crypt_inst->key_bits() >> 3;
     const long corr_sample = rand() % num_samples;
+    const trace::time_axis_ptr axis(trace_reader::make_axis(events));
     trace pt;
 
     for (long i = 0; i < num_traces; ++i) {
@@ -99,14 +100,14 @@ int main(int argc, char *argv[])
             weight += util::popcnt[crypt_inst->compute(b, k)];
         }
 
-        pt.clear();
         pt.set_text(text);
+        pt.set_axis(axis);
 
         for (long s = 0; s < num_samples; ++s) {
             int power = rand() % 10;
             if (s == corr_sample)
                 power += weight;
-            pt.push_back(trace::sample(s, (float)power));
+            pt.power(s) = (float)power;
         }
 
         if (!pWriter->write(pt)) {
@@ -0,0 +1,56 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "attack_engine.h"
+#include "attack_manager.h"
+#include "cmdline.h"
+#include "simd.h"
+
+using namespace std;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    // build and parse the table of command line arguments
+    static const string usage_message = "merge [options] -i CKPT -i CKPT ...";
+    static const cmdline_option cmdline_args[] = {
+        { CL_STRV, "input,i",      "checkpoint of a trace range to merge" },
+        { CL_STR,  "output-dir,o", "specify the results output directory" },
+        { CL_LONG, "threads",      "number of merge threads to run" },
+        { CL_STR,  "simd",         "kernel instruction set (auto, scalar, ...)" },
+        { CL_FLAG, "help,h",       "display this usage message" },
+        { CL_TERM, 0, 0 }
+    };
+
+    cmdline cl(cmdline_args, usage_message);
+    if (!cl.parse(argc, argv) || cl.count("help") || !cl.count("input")) {
+        cl.print_usage();
+        return 1;
+    }
+
+    // select the instruction set used by the vectorized attack kernels
+    if (!simd::select(cl.get_str("simd", "auto")))
+        return 1;
+
+    // the attack configuration itself is taken from the checkpoints
+    attack_engine::options engine_opt;
+    engine_opt.result_path = cl.get_str("output-dir");
+    engine_opt.num_threads = cl.get_long("threads", 1);
+
+    attack_engine engine;
+    return engine.merge(engine_opt, cl.get_strv("input")) ? 0 : 1;
+}
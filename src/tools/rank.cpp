@@ -0,0 +1,111 @@
+// dpa framework - a collection of tools for differential power analysis
+// Copyright (C) 2011  Garrett C. Smith
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <fstream>
+#include "cmdline.h"
+#include "key_rank.h"
+#include "utility.h"
+
+using namespace std;
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    // build and parse the table of command line arguments
+    static const string usage_message =
+        "rank [options] -k KEY -i DIR -i DIR ...";
+    static const cmdline_option cmdline_args[] = {
+        { CL_STRV, "input,i",      "results of the attack on each key part" },
+        { CL_STR,  "key,k",        "known key, one byte per input in order" },
+        { CL_STR,  "output,o",     "write the ranks to the specified csv" },
+        { CL_LONG, "bins",         "histogram bins per key part" },
+        { CL_STR,  "scores",       "reported values: corr (default) or log" },
+        { CL_FLAG, "help,h",       "display this usage message" },
+        { CL_TERM, 0, 0 }
+    };
+
+    cmdline cl(cmdline_args, usage_message);
+    if (!cl.parse(argc, argv) || cl.count("help") || !cl.count("input") ||
+        !cl.count("key")) {
+        cl.print_usage();
+        return 1;
+    }
+
+    const vector<string> inputs = cl.get_strv("input");
+    const vector<uint8_t> key_bytes = util::atob(cl.get_str("key"));
+    if (key_bytes.size() != inputs.size()) {
+        fprintf(stderr, "the key must have one byte for each of the %zu "
+                        "input(s)\n", inputs.size());
+        return 1;
+    }
+
+    const string score_type = cl.get_str("scores", "corr");
+    if (score_type != "corr" && score_type != "log") {
+        fprintf(stderr, "unknown score type: %s\n", score_type.c_str());
+        return 1;
+    }
+
+    // the scores of each part at each interval
+    vector<vector<vector<double> > > parts(inputs.size());
+    vector<size_t> traces, part_traces;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!key_rank::read_scores(inputs[i], score_type == "corr",
+                                   part_traces, parts[i])) {
+            return 1;
+        }
+        if (!i) traces = part_traces;
+        else if (part_traces != traces) {
+            fprintf(stderr, "'%s' reports different intervals than '%s'\n",
+                    inputs[i].c_str(), inputs[0].c_str());
+            return 1;
+        }
+    }
+
+    ofstream out;
+    const string out_path = cl.get_str("output");
+    if (out_path.length()) {
+        out.open(out_path.c_str());
+        if (!out.is_open()) {
+            fprintf(stderr, "failed to open '%s' for writing\n",
+                    out_path.c_str());
+            return 1;
+        }
+    }
+
+    // estimate the rank of the full key at every interval
+    const vector<int> key(key_bytes.begin(), key_bytes.end());
+    const size_t bins = cl.get_long("bins", 2048);
+    for (size_t n = 0; n < traces.size(); ++n) {
+        vector<vector<double> > scores(parts.size());
+        for (size_t i = 0; i < parts.size(); ++i) scores[i] = parts[i][n];
+
+        key_rank::bounds rank;
+        if (!key_rank::estimate(scores, key, bins, rank)) {
+            fprintf(stderr, "failed to estimate the key rank\n");
+            return 1;
+        }
+
+        printf("%zu trace(s): key rank 2^%.2f (2^%.2f to 2^%.2f)\n",
+               traces[n], rank.estimate, rank.low, rank.high);
+        if (out.is_open()) {
+            out << traces[n] << "," << rank.low << "," << rank.estimate
+                << "," << rank.high << endl;
+        }
+    }
+
+    return 0;
+}